@@ -0,0 +1,99 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+// Times parsing, diffing, planning and applying an edit of a generated configuration, nothing is written.
+// Usage: bench_package-edits [entries], prints one JSON object:
+// {"entries", "parse_ms", "diff_ms", "plan_ms", "apply_ms", "overwrite_ms", "added", "removed", "consistent", "edited_bytes"},
+// consistent is false if the edit plans disagree with the list comparison.
+
+#include "../nix-layer/nix-config.h"
+#include "../libs/package-set.h"
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+int main(int argc, char* argv[])
+{
+    const int entries = argc > 1 ? qMax(0, QByteArray(argv[1]).toInt()) : 10000;
+
+    // a home.nix the way provisioning scripts write it: one package per line, some "nixpkgs." spellings and comments
+    QByteArray text("{ config, pkgs, ... }:\n\n{\n  home.packages = [\n");
+    for (int i = 0; i < entries; ++i) {
+        text += QStringLiteral("    %1.package-%2%3\n")
+                    .arg(i % 3 == 0 ? "nixpkgs" : "pkgs").arg(i)
+                    .arg(i % 50 == 0 ? QStringLiteral(" # batch %1").arg(i / 50) : QString()).toUtf8();
+    }
+    text += "  ];\n}\n";
+
+    // the wanted list replaces every 10th package with a new one and comes in reverse order
+    QStringList wanted;
+    QStringList to_add;
+    QStringList to_delete;
+    wanted.reserve(entries);
+    for (int i = entries - 1; i >= 0; --i) {
+        if (i % 10 == 0) {
+            wanted.append(QStringLiteral("pkgs.new-package-%1").arg(i));
+            to_add.append(wanted.last());
+            to_delete.append(QStringLiteral("pkgs.package-%1").arg(i));
+        } else {
+            wanted.append(QStringLiteral("pkgs.package-%1").arg(i));
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ConfigDocument::DocumentPtr document = ConfigDocument::parse(QStringLiteral("benchmark.nix"), text);
+    const qint64 parse_ns = timer.nsecsElapsed();
+
+    timer.restart();
+    const PackageSet::Diff set_diff = PackageSet::diff(document->packages(QStringLiteral("home")), wanted);
+    const qint64 diff_ns = timer.nsecsElapsed();
+
+    timer.restart();
+    const ConfigEdit::Plan plan = ConfigEdit::plan(*document, to_add, to_delete, QStringLiteral("home"));
+    const qint64 plan_ns = timer.nsecsElapsed();
+
+    timer.restart();
+    const QByteArray edited = ConfigEdit::apply(document->text, plan.splices);
+    const qint64 apply_ns = timer.nsecsElapsed();
+
+    timer.restart();
+    const ConfigEdit::Plan overwrite = ConfigEdit::plan(*document, wanted, QStringList(), QStringLiteral("home"), true);
+    const qint64 overwrite_ns = timer.nsecsElapsed();
+
+    const bool consistent = plan.ok && overwrite.ok && plan.added == set_diff.added && plan.deleted.size() == set_diff.removed.size()
+                            && overwrite.added == set_diff.added && overwrite.deleted.size() == set_diff.removed.size();
+
+    QJsonObject object;
+    object["entries"] = int(document->packages(QStringLiteral("home")).size());
+    object["parse_ms"] = double(parse_ns) / 1e6;
+    object["diff_ms"] = double(diff_ns) / 1e6;
+    object["plan_ms"] = double(plan_ns) / 1e6;
+    object["apply_ms"] = double(apply_ns) / 1e6;
+    object["overwrite_ms"] = double(overwrite_ns) / 1e6;
+    object["added"] = int(set_diff.added.size());
+    object["removed"] = int(set_diff.removed.size());
+    object["consistent"] = consistent;
+    object["edited_bytes"] = int(edited.size());
+    QTextStream(stdout) << QJsonDocument(object).toJson(QJsonDocument::Compact) << '\n';
+    return consistent ? 0 : 1;
+}
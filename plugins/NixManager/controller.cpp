@@ -2,192 +2,343 @@
 #include <QDebug>
 #include <QThread>
 #include <QVariant> // Needed for Q_ARG(QVariant, ...)
+#include "libs/operation-context.h"
 
 Controller::Controller(QObject *parent)
-    : QObject(parent), m_worker(new Worker)
+    : QObject(parent), m_scheduler(new Scheduler(this))
 {
-    // 1. Move the Worker object to the newly created thread
-    m_worker->moveToThread(&m_workerThread);
+    // 0. Default time limits (seconds) per operation, counted from when the worker starts it.
+    // Builds and downloads on a phone can take a long time, queries should not.
+    m_operation_timeouts = {
+        {"hm_switch", 3 * 3600},
+        {"add_packages", 3 * 3600},
+        {"delete_packages", 3 * 3600},
+        {"apply_changes", 3 * 3600},
+        {"switch_generation", 3600},
+        {"update_channels", 3600},
+        {"install_nix_home_manager", 3 * 3600},
+        {"uninstall_nix_home_manager", 1800},
+        {"search_packages", 600},
+        {"hm_expire_generations", 600},
+        {"delete_old_generations", 600},
+        {"delete_generation", 600},
+    };
 
-    // 2. Connect the Worker's signal (result) to the Controller's signal (result)
-    // This pipes the result back to the main thread listener
-    connect(m_worker, &Worker::operation_finished,
+    // 1. Pipe results and progress of all workers back to the main thread listener
+    connect(m_scheduler, &Scheduler::operation_finished,
             this, &Controller::operation_result);
-
-    // 3. Ensure proper cleanup: when the thread finishes, delete the worker object.
-    connect(&m_workerThread, &QThread::finished, m_worker, &QObject::deleteLater);
-
-    // 4. Start the thread
-    m_workerThread.start();
+    connect(m_scheduler, &Scheduler::operation_progress,
+            this, &Controller::operation_progress);
+    connect(m_scheduler, &Scheduler::operation_partial,
+            this, &Controller::operation_partial);
 
     qDebug() << "Controller initialized. Controller in thread:"
-             << QThread::currentThread()
-             << "Worker is in thread:"
-             << m_workerThread.currentThread();
+             << QThread::currentThread();
 }
 
 Controller::~Controller()
 {
-    qDebug() << "Stopping Worker thread...";
-    // Request the thread to quit and wait for it to stop gracefully
-    m_workerThread.quit();
-    m_workerThread.wait();
-    // The m_worker object will be automatically deleted via QObject::deleteLater
-    // once the thread finishes (due to the connection in the constructor).
-    qDebug() << "Worker thread stopped.";
+    // m_scheduler is a child, it stops and joins its worker threads when deleted.
+    qDebug() << "Controller destroyed.";
+}
+
+// Registers the request's cancel/timeout state before it is queued, so cancel() also works while it waits.
+void Controller::track_request(const QVariant& requestId, const QString& operation)
+{
+    int timeout = m_operation_timeouts.value(operation, kDefaultOperationTimeout);
+    OperationContext::register_request(requestId, static_cast<qint64>(timeout) * 1000);
+}
+
+// Stops the previous search of a session (its HTTP requests, nix-env and queued detail fetches), nobody will look at its results anymore.
+void Controller::supersede_search(const QString& session, const QVariant& requestId)
+{
+    if (session.isEmpty()) return;
+    const QVariant previous = m_search_sessions.value(session);
+    m_search_sessions.insert(session, requestId);
+    if (!previous.isValid() || previous == requestId) return;
+    if (m_scheduler->cancel(previous, OperationContext::Interruption::Superseded)) {
+        qDebug() << "Controller: search" << previous << "superseded by" << requestId << "(session" << session << ")";
+    }
+}
+
+bool Controller::cancel(const QVariant& requestId)
+{
+    bool known = m_scheduler->cancel(requestId);
+    qDebug() << "Controller: cancel requested for" << requestId << (known ? "" : "(unknown or already finished)");
+    return known;
+}
+
+void Controller::set_operation_timeout(const QString& operation, int seconds)
+{
+    m_operation_timeouts[operation] = qMax(0, seconds);
+}
+
+QString Controller::queue_stats() const
+{
+    return m_scheduler->stats_json();
 }
 
 // NOTE: The incorrect CONTROLLER_REQUEST macro has been removed.
 // The functions below now use explicit QMetaObject::invokeMethod with Q_ARG 
 // for each parameter, which is the correct and safest way for Qt concurrent calls.
+// The Scheduler decides when (and on which worker) that call happens.
+
+void Controller::request_hm_switch(const QVariant& requestId, bool allow_insecure, const QString& priority)
+{
+    track_request(requestId, "hm_switch");
+    m_scheduler->submit(requestId, "hm_switch", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "hm_switch", Qt::QueuedConnection,
+            Q_ARG(bool, allow_insecure),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "hm_switch"));
+    }, QString(), priority);
+}
+
+void Controller::request_hm_version(const QVariant& requestId, const QString& priority)
+{
+    track_request(requestId, "hm_version");
+    m_scheduler->submit(requestId, "hm_version", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "hm_version", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "hm_version"));
+    }, QStringLiteral("hm_version"), priority);
+}
+
+void Controller::request_read_packages(const QVariant& requestId, const QString& packageType, const QString& priority)
+{
+    track_request(requestId, "read_packages");
+    m_scheduler->submit(requestId, "read_packages", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "read_packages", Qt::QueuedConnection,
+            Q_ARG(QString, packageType),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "read_packages"));
+    }, QStringLiteral("read_packages|") + packageType, priority);
+}
+
+void Controller::request_read_package_files(const QVariant& requestId, const QString& packageType, const QString& priority)
+{
+    track_request(requestId, "read_package_files");
+    m_scheduler->submit(requestId, "read_package_files", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "read_package_files", Qt::QueuedConnection,
+            Q_ARG(QString, packageType),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "read_package_files"));
+    }, QStringLiteral("read_package_files|") + packageType, priority);
+}
 
-void Controller::request_hm_switch(const QVariant& requestId, bool allow_insecure)
+void Controller::request_describe_packages(const QVariant& requestId, const QString& packagesJsonString, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "hm_switch", Qt::QueuedConnection,
-        Q_ARG(bool, allow_insecure),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "hm_switch"));
+    track_request(requestId, "describe_packages");
+    m_scheduler->submit(requestId, "describe_packages", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "describe_packages", Qt::QueuedConnection,
+            Q_ARG(QString, packagesJsonString),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "describe_packages"));
+    }, QStringLiteral("describe_packages|") + packagesJsonString, priority);
 }
 
-void Controller::request_hm_version(const QVariant& requestId)
+void Controller::request_add_packages(const QVariant& requestId, const QString& packagesJsonString, bool allow_insecure, const QString& packageType, bool overwrite, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "hm_version", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "hm_version"));
+    track_request(requestId, "add_packages");
+    m_scheduler->submit(requestId, "add_packages", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "add_packages", Qt::QueuedConnection,
+            Q_ARG(QString, packagesJsonString),
+            Q_ARG(bool, allow_insecure),
+            Q_ARG(QString, packageType),
+            Q_ARG(bool, overwrite),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "add_packages"));
+    }, QString(), priority);
 }
 
-void Controller::request_read_packages(const QVariant& requestId, const QString& packageType)
+void Controller::request_delete_packages(const QVariant& requestId, const QString& packagesJsonString, const QString& packageType, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "read_packages", Qt::QueuedConnection,
-        Q_ARG(QString, packageType),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "read_packages"));
+    track_request(requestId, "delete_packages");
+    m_scheduler->submit(requestId, "delete_packages", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "delete_packages", Qt::QueuedConnection,
+            Q_ARG(QString, packagesJsonString),
+            Q_ARG(QString, packageType),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "delete_packages"));
+    }, QString(), priority);
 }
 
-void Controller::request_add_packages(const QVariant& requestId, const QString& packagesJsonString, bool allow_insecure, const QString& packageType, bool overwrite)
+void Controller::request_apply_changes(const QVariant& requestId, const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure, const QString& packageType, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "add_packages", Qt::QueuedConnection,
-        Q_ARG(QString, packagesJsonString),
-        Q_ARG(bool, allow_insecure),
-        Q_ARG(QString, packageType),
-        Q_ARG(bool, overwrite),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "add_packages"));
+    track_request(requestId, "apply_changes");
+    m_scheduler->submit(requestId, "apply_changes", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "apply_changes", Qt::QueuedConnection,
+            Q_ARG(QString, toAddJsonString),
+            Q_ARG(QString, toDeleteJsonString),
+            Q_ARG(bool, allow_insecure),
+            Q_ARG(QString, packageType),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "apply_changes"));
+    }, QString(), priority);
 }
 
-void Controller::request_delete_packages(const QVariant& requestId, const QString& packagesJsonString, const QString& packageType)
+void Controller::request_preview_changes(const QVariant& requestId, const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "delete_packages", Qt::QueuedConnection,
-        Q_ARG(QString, packagesJsonString),
-        Q_ARG(QString, packageType),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "delete_packages"));
+    track_request(requestId, "preview_changes");
+    m_scheduler->submit(requestId, "preview_changes", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "preview_changes", Qt::QueuedConnection,
+            Q_ARG(QString, toAddJsonString),
+            Q_ARG(QString, toDeleteJsonString),
+            Q_ARG(QString, packageType),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "preview_changes"));
+    }, QStringLiteral("preview_changes|") + packageType + "|" + toAddJsonString + "|" + toDeleteJsonString, priority);
 }
 
-void Controller::request_search_packages(const QVariant& requestId, const QString& quarry, bool local, const QString& base_url, int timeout)
+void Controller::request_search_packages(const QVariant& requestId, const QString& quarry, bool local, const QString& base_url, int timeout, const QString& session, bool by_command, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "search_packages", Qt::QueuedConnection,
-        Q_ARG(QString, quarry),
-        Q_ARG(bool, local),
-        Q_ARG(QString, base_url),
-        Q_ARG(int, timeout),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "search_packages"));
+    supersede_search(session, requestId);
+    track_request(requestId, "search_packages");
+    m_scheduler->submit(requestId, "search_packages", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "search_packages", Qt::QueuedConnection,
+            Q_ARG(QString, quarry),
+            Q_ARG(bool, local),
+            Q_ARG(QString, base_url),
+            Q_ARG(int, timeout),
+            Q_ARG(bool, by_command),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "search_packages"));
+    }, QStringList{QStringLiteral("search_packages"), quarry, local ? QStringLiteral("local") : QStringLiteral("remote"),
+                   base_url, QString::number(timeout), by_command ? QStringLiteral("command") : QStringLiteral("package")}.join('\n'), priority);
 }
 
-void Controller::request_update_channels(const QVariant& requestId)
+void Controller::request_update_channels(const QVariant& requestId, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "update_channels", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "update_channels"));
+    track_request(requestId, "update_channels");
+    m_scheduler->submit(requestId, "update_channels", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "update_channels", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "update_channels"));
+    }, QString(), priority);
 }
 
-void Controller::request_list_channels(const QVariant& requestId)
+void Controller::request_list_channels(const QVariant& requestId, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "list_channels", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "list_channels"));
+    track_request(requestId, "list_channels");
+    m_scheduler->submit(requestId, "list_channels", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "list_channels", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "list_channels"));
+    }, QStringLiteral("list_channels"), priority);
 }
 
-void Controller::request_add_channel(const QVariant& requestId, const QString& url, const QString& name)
+void Controller::request_add_channel(const QVariant& requestId, const QString& url, const QString& name, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "add_channel", Qt::QueuedConnection,
-        Q_ARG(QString, url),
-        Q_ARG(QString, name),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "add_channel"));
+    track_request(requestId, "add_channel");
+    m_scheduler->submit(requestId, "add_channel", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "add_channel", Qt::QueuedConnection,
+            Q_ARG(QString, url),
+            Q_ARG(QString, name),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "add_channel"));
+    }, QString(), priority);
 }
 
-void Controller::request_remove_channel(const QVariant& requestId, const QString& name)
+void Controller::request_remove_channel(const QVariant& requestId, const QString& name, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "remove_channel", Qt::QueuedConnection,
-        Q_ARG(QString, name),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "remove_channel"));
+    track_request(requestId, "remove_channel");
+    m_scheduler->submit(requestId, "remove_channel", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "remove_channel", Qt::QueuedConnection,
+            Q_ARG(QString, name),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "remove_channel"));
+    }, QString(), priority);
 }
 
-void Controller::request_list_generations(const QVariant& requestId)
+void Controller::request_list_generations(const QVariant& requestId, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "list_generations", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "list_generations"));
+    track_request(requestId, "list_generations");
+    m_scheduler->submit(requestId, "list_generations", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "list_generations", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "list_generations"));
+    }, QStringLiteral("list_generations"), priority);
 }
 
-void Controller::request_switch_generation(const QVariant& requestId, const QString& generation_id)
+void Controller::request_switch_generation(const QVariant& requestId, const QString& generation_id, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "switch_generation", Qt::QueuedConnection,
-        Q_ARG(QString, generation_id),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "switch_generation"));
+    track_request(requestId, "switch_generation");
+    m_scheduler->submit(requestId, "switch_generation", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "switch_generation", Qt::QueuedConnection,
+            Q_ARG(QString, generation_id),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "switch_generation"));
+    }, QString(), priority);
 }
 
-void Controller::request_delete_generation(const QVariant& requestId, const QString& generation_id)
+void Controller::request_delete_generation(const QVariant& requestId, const QString& generation_id, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "delete_generation", Qt::QueuedConnection,
-        Q_ARG(QString, generation_id),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "delete_generation"));
+    track_request(requestId, "delete_generation");
+    m_scheduler->submit(requestId, "delete_generation", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "delete_generation", Qt::QueuedConnection,
+            Q_ARG(QString, generation_id),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "delete_generation"));
+    }, QString(), priority);
 }
 
-void Controller::request_delete_old_generations(const QVariant& requestId)
+void Controller::request_delete_old_generations(const QVariant& requestId, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "delete_old_generations", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "delete_old_generations"));
+    track_request(requestId, "delete_old_generations");
+    m_scheduler->submit(requestId, "delete_old_generations", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "delete_old_generations", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "delete_old_generations"));
+    }, QString(), priority);
 }
 
-void Controller::request_hm_expire_generations(const QVariant& requestId, const QString& timestamp)
+void Controller::request_hm_expire_generations(const QVariant& requestId, const QString& timestamp, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "hm_expire_generations", Qt::QueuedConnection,
-        Q_ARG(QString, timestamp),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "hm_expire_generations"));
+    track_request(requestId, "hm_expire_generations");
+    m_scheduler->submit(requestId, "hm_expire_generations", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "hm_expire_generations", Qt::QueuedConnection,
+            Q_ARG(QString, timestamp),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "hm_expire_generations"));
+    }, QString(), priority);
 }
 
-void Controller::request_hm_list_generations(const QVariant& requestId)
+void Controller::request_hm_list_generations(const QVariant& requestId, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "hm_list_generations", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "hm_list_generations"));
+    track_request(requestId, "hm_list_generations");
+    m_scheduler->submit(requestId, "hm_list_generations", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "hm_list_generations", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "hm_list_generations"));
+    }, QStringLiteral("hm_list_generations"), priority);
 }
 
-void Controller::request_install_nix_home_manager(const QVariant& requestId, const QString& nix_version, const QString& hw_version)
+void Controller::request_install_nix_home_manager(const QVariant& requestId, const QString& nix_version, const QString& hw_version, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "install_nix_home_manager", Qt::QueuedConnection,
-        Q_ARG(QString, nix_version),
-        Q_ARG(QString, hw_version),
-        Q_ARG(QVariant, requestId),
-        Q_ARG(QString, "install_nix_home_manager"));
+    track_request(requestId, "install_nix_home_manager");
+    m_scheduler->submit(requestId, "install_nix_home_manager", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "install_nix_home_manager", Qt::QueuedConnection,
+            Q_ARG(QString, nix_version),
+            Q_ARG(QString, hw_version),
+            Q_ARG(QVariant, requestId),
+            Q_ARG(QString, "install_nix_home_manager"));
+    }, QString(), priority);
 }
 
-void Controller::request_uninstall_nix_home_manager(const QVariant& requestId)
+void Controller::request_uninstall_nix_home_manager(const QVariant& requestId, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "uninstall_nix_home_manager", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId), Q_ARG(QString, "uninstall_nix_home_manager"));
+    track_request(requestId, "uninstall_nix_home_manager");
+    m_scheduler->submit(requestId, "uninstall_nix_home_manager", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "uninstall_nix_home_manager", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId), Q_ARG(QString, "uninstall_nix_home_manager"));
+    }, QString(), priority);
 }
 
-void Controller::request_detect_nix_home_manager(const QVariant& requestId)
+void Controller::request_detect_nix_home_manager(const QVariant& requestId, const QString& priority)
 {
-    QMetaObject::invokeMethod(m_worker, "detect_nix_home_manager", Qt::QueuedConnection,
-        Q_ARG(QVariant, requestId), Q_ARG(QString, "detect_nix_home_manager"));
+    track_request(requestId, "detect_nix_home_manager");
+    m_scheduler->submit(requestId, "detect_nix_home_manager", [=](Worker* worker) {
+        QMetaObject::invokeMethod(worker, "detect_nix_home_manager", Qt::QueuedConnection,
+            Q_ARG(QVariant, requestId), Q_ARG(QString, "detect_nix_home_manager"));
+    }, QStringLiteral("detect_nix_home_manager"), priority);
 }
\ No newline at end of file
@@ -6,12 +6,13 @@
 #include <QObject>
 #include <QThread>
 #include <QVariant>
-#include "worker.h"
+#include <QHash>
+#include "scheduler.h"
 
 /**
- * @brief The Controller class manages the QThread and Worker lifecycle.
+ * @brief The Controller class is the QML facing entry point.
  * It provides the public, asynchronous API to access Nix/Home Manager functionality
- * by forwarding requests (via signals/slots) to the Worker object in the separate thread.
+ * by handing requests to the Scheduler, which runs them on its pool of Worker threads.
  */
 class Controller : public QObject
 {
@@ -24,28 +25,59 @@ public:
     // =========================================================================
     // Public Asynchronous API (Slots that trigger the Worker)
     // These slots are called by the main application logic.
+    // The trailing priority is an optional hint for the Scheduler: "interactive",
+    // "mutation" or "background" ("" keeps the operation's default class).
+    // A search with a session key (e.g. one per search field) supersedes the
+    // previous search of that session, which then finishes with "superseded": true.
     // =========================================================================
 
 public slots:
-    void request_hm_switch(const QVariant& requestId, const bool allow_insecure = false);
-    void request_hm_version(const QVariant& requestId);
-    void request_read_packages(const QVariant& requestId, const QString& packageType = QString::fromStdString("home"));
-    void request_add_packages(const QVariant& requestId, const QString& packagesJsonString, bool allow_insecure = false, const QString& packageType = QString::fromStdString("home"), bool overwrite = false);
-    void request_delete_packages(const QVariant& requestId, const QString& packagesJsonString, const QString& packageType = QString::fromStdString("home"));
-    void request_search_packages(const QVariant& requestId, const QString& quarry, const bool local = false, const QString& base_url = QString::fromStdString("https://search.devbox.sh"), const int timeout = 10);
-    void request_update_channels(const QVariant& requestId);
-    void request_list_channels(const QVariant& requestId);
-    void request_add_channel(const QVariant& requestId, const QString& url, const QString& name);
-    void request_remove_channel(const QVariant& requestId, const QString& name);
-    void request_list_generations(const QVariant& requestId);
-    void request_switch_generation(const QVariant& requestId, const QString& generation_id);
-    void request_delete_generation(const QVariant& requestId, const QString& generation_id);
-    void request_delete_old_generations(const QVariant& requestId);
-    void request_hm_expire_generations(const QVariant& requestId, const QString& timestamp = "-30 days");
-    void request_hm_list_generations(const QVariant& requestId);
-    void request_install_nix_home_manager(const QVariant& requestId, const QString& nix_version, const QString& hw_version);
-    void request_uninstall_nix_home_manager(const QVariant& requestId);
-    void request_detect_nix_home_manager(const QVariant& requestId);
+    void request_hm_switch(const QVariant& requestId, const bool allow_insecure = false, const QString& priority = QString());
+    void request_hm_version(const QVariant& requestId, const QString& priority = QString());
+    void request_read_packages(const QVariant& requestId, const QString& packageType = QString::fromStdString("home"), const QString& priority = QString());
+    void request_read_package_files(const QVariant& requestId, const QString& packageType = QString::fromStdString("home"), const QString& priority = QString());
+    void request_describe_packages(const QVariant& requestId, const QString& packagesJsonString, const QString& priority = QString());
+    void request_add_packages(const QVariant& requestId, const QString& packagesJsonString, bool allow_insecure = false, const QString& packageType = QString::fromStdString("home"), bool overwrite = false, const QString& priority = QString());
+    void request_delete_packages(const QVariant& requestId, const QString& packagesJsonString, const QString& packageType = QString::fromStdString("home"), const QString& priority = QString());
+    void request_apply_changes(const QVariant& requestId, const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure = false, const QString& packageType = QString::fromStdString("home"), const QString& priority = QString());
+    void request_preview_changes(const QVariant& requestId, const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType = QString::fromStdString("home"), const QString& priority = QString());
+    void request_search_packages(const QVariant& requestId, const QString& quarry, const bool local = false, const QString& base_url = QString::fromStdString("https://search.devbox.sh"), const int timeout = 10, const QString& session = QString(), const bool by_command = false, const QString& priority = QString());
+    void request_update_channels(const QVariant& requestId, const QString& priority = QString());
+    void request_list_channels(const QVariant& requestId, const QString& priority = QString());
+    void request_add_channel(const QVariant& requestId, const QString& url, const QString& name, const QString& priority = QString());
+    void request_remove_channel(const QVariant& requestId, const QString& name, const QString& priority = QString());
+    void request_list_generations(const QVariant& requestId, const QString& priority = QString());
+    void request_switch_generation(const QVariant& requestId, const QString& generation_id, const QString& priority = QString());
+    void request_delete_generation(const QVariant& requestId, const QString& generation_id, const QString& priority = QString());
+    void request_delete_old_generations(const QVariant& requestId, const QString& priority = QString());
+    void request_hm_expire_generations(const QVariant& requestId, const QString& timestamp = "-30 days", const QString& priority = QString());
+    void request_hm_list_generations(const QVariant& requestId, const QString& priority = QString());
+    void request_install_nix_home_manager(const QVariant& requestId, const QString& nix_version, const QString& hw_version, const QString& priority = QString());
+    void request_uninstall_nix_home_manager(const QVariant& requestId, const QString& priority = QString());
+    void request_detect_nix_home_manager(const QVariant& requestId, const QString& priority = QString());
+
+    /**
+     * @brief Cancels a queued or running request.
+     * A running command is killed together with all processes it started, the request
+     * then finishes through operation_result with "success": false and "cancelled": true.
+     * @param requestId The identifier the request was submitted with.
+     * @return True if the request was still queued or running.
+     */
+    bool cancel(const QVariant& requestId);
+
+    /**
+     * @brief Overrides the time limit of an operation (e.g. "hm_switch") for requests submitted afterwards.
+     * A request that runs longer is killed and finishes with "success": false and "timed_out": true.
+     * @param operation The operation name as reported in operation_result.
+     * @param seconds The new limit in seconds, 0 disables the limit.
+     */
+    void set_operation_timeout(const QString& operation, int seconds);
+
+    /**
+     * @brief Queue diagnostics: running and waiting requests and wait times per priority class.
+     * @return JSON string, see Scheduler::stats_json().
+     */
+    QString queue_stats() const;
 
 signals:
     /**
@@ -57,9 +89,37 @@ signals:
      */
     void operation_result(const QString& resultJson, const QVariant& requestId, const QString& operation);
 
+    /**
+     * @brief Signal emitted for every output line of a still running operation.
+     * Lets QML show live progress for long operations such as hm_switch or update_channels.
+     * @param requestId Original request identifier.
+     * @param operation The name of the running method (e.g., "hm_switch").
+     * @param progressJson JSON string: {"stream", "line", "phase", "derivations_built", "derivations_total",
+     * "paths_fetched", "paths_total", "download_bytes", "download_bytes_total"}.
+     */
+    void operation_progress(const QVariant& requestId, const QString& operation, const QString& progressJson);
+
+    /**
+     * @brief Signal emitted for every partial result of a still running operation.
+     * search_packages (remote) emits {"event": "result", "rank", "package"} for every package that
+     * passed the architecture check as soon as its details arrive (rank is its position in relevance
+     * order, results arrive in any order), then {"event": "complete", "success", "count"} once before
+     * operation_result.
+     * @param requestId Original request identifier.
+     * @param operation The name of the running method (e.g., "search_packages").
+     * @param partialJson JSON string as described above.
+     */
+    void operation_partial(const QVariant& requestId, const QString& operation, const QString& partialJson);
+
 private:
-    QThread m_workerThread;
-    Worker *m_worker;
+    void track_request(const QVariant& requestId, const QString& operation);
+    void supersede_search(const QString& session, const QVariant& requestId);
+
+    static const int kDefaultOperationTimeout = 300; // seconds, for operations not listed in m_operation_timeouts
+
+    Scheduler *m_scheduler;
+    QHash<QString, int> m_operation_timeouts; // seconds per operation name, 0 means no limit
+    QHash<QString, QVariant> m_search_sessions; // search session key -> requestId of its newest search
 };
 
 #endif // CONTROLLER_H
\ No newline at end of file
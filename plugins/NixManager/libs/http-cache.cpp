@@ -0,0 +1,142 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "http-cache.h"
+#include "login-env.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+namespace HttpCache {
+
+    // file layout: one line of JSON metadata ({"url", "etag", "last_modified", "fetched"}), then the body.
+
+    static QMutex s_mutex;       // guards the directory and s_total_bytes
+    static qint64 s_total_bytes = -1; // -1 until the directory was scanned once
+
+    QString cache_dir() {
+        return LoginEnvironment::xdg_cache_home() + "/nixmanager/http";
+    }
+
+    static QString file_for(const QString& url) {
+        return cache_dir() + '/' + QString::fromLatin1(QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex());
+    }
+
+    static bool read_file(const QString& path, QJsonObject& meta, QByteArray& body) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+        meta = QJsonDocument::fromJson(file.readLine()).object();
+        if (meta.isEmpty()) return false;
+        body = file.readAll();
+        return true;
+    }
+
+    static QFileInfoList cache_files() {
+        return QDir(cache_dir()).entryInfoList(QDir::Files, QDir::Time); // newest (most recently used) first
+    }
+
+    // deletes least recently used entries until the cache is well below the cap, s_mutex must be held
+    static void evict_locked() {
+        if (s_total_bytes < 0) {
+            s_total_bytes = 0;
+            for (const QFileInfo& info : cache_files()) s_total_bytes += info.size();
+        }
+        if (s_total_bytes <= kMaxBytes) return;
+
+        const QFileInfoList files = cache_files();
+        for (int i = files.size() - 1; i >= 0 && s_total_bytes > kMaxBytes * 3 / 4; --i) {
+            if (QFile::remove(files.at(i).filePath())) s_total_bytes -= files.at(i).size();
+        }
+        qDebug() << "HttpCache: evicted old entries, now" << s_total_bytes << "bytes";
+    }
+
+    Entry lookup(const QString& url) {
+        Entry entry;
+        const QString path = file_for(url);
+        QJsonObject meta;
+        QMutexLocker locker(&s_mutex);
+        if (!read_file(path, meta, entry.body) || meta.value("url").toString() != url) return entry;
+
+        entry.found = true;
+        entry.etag = meta.value("etag").toString().toUtf8();
+        entry.last_modified = meta.value("last_modified").toString().toUtf8();
+        entry.age_ms = QDateTime::currentMSecsSinceEpoch() - static_cast<qint64>(meta.value("fetched").toDouble());
+
+        QFile file(path); // the modification time is the LRU clock
+        if (file.open(QIODevice::ReadWrite)) file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+        return entry;
+    }
+
+    void store(const QString& url, const QByteArray& body, const QByteArray& etag, const QByteArray& last_modified) {
+        QJsonObject meta;
+        meta["url"] = url;
+        meta["etag"] = QString::fromUtf8(etag);
+        meta["last_modified"] = QString::fromUtf8(last_modified);
+        meta["fetched"] = static_cast<double>(QDateTime::currentMSecsSinceEpoch());
+
+        QMutexLocker locker(&s_mutex);
+        if (!QDir().mkpath(cache_dir())) {
+            qDebug() << "HttpCache: cannot create" << cache_dir();
+            return;
+        }
+        const QString path = file_for(url);
+        const qint64 old_size = QFileInfo(path).exists() ? QFileInfo(path).size() : 0;
+
+        QSaveFile file(path); // readers never see a half written entry
+        if (!file.open(QIODevice::WriteOnly)) return;
+        file.write(QJsonDocument(meta).toJson(QJsonDocument::Compact));
+        file.write("\n");
+        file.write(body);
+        if (!file.commit()) {
+            qDebug() << "HttpCache: cannot write" << path;
+            return;
+        }
+        if (s_total_bytes >= 0) s_total_bytes += QFileInfo(path).size() - old_size;
+        evict_locked();
+    }
+
+    void refresh(const QString& url) {
+        const Entry entry = lookup(url);
+        if (entry.found) store(url, entry.body, entry.etag, entry.last_modified);
+    }
+
+    QList<QPair<QString, QByteArray>> entries(const QString& url_prefix, int limit) {
+        QList<QPair<QString, QByteArray>> result;
+        QMutexLocker locker(&s_mutex);
+        for (const QFileInfo& info : cache_files()) {
+            if (result.size() >= limit) break;
+            QJsonObject meta;
+            QByteArray body;
+            if (!read_file(info.filePath(), meta, body)) continue;
+            const QString url = meta.value("url").toString();
+            if (url.startsWith(url_prefix)) result << qMakePair(url, body);
+        }
+        return result;
+    }
+}
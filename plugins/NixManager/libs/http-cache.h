@@ -0,0 +1,85 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef HTTP_CACHE_H
+#define HTTP_CACHE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+/**
+ * @brief Disk cache for HTTP GET responses, shared by all worker threads.
+ *
+ * Every response is one file in $XDG_CACHE_HOME/nixmanager/http, named after a hash
+ * of its URL. A file keeps the validators (ETag / Last-Modified) next to the body so a
+ * stale entry can be revalidated with a conditional request. Using an entry bumps its
+ * modification time, when the directory grows over kMaxBytes the least recently used
+ * entries are deleted.
+ */
+namespace HttpCache {
+
+    /**
+     * @brief Size cap of the cache directory.
+     */
+    const qint64 kMaxBytes = 32 * 1024 * 1024;
+
+    /**
+     * @brief A cached response.
+     */
+    struct Entry {
+        bool found = false;        ///< False if the URL is not cached (everything else is empty then).
+        QByteArray body;           ///< The response body.
+        QByteArray etag;           ///< ETag header of the response, may be empty.
+        QByteArray last_modified;  ///< Last-Modified header of the response, may be empty.
+        qint64 age_ms = 0;         ///< Time since the response was fetched or last revalidated.
+    };
+
+    /**
+     * @brief Directory of the cache files.
+     */
+    QString cache_dir();
+
+    /**
+     * @brief Looks up a URL and marks the entry as recently used.
+     */
+    Entry lookup(const QString& url);
+
+    /**
+     * @brief Stores (or replaces) the response for a URL, evicting old entries if the cache got too big.
+     */
+    void store(const QString& url, const QByteArray& body, const QByteArray& etag, const QByteArray& last_modified);
+
+    /**
+     * @brief Resets the age of an entry, used after the server answered 304 Not Modified.
+     */
+    void refresh(const QString& url);
+
+    /**
+     * @brief Cached responses of URLs starting with url_prefix, most recently used first.
+     * @param url_prefix e.g. "https://search.devbox.sh/v2/pkg?name=".
+     * @param limit Stop after this many entries.
+     * @return (url, body) pairs.
+     */
+    QList<QPair<QString, QByteArray>> entries(const QString& url_prefix, int limit);
+}
+
+#endif // HTTP_CACHE_H
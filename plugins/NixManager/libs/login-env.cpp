@@ -0,0 +1,98 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "login-env.h"
+#include "shell-pool.h"
+
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+
+namespace LoginEnvironment {
+
+    static QMutex s_mutex;
+    static QProcessEnvironment s_env;
+    static QString s_stamp;
+
+    // Evaluates the profile in a pooled session and parses `env -0` (NUL separated, so values may contain newlines).
+    static bool capture(QProcessEnvironment& env) {
+        ShellPool& pool = ShellPool::local();
+        ShellSession* session = pool.acquire();
+        if (!session) return false;
+        ShellResult result = session->run(QStringLiteral("env -0"));
+        pool.release(session);
+        if (!result.completed || result.truncated || result.exit_code != 0) return false;
+
+        for (const QByteArray& entry : result.std_out.split('\0')) {
+            int eq = entry.indexOf('=');
+            if (eq <= 0) continue;
+            env.insert(QString::fromUtf8(entry.left(eq)), QString::fromUtf8(entry.mid(eq + 1)));
+        }
+        env.remove(QStringLiteral("_")); // path of `env` itself
+        return !env.isEmpty();
+    }
+
+    QProcessEnvironment snapshot() {
+        const QString stamp = profile_stamp();
+        QMutexLocker locker(&s_mutex);
+        if (!s_env.isEmpty() && s_stamp == stamp) return s_env;
+
+        QProcessEnvironment env;
+        if (!capture(env)) {
+            qDebug() << "LoginEnvironment: could not evaluate the profile, using the plugin's own environment";
+            return QProcessEnvironment::systemEnvironment(); // not cached, next call tries again
+        }
+        if (!s_env.isEmpty()) qDebug() << "LoginEnvironment: profile changed, environment reloaded";
+        s_env = env;
+        s_stamp = stamp;
+        return s_env;
+    }
+
+    QString value(const QString& name, const QString& fallback) {
+        return snapshot().value(name, fallback);
+    }
+
+    QString home() {
+        return value(QStringLiteral("HOME"), QString::fromUtf8(qgetenv("HOME")));
+    }
+
+    // XDG_*_HOME must be absolute, relative values are ignored as the spec says.
+    static QString xdg_dir(const char* name, const QString& default_suffix) {
+        const QString dir = value(QString::fromLatin1(name));
+        if (dir.startsWith('/')) return dir;
+        return home() + default_suffix;
+    }
+
+    QString xdg_config_home() { return xdg_dir("XDG_CONFIG_HOME", QStringLiteral("/.config")); }
+    QString xdg_cache_home() { return xdg_dir("XDG_CACHE_HOME", QStringLiteral("/.cache")); }
+    QString xdg_data_home() { return xdg_dir("XDG_DATA_HOME", QStringLiteral("/.local/share")); }
+    QString xdg_state_home() { return xdg_dir("XDG_STATE_HOME", QStringLiteral("/.local/state")); }
+
+    QString find_executable(const QString& program) {
+        return QStandardPaths::findExecutable(program, value(QStringLiteral("PATH")).split(':', QString::SkipEmptyParts));
+    }
+
+    void invalidate() {
+        QMutexLocker locker(&s_mutex);
+        s_env = QProcessEnvironment();
+        s_stamp.clear();
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef LOGIN_ENV_H
+#define LOGIN_ENV_H
+
+#include <QProcessEnvironment>
+#include <QString>
+
+/**
+ * @brief Cached environment of the user's login shell.
+ *
+ * The profile ($HOME/.profile, which sources nix.sh once nix is installed) is
+ * evaluated once through a pooled ShellSession and the resulting environment
+ * (PATH, NIX_PATH, HOME, XDG dirs, nix.sh exports...) is shared by all threads.
+ * The snapshot is taken again as soon as .profile or nix.sh change on disk, so
+ * nothing has to start a shell just to learn a variable.
+ */
+namespace LoginEnvironment {
+    /**
+     * @brief Returns the current snapshot, taking a new one if the profile changed.
+     *
+     * Falls back to the plugin's own environment (not cached) if no shell can be started.
+     */
+    QProcessEnvironment snapshot();
+
+    /**
+     * @brief Value of one variable in the snapshot.
+     * @param name The variable name, e.g. "NIX_PATH".
+     * @param fallback Returned if the variable is not set.
+     */
+    QString value(const QString& name, const QString& fallback = QString());
+
+    /**
+     * @brief $HOME of the login environment.
+     */
+    QString home();
+
+    /**
+     * @brief XDG base directories, defaulting to $HOME/.config, $HOME/.cache, $HOME/.local/share and $HOME/.local/state.
+     */
+    QString xdg_config_home();
+    QString xdg_cache_home();
+    QString xdg_data_home();
+    QString xdg_state_home();
+
+    /**
+     * @brief Looks a program up in the PATH of the login environment.
+     * @return The absolute path, or an empty string if it is not installed.
+     */
+    QString find_executable(const QString& program);
+
+    /**
+     * @brief Drops the snapshot, the next call takes a new one.
+     */
+    void invalidate();
+}
+
+#endif // LOGIN_ENV_H
@@ -16,46 +16,198 @@
  */
 
 #include "openprocess.h"  
+#include "shell-pool.h"
+#include "process-group.h"
+#include "output-capture.h"
 
+#include <QStandardPaths>
 
-std::tuple<bool, QStringList, QStringList>
-exec_bash(const QString& command) {
+
+// Splits the captured output tails into lines and appends the exit code error, shared by the session and one-shot paths.
+static std::tuple<bool, QStringList, QStringList>
+finish_result(const QString& command, bool exited_normally, int exitCode, const QByteArray& stdoutData, const QByteArray& stderrData,
+              bool truncated = false) {
     QStringList output;
     QStringList full_error;
-    QString cmd = QString("source %1/.profile && %2")
-                  .arg(QString::fromUtf8(qgetenv("HOME")))
-                  .arg(command);
 
-    QProcess proc;
-    proc.start("/bin/bash", QStringList() << "-c" << cmd);
-    if (!proc.waitForStarted()) {
-        full_error << QString("Failed to start process: %1").arg(proc.errorString());
-        return {false, output, full_error};
+    if (truncated) { // only the tail is kept in memory, point at the complete transcript
+        OperationContext::Scope* scope = OperationContext::current();
+        const QString log_path = scope ? scope->log_path() : QString();
+        full_error << (log_path.isEmpty() ? QStringLiteral("[earlier output dropped]")
+                                          : QString("[earlier output dropped, full log: %1]").arg(log_path));
     }
 
-    // Block until finished
-    proc.waitForFinished(-1);
-
     // Read and split stdout into lines
-    QByteArray stdoutData = proc.readAllStandardOutput();
     if (!stdoutData.isEmpty()) {
         const QString stdoutText = QString::fromUtf8(stdoutData);
         output.append(stdoutText.split(QRegExp("\r?\n"), QString::SkipEmptyParts)); // remove trailing line
     }
 
     // Read and split stderr into lines
-    QByteArray stderrData = proc.readAllStandardError();
     if (!stderrData.isEmpty()) {
         const QString stderrText = QString::fromUtf8(stderrData);
         full_error.append(stderrText.split(QRegExp("\r?\n"), QString::SkipEmptyParts));
     }
 
-    int exitCode = proc.exitCode();
-    bool success = (proc.exitStatus() == QProcess::NormalExit && exitCode == 0);
+    bool success = (exited_normally && exitCode == 0);
 
     if (!success) {
         full_error << QString("'%1' exited with error code: %2").arg(command, QString::number(exitCode));
     }
 
     return {success, output, full_error};
-}
\ No newline at end of file
+}
+
+// Runs a started process to completion, streaming its lines and killing its process group when the request is interrupted.
+static std::tuple<bool, QStringList, QStringList>
+wait_grouped(GroupedProcess& proc, const QString& command, const LineSink& sink, const LineTransform& transform = LineTransform()) {
+    OperationLog* log = OperationContext::log();
+    if (log) log->begin_command(command);
+    OutputCapture out(QStringLiteral("stdout"), sink, log, QByteArray(), transform);
+    OutputCapture err(QStringLiteral("stderr"), sink, log, QByteArray(), transform);
+    OperationContext::Interruption interrupted = OperationContext::Interruption::None;
+
+    // Block until finished, handing out lines as they come in
+    while (proc.state() != QProcess::NotRunning && !proc.waitForFinished(100)) {
+        out.feed(proc.readAllStandardOutput());
+        err.feed(proc.readAllStandardError());
+
+        if (interrupted == OperationContext::Interruption::None
+            && (interrupted = OperationContext::interruption()) != OperationContext::Interruption::None) {
+            terminate_process_group(proc.processId());
+        }
+    }
+    out.feed(proc.readAllStandardOutput());
+    err.feed(proc.readAllStandardError());
+    out.finish();
+    err.finish();
+    if (log) log->end_command(proc.exitCode());
+
+    auto [success, output, full_error] = finish_result(command, proc.exitStatus() == QProcess::NormalExit, proc.exitCode(),
+                                                       out.tail().tail(), err.tail().tail(),
+                                                       out.tail().truncated() || err.tail().truncated());
+    if (interrupted != OperationContext::Interruption::None) {
+        full_error << OperationContext::interruption_message(interrupted);
+        return {false, output, full_error};
+    }
+    return {success, output, full_error};
+}
+
+// Refuses to start anything new once the current request was cancelled or timed out.
+static bool refuse_if_interrupted(const QString& command, QStringList& full_error) {
+    OperationContext::Interruption interrupted = OperationContext::interruption();
+    if (interrupted == OperationContext::Interruption::None) return false;
+    full_error << QString("'%1' was not started: %2").arg(command, OperationContext::interruption_message(interrupted));
+    return true;
+}
+
+std::tuple<bool, QStringList, QStringList>
+exec_bash_oneshot(const QString& command, const LineSink& sink) {
+    QString cmd = QString("source %1/.profile && %2")
+                  .arg(QString::fromUtf8(qgetenv("HOME")))
+                  .arg(command);
+
+    GroupedProcess proc; // own process group, so a cancel also reaches nix's children
+    proc.start("/bin/bash", QStringList() << "-c" << cmd);
+    if (!proc.waitForStarted()) {
+        return {false, QStringList(), QStringList(QString("Failed to start process: %1").arg(proc.errorString()))};
+    }
+
+    return wait_grouped(proc, command, sink);
+}
+
+std::tuple<bool, QStringList, QStringList>
+exec_bash_streaming(const QString& command, const LineSink& sink) {
+    QStringList refused;
+    if (refuse_if_interrupted(command, refused)) return {false, QStringList(), refused};
+
+    ShellPool& pool = ShellPool::local();
+    ShellSession* session = pool.acquire();
+    if (!session) {
+        // a session start can be cut short by the cancel/timeout itself, don't start the command then.
+        if (refuse_if_interrupted(command, refused)) return {false, QStringList(), refused};
+        // no warm shell could be started, behave exactly like before.
+        return exec_bash_oneshot(command, sink);
+    }
+
+    ShellResult result = session->run(command, sink, OperationContext::log());
+    pool.release(session); // recycles the session if it died
+
+    if (result.interrupted != OperationContext::Interruption::None) {
+        auto [success, output, full_error] = finish_result(command, false, result.exit_code, result.std_out, result.std_err, result.truncated);
+        full_error << OperationContext::interruption_message(result.interrupted);
+        return {false, output, full_error};
+    }
+
+    if (!result.completed) {
+        // the command may have partially run, so it is not retried.
+        auto [success, output, full_error] = finish_result(command, false, result.exit_code, result.std_out, result.std_err, result.truncated);
+        full_error.insert(full_error.size() - 1, QStringLiteral("Shell session terminated unexpectedly."));
+        return {false, output, full_error};
+    }
+
+    return finish_result(command, true, result.exit_code, result.std_out, result.std_err, result.truncated);
+}
+
+std::tuple<bool, QStringList, QStringList>
+exec_bash(const QString& command) {
+    // streams to whoever is listening on the current request (the Worker), if anyone.
+    return exec_bash_streaming(command, OperationContext::line_sink());
+}
+
+// Starts program without a shell, shared by exec_direct and exec_direct_to_file.
+// stdout goes to stdout_path if one is given, otherwise it is read by wait_grouped.
+static bool
+start_direct(GroupedProcess& proc, const QString& command, const QString& program, const QStringList& arguments,
+             const QProcessEnvironment& environment, const QString& stdout_path, QStringList& full_error) {
+    if (refuse_if_interrupted(command, full_error)) return false;
+
+    // resolve against the PATH the program will see, not the plugin's own one
+    const QString executable = QStandardPaths::findExecutable(program,
+        environment.value(QStringLiteral("PATH")).split(':', QString::SkipEmptyParts));
+    if (executable.isEmpty()) {
+        full_error << QString("'%1' not found in PATH, is nix installed?").arg(program);
+        return false;
+    }
+
+    proc.setProcessEnvironment(environment);
+    proc.setStandardInputFile(QProcess::nullDevice());
+    if (!stdout_path.isEmpty()) {
+        proc.setStandardOutputFile(stdout_path, QIODevice::Truncate); // nothing reaches the sink or the log
+    }
+    proc.start(executable, arguments);
+    if (!proc.waitForStarted()) {
+        full_error << QString("Failed to start process: %1").arg(proc.errorString());
+        return false;
+    }
+    return true;
+}
+
+std::tuple<bool, QStringList, QStringList>
+exec_direct(const QString& program, const QStringList& arguments, const QProcessEnvironment& environment,
+            const LineTransform& transform) {
+    // only used for messages, the arguments are passed to the program untouched
+    const QString command = (QStringList() << program << arguments).join(' ');
+
+    GroupedProcess proc;
+    QStringList full_error;
+    if (!start_direct(proc, command, program, arguments, environment, QString(), full_error)) {
+        return {false, QStringList(), full_error};
+    }
+
+    return wait_grouped(proc, command, OperationContext::line_sink(), transform);
+}
+
+std::tuple<bool, QStringList, QStringList>
+exec_direct_to_file(const QString& program, const QStringList& arguments, const QString& stdout_path,
+                    const QProcessEnvironment& environment) {
+    const QString command = (QStringList() << program << arguments).join(' ') + " > " + stdout_path;
+
+    GroupedProcess proc;
+    QStringList full_error;
+    if (!start_direct(proc, command, program, arguments, environment, stdout_path, full_error)) {
+        return {false, QStringList(), full_error};
+    }
+
+    return wait_grouped(proc, command, OperationContext::line_sink());
+}
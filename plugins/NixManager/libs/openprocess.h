@@ -24,27 +24,100 @@
 #define OPENPROCESS_H
 
 #include <QProcess>
+#include <QProcessEnvironment>
 #include <QString>
 #include <QStringList>
 #include <QTextStream>
 #include <QRegExp>
+#include "operation-context.h"
+#include "login-env.h"
+#include "output-capture.h"
 
 /**
  * @brief Executes a shell command and captures its standard output and standard error.
  *
- * This function utilizes `openProcess` to run the specified shell command, capturing
- * both the standard output and standard error in separate vectors. It evaluates the
- * exit code to determine the success of the command execution. If the command fails,
- * an error message is appended to the standard error vector.
+ * The command is sent to a warm bash session from the calling thread's ShellPool,
+ * which sourced $HOME/.profile once when it started, instead of forking a fresh
+ * `bash -c` and re-sourcing the profile for every call. If no session can be
+ * started it falls back to exec_bash_oneshot(). It evaluates the exit code to
+ * determine the success of the command execution. If the command fails, an error
+ * message is appended to the standard error list.
  *
- * @note This implementation assumes that `openProcess` is defined elsewhere and handles
- * the actual process creation and output capturing.
+ * While a request is running (see OperationContext) every output line is also
+ * streamed to that request's line sink as it is produced. If the request gets
+ * cancelled or runs past its timeout the command is killed together with its
+ * whole process group, and the result fails with the interruption message as the
+ * last stderr line. Once a request was interrupted no further commands are started.
  *
  * @param command The shell command string to execute.
- * @return A tuple containing a boolean indicating success, a vector of strings for
- * the command's stdout, and a vector of strings for the command's stderr.
+ * @return A tuple containing a boolean indicating success, a list of strings for
+ * the command's stdout, and a list of strings for the command's stderr.
  */
 std::tuple<bool, QStringList, QStringList>
 exec_bash(const QString& command);
 
+/**
+ * @brief Same as exec_bash(), but delivers output to an explicit sink line by line.
+ *
+ * The full stdout/stderr are still returned once the command finished, the sink
+ * only gets an early look at every line as soon as it was written.
+ *
+ * @param command The shell command string to execute.
+ * @param sink Callback that receives each line together with its stream name, may be empty.
+ * @return A tuple containing a boolean indicating success, a list of strings for
+ * the command's stdout, and a list of strings for the command's stderr.
+ */
+std::tuple<bool, QStringList, QStringList>
+exec_bash_streaming(const QString& command, const LineSink& sink);
+
+/**
+ * @brief Executes a shell command in a fresh `bash -c` that sources $HOME/.profile first.
+ *
+ * Same contract as exec_bash_streaming(), without reusing a pooled session.
+ *
+ * @param command The shell command string to execute.
+ * @param sink Callback that receives each line together with its stream name, may be empty.
+ * @return A tuple containing a boolean indicating success, a list of strings for
+ * the command's stdout, and a list of strings for the command's stderr.
+ */
+std::tuple<bool, QStringList, QStringList>
+exec_bash_oneshot(const QString& command, const LineSink& sink = LineSink());
+
+/**
+ * @brief Starts a program directly with an argv list, without a shell in between.
+ *
+ * Nothing is parsed or expanded, so user supplied arguments (channel names,
+ * generation ids, search terms...) reach the program exactly as given. The program
+ * is looked up in the PATH of the given environment. Output streaming, cancellation
+ * and timeouts behave exactly like exec_bash().
+ *
+ * @param program Name (or path) of the executable, e.g. "nix-channel".
+ * @param arguments The arguments, one list entry per argv element.
+ * @param environment The complete environment of the child, usually LoginEnvironment::snapshot() plus extras.
+ * @param transform Optional rewrite of output lines before they are kept in the result and the log,
+ * the progress sink still sees them unchanged.
+ * @return A tuple containing a boolean indicating success, a list of strings for
+ * the command's stdout, and a list of strings for the command's stderr.
+ */
+std::tuple<bool, QStringList, QStringList>
+exec_direct(const QString& program, const QStringList& arguments, const QProcessEnvironment& environment = LoginEnvironment::snapshot(),
+            const LineTransform& transform = LineTransform());
+
+/**
+ * @brief Same as exec_direct(), but writes the program's stdout straight into a file.
+ *
+ * For commands with very large output (e.g. a JSON dump of all of nixpkgs) that should
+ * neither sit in memory nor end up in the request log. stderr is captured as usual.
+ *
+ * @param program Name (or path) of the executable, e.g. "nix-env".
+ * @param arguments The arguments, one list entry per argv element.
+ * @param stdout_path File that receives stdout, truncated first.
+ * @param environment The complete environment of the child, usually LoginEnvironment::snapshot() plus extras.
+ * @return A tuple containing a boolean indicating success, an empty list (stdout went to the file)
+ * and a list of strings for the command's stderr.
+ */
+std::tuple<bool, QStringList, QStringList>
+exec_direct_to_file(const QString& program, const QStringList& arguments, const QString& stdout_path,
+                    const QProcessEnvironment& environment = LoginEnvironment::snapshot());
+
 #endif // OPENPROCESS_H
\ No newline at end of file
@@ -0,0 +1,135 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "operation-context.h"
+#include "output-capture.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace OperationContext {
+
+    static thread_local Scope* t_current = nullptr;
+
+    // requests that were submitted but have not finished yet, shared between Controller and worker threads.
+    static QMutex s_requests_mutex;
+    static QHash<QString, CancelToken> s_requests;
+
+    CancelState::CancelState(qint64 timeout_ms)
+        : m_reason(static_cast<int>(Interruption::None)), m_timeout_ms(timeout_ms)
+    {
+    }
+
+    void CancelState::cancel(Interruption reason) {
+        int expected = static_cast<int>(Interruption::None);
+        m_reason.compare_exchange_strong(expected, static_cast<int>(reason));
+    }
+
+    void CancelState::start_clock() {
+        m_clock.start();
+    }
+
+    Interruption CancelState::reason() const {
+        return static_cast<Interruption>(m_reason.load());
+    }
+
+    Interruption CancelState::check() {
+        if (m_reason.load() == static_cast<int>(Interruption::None)
+            && m_timeout_ms > 0 && m_clock.isValid() && m_clock.hasExpired(m_timeout_ms)) {
+            cancel(Interruption::TimedOut);
+        }
+        return static_cast<Interruption>(m_reason.load());
+    }
+
+    CancelToken register_request(const QVariant& requestId, qint64 timeout_ms) {
+        CancelToken token = std::make_shared<CancelState>(timeout_ms);
+        QMutexLocker locker(&s_requests_mutex);
+        s_requests.insert(requestId.toString(), token);
+        return token;
+    }
+
+    CancelToken find_request(const QVariant& requestId) {
+        QMutexLocker locker(&s_requests_mutex);
+        return s_requests.value(requestId.toString());
+    }
+
+    bool cancel_request(const QVariant& requestId, Interruption reason) {
+        CancelToken token = find_request(requestId);
+        if (!token) return false;
+        token->cancel(reason);
+        return true;
+    }
+
+    void unregister_request(const QVariant& requestId) {
+        QMutexLocker locker(&s_requests_mutex);
+        s_requests.remove(requestId.toString());
+    }
+
+    QString interruption_message(Interruption reason) {
+        switch (reason) {
+        case Interruption::Cancelled: return QStringLiteral("Operation cancelled.");
+        case Interruption::TimedOut: return QStringLiteral("Operation timed out.");
+        case Interruption::Superseded: return QStringLiteral("Operation superseded by a newer request.");
+        default: return QString();
+        }
+    }
+
+    Scope::Scope(const QVariant& requestId, const QString& operation, LineSink sink, CancelToken cancel, PartialSink partial)
+        : request_id(requestId), operation(operation), sink(std::move(sink)), cancel(std::move(cancel)),
+          partial(std::move(partial)), m_previous(t_current)
+    {
+        t_current = this;
+    }
+
+    Scope::~Scope() {
+        t_current = m_previous;
+    }
+
+    OperationLog* Scope::log() {
+        if (!m_log) m_log.reset(new OperationLog(operation));
+        return m_log.get();
+    }
+
+    QString Scope::log_path() const {
+        return m_log ? m_log->path() : QString();
+    }
+
+    Scope* current() {
+        return t_current;
+    }
+
+    LineSink line_sink() {
+        return t_current ? t_current->sink : LineSink();
+    }
+
+    void report_partial(const QString& partialJson) {
+        if (t_current && t_current->partial) t_current->partial(partialJson);
+    }
+
+    OperationLog* log() {
+        return t_current ? t_current->log() : nullptr;
+    }
+
+    Interruption interruption() {
+        if (!t_current || !t_current->cancel) return Interruption::None;
+        return t_current->cancel->check();
+    }
+}
@@ -0,0 +1,201 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef OPERATION_CONTEXT_H
+#define OPERATION_CONTEXT_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <QElapsedTimer>
+#include <QString>
+#include <QByteArray>
+#include <QVariant>
+
+/**
+ * @brief Callback that receives every output line of a running process.
+ *
+ * @param stream Either "stdout" or "stderr".
+ * @param line One line of output, without the trailing newline.
+ */
+using LineSink = std::function<void(const QString& stream, const QString& line)>;
+
+/**
+ * @brief Callback that receives a partial result of a running request (e.g. one search hit).
+ *
+ * @param partialJson JSON string, its layout depends on the operation.
+ */
+using PartialSink = std::function<void(const QString& partialJson)>;
+
+class OperationLog;
+
+/**
+ * @brief Per-thread information about the request the current thread is working on.
+ *
+ * The Worker opens a Scope around every WorkerLogic call, so code deep in the
+ * nix-layer (e.g. exec_bash) can stream its output back to the request without
+ * threading extra parameters through every function signature.
+ */
+namespace OperationContext {
+
+    /**
+     * @brief Why a request stopped before it was done.
+     */
+    enum class Interruption {
+        None = 0,
+        Cancelled,  ///< Controller::cancel() was called for the request.
+        TimedOut,   ///< The request ran longer than its operation's timeout.
+        Superseded  ///< A newer request of the same search session replaced it.
+    };
+
+    /**
+     * @brief Cancel/timeout state of one request.
+     *
+     * Created by the Controller when a request is submitted and polled by the worker
+     * thread while it runs, so cancel() is the only member that is called across threads.
+     */
+    class CancelState {
+    public:
+        /**
+         * @param timeout_ms Maximum run time of the request once started, 0 means no limit.
+         */
+        explicit CancelState(qint64 timeout_ms = 0);
+
+        /**
+         * @brief Marks the request as interrupted, the first reason wins.
+         */
+        void cancel(Interruption reason);
+
+        /**
+         * @brief Starts the timeout clock, called when a worker picks the request up.
+         */
+        void start_clock();
+
+        /**
+         * @brief Returns the interruption reason, turning an expired timeout into TimedOut.
+         */
+        Interruption check();
+
+        /**
+         * @brief Returns the interruption reason as set so far, safe to call from any thread.
+         */
+        Interruption reason() const;
+
+    private:
+        std::atomic<int> m_reason;
+        qint64 m_timeout_ms;
+        QElapsedTimer m_clock;
+    };
+
+    using CancelToken = std::shared_ptr<CancelState>;
+
+    /**
+     * @brief Creates and remembers the cancel state for a newly submitted request.
+     * @param requestId The request identifier QML used.
+     * @param timeout_ms Maximum run time once the request started, 0 means no limit.
+     */
+    CancelToken register_request(const QVariant& requestId, qint64 timeout_ms);
+
+    /**
+     * @brief Returns the cancel state of a submitted request (nullptr if unknown).
+     */
+    CancelToken find_request(const QVariant& requestId);
+
+    /**
+     * @brief Cancels a queued or running request.
+     * @param reason Reported in the request's result (Cancelled or Superseded).
+     * @return True if the request was known (i.e. not finished yet).
+     */
+    bool cancel_request(const QVariant& requestId, Interruption reason = Interruption::Cancelled);
+
+    /**
+     * @brief Forgets a finished request.
+     */
+    void unregister_request(const QVariant& requestId);
+
+    /**
+     * @brief Human readable message for an interruption reason.
+     */
+    QString interruption_message(Interruption reason);
+
+    /**
+     * @brief RAII guard that makes a request current for the calling thread.
+     *
+     * Scopes nest, the previous request becomes current again when a Scope is destroyed.
+     */
+    class Scope {
+    public:
+        Scope(const QVariant& requestId, const QString& operation, LineSink sink, CancelToken cancel = CancelToken(),
+              PartialSink partial = PartialSink());
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        /**
+         * @brief The request's on-disk output log, created on first use.
+         */
+        OperationLog* log();
+
+        /**
+         * @brief Path of the request's log file, empty if nothing was logged.
+         */
+        QString log_path() const;
+
+        QVariant request_id;
+        QString operation;
+        LineSink sink;
+        CancelToken cancel;
+        PartialSink partial;
+
+    private:
+        Scope* m_previous;
+        std::unique_ptr<OperationLog> m_log;
+    };
+
+    /**
+     * @brief Returns the Scope of the calling thread, or nullptr outside of a request.
+     */
+    Scope* current();
+
+    /**
+     * @brief Returns the line sink of the current request (empty if nobody listens).
+     */
+    LineSink line_sink();
+
+    /**
+     * @brief Hands a partial result of the current request to whoever listens (no-op outside of a request).
+     */
+    void report_partial(const QString& partialJson);
+
+    /**
+     * @brief Returns the output log of the current request (nullptr outside of a request).
+     */
+    OperationLog* log();
+
+    /**
+     * @brief Checks whether the current request was cancelled or ran out of time.
+     *
+     * Long running loops (process output, network replies) poll this and stop early.
+     */
+    Interruption interruption();
+}
+
+#endif // OPERATION_CONTEXT_H
@@ -0,0 +1,193 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "output-capture.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+
+#include <cstring>
+
+TailBuffer::TailBuffer(int capacity)
+    : m_ring(capacity, '\0'), m_start(0), m_size(0), m_total(0)
+{
+}
+
+void TailBuffer::append(const QByteArray& data) {
+    const int capacity = m_ring.size();
+    m_total += data.size();
+
+    // only the last `capacity` bytes can survive anyway
+    const char* src = data.constData();
+    int len = data.size();
+    if (len >= capacity) {
+        src += len - capacity;
+        len = capacity;
+    }
+
+    int write_pos = (m_start + m_size) % capacity;
+    int first = qMin(len, capacity - write_pos);
+    memcpy(m_ring.data() + write_pos, src, first);
+    memcpy(m_ring.data(), src + first, len - first);
+
+    int overflow = m_size + len - capacity;
+    if (overflow > 0) {
+        m_start = (m_start + overflow) % capacity;
+        m_size = capacity;
+    } else {
+        m_size += len;
+    }
+}
+
+QByteArray TailBuffer::tail() const {
+    const int capacity = m_ring.size();
+    QByteArray out;
+    out.reserve(m_size);
+    int first = qMin(m_size, capacity - m_start);
+    out.append(m_ring.constData() + m_start, first);
+    out.append(m_ring.constData(), m_size - first);
+
+    if (truncated()) {
+        int eol = out.indexOf('\n');
+        if (eol != -1) out.remove(0, eol + 1);
+    }
+    return out;
+}
+
+OperationLog::OperationLog(const QString& operation)
+    : m_operation(operation), m_failed(false), m_written(0)
+{
+}
+
+QString OperationLog::log_dir() {
+    // the plugin's own environment, the login environment may be the thing being captured
+    QString state_home = QString::fromUtf8(qgetenv("XDG_STATE_HOME"));
+    if (!state_home.startsWith('/')) state_home = QString::fromUtf8(qgetenv("HOME")) + "/.local/state";
+    return state_home + "/nixmanager/logs";
+}
+
+bool OperationLog::ensure_open() {
+    if (m_file.isOpen()) return true;
+    if (m_failed) return false;
+
+    QDir dir(log_dir());
+    if (!dir.mkpath(QStringLiteral("."))) {
+        qDebug() << "OperationLog: cannot create" << dir.path();
+        m_failed = true;
+        return false;
+    }
+
+    // rotate, names start with the time so sorting by name is sorting by age
+    QStringList logs = dir.entryList(QStringList() << QStringLiteral("*.log"), QDir::Files, QDir::Name);
+    while (logs.size() >= kMaxFiles) {
+        dir.remove(logs.takeFirst());
+    }
+
+    QString name = m_operation.isEmpty() ? QStringLiteral("operation") : m_operation;
+    m_file.setFileName(dir.filePath(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss-zzz"))
+                                    + '-' + name + ".log"));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qDebug() << "OperationLog: cannot open" << m_file.fileName() << m_file.errorString();
+        m_failed = true;
+        return false;
+    }
+    return true;
+}
+
+void OperationLog::write_raw(const QByteArray& data) {
+    if (m_written >= kMaxBytes || !ensure_open()) return;
+    if (m_written + data.size() >= kMaxBytes) {
+        m_file.write("\n[log truncated, size limit reached]\n");
+        m_written = kMaxBytes;
+        m_file.flush();
+        return;
+    }
+    m_written += m_file.write(data);
+}
+
+void OperationLog::begin_command(const QString& command) {
+    write_raw("$ " + command.toUtf8() + '\n');
+}
+
+void OperationLog::end_command(int exit_code) {
+    write_raw("[exit code " + QByteArray::number(exit_code) + "]\n");
+    if (m_file.isOpen()) m_file.flush();
+}
+
+void OperationLog::write_line(const QByteArray& line) {
+    write_raw(line + '\n');
+}
+
+QString OperationLog::path() const {
+    return m_file.isOpen() ? m_file.fileName() : QString();
+}
+
+OutputCapture::OutputCapture(const QString& stream, const LineSink& sink, OperationLog* log, const QByteArray& marker,
+                             const LineTransform& transform)
+    : m_stream(stream), m_sink(sink), m_log(log), m_marker(marker), m_transform(transform), m_marker_seen(false)
+{
+}
+
+void OutputCapture::feed(const QByteArray& chunk) {
+    if (m_marker_seen || chunk.isEmpty()) return;
+    m_pending.append(chunk);
+
+    int begin = 0;
+    int eol;
+    while (!m_marker_seen && (eol = m_pending.indexOf('\n', begin)) != -1) {
+        take_line(m_pending.mid(begin, eol - begin));
+        begin = eol + 1;
+    }
+    m_pending.remove(0, begin);
+
+    if (!m_marker_seen && m_pending.size() > kMaxLineBytes) {
+        take_line(m_pending);
+        m_pending.clear();
+    }
+}
+
+void OutputCapture::finish() {
+    if (!m_marker_seen && !m_pending.isEmpty()) take_line(m_pending);
+    m_pending.clear();
+}
+
+void OutputCapture::take_line(const QByteArray& raw_line) {
+    if (!m_marker.isEmpty() && raw_line.startsWith(m_marker)) {
+        m_marker_seen = true;
+        m_marker_line = raw_line;
+        return;
+    }
+
+    const QByteArray kept = m_transform ? m_transform(raw_line) : raw_line;
+    if (!kept.isEmpty() || raw_line.isEmpty()) {
+        m_tail.append(kept + '\n');
+        if (m_log) m_log->write_line(kept);
+    }
+
+    if (!m_sink) return;
+    // progress bars redraw with \r, only the last state of the line is interesting.
+    QByteArray line = raw_line;
+    while (line.endsWith('\r')) line.chop(1);
+    int cr = line.lastIndexOf('\r');
+    if (cr != -1) line = line.mid(cr + 1);
+    if (line.trimmed().isEmpty()) return;
+    m_sink(m_stream, QString::fromUtf8(line));
+}
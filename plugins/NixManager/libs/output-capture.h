@@ -0,0 +1,159 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef OUTPUT_CAPTURE_H
+#define OUTPUT_CAPTURE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include "operation-context.h"
+
+/**
+ * @brief Rewrites a raw output line before it is kept in the tail and the log, an empty result drops the line.
+ */
+using LineTransform = std::function<QByteArray(const QByteArray& line)>;
+
+/**
+ * @brief Fixed size byte ring that keeps only the newest output of a stream.
+ *
+ * Memory use of a command's output is bounded by the capacity no matter how much
+ * it prints, the complete transcript lives in the OperationLog.
+ */
+class TailBuffer {
+public:
+    static const int kDefaultCapacity = 64 * 1024;
+
+    explicit TailBuffer(int capacity = kDefaultCapacity);
+
+    void append(const QByteArray& data);
+
+    /**
+     * @brief The kept bytes, oldest first. Once older output was dropped the
+     * (partial) first line is cut off as well.
+     */
+    QByteArray tail() const;
+
+    /**
+     * @brief True if output was dropped because the buffer was full.
+     */
+    bool truncated() const { return m_total > m_size; }
+
+private:
+    QByteArray m_ring;
+    int m_start;    // index of the oldest byte
+    int m_size;     // bytes currently kept
+    qint64 m_total; // bytes ever appended
+};
+
+/**
+ * @brief Full transcript of one request's processes on disk.
+ *
+ * Written to $XDG_STATE_HOME/nixmanager/logs/<time>-<operation>.log, the file is
+ * only created once the first line arrives. Only the newest kMaxFiles logs are
+ * kept and a single log stops growing at kMaxBytes.
+ */
+class OperationLog {
+public:
+    static const int kMaxFiles = 20;
+    static const qint64 kMaxBytes = 64 * 1024 * 1024;
+
+    explicit OperationLog(const QString& operation);
+
+    /**
+     * @brief Writes a "$ command" header so the commands of a request can be told apart.
+     */
+    void begin_command(const QString& command);
+
+    /**
+     * @brief Writes a "[exit code N]" footer and flushes the file.
+     */
+    void end_command(int exit_code);
+
+    /**
+     * @brief Appends one raw output line (without its newline).
+     */
+    void write_line(const QByteArray& line);
+
+    /**
+     * @brief Path of the log file, empty as long as nothing was written (or the file could not be created).
+     */
+    QString path() const;
+
+    /**
+     * @brief Directory all logs are written to.
+     */
+    static QString log_dir();
+
+private:
+    bool ensure_open();
+    void write_raw(const QByteArray& data);
+
+    QString m_operation;
+    QFile m_file;
+    bool m_failed;
+    qint64 m_written;
+};
+
+/**
+ * @brief Takes the raw output of one stream (stdout or stderr) of a running process.
+ *
+ * Every complete line is forwarded to the LineSink (progress), written to the
+ * OperationLog (full transcript) and kept in a TailBuffer (result), so the
+ * process output is never held in memory as a whole.
+ * An optional LineTransform rewrites what is kept (the sink always sees the raw line),
+ * e.g. to turn machine readable nix log events back into readable text.
+ * A line starting with the optional marker ends the capture, it is not forwarded
+ * anywhere and can be read back through marker_line().
+ */
+class OutputCapture {
+public:
+    // a line longer than this (e.g. a progress bar without newlines) is passed on in pieces
+    static const int kMaxLineBytes = 64 * 1024;
+
+    OutputCapture(const QString& stream, const LineSink& sink, OperationLog* log, const QByteArray& marker = QByteArray(),
+                  const LineTransform& transform = LineTransform());
+
+    void feed(const QByteArray& chunk);
+
+    /**
+     * @brief Passes on an unterminated last line, call once the process finished.
+     */
+    void finish();
+
+    bool marker_seen() const { return m_marker_seen; }
+    const QByteArray& marker_line() const { return m_marker_line; }
+    const TailBuffer& tail() const { return m_tail; }
+
+private:
+    void take_line(const QByteArray& raw_line);
+
+    QString m_stream;
+    LineSink m_sink;
+    OperationLog* m_log;
+    QByteArray m_marker;
+    LineTransform m_transform;
+    QByteArray m_pending;
+    TailBuffer m_tail;
+    bool m_marker_seen;
+    QByteArray m_marker_line;
+};
+
+#endif // OUTPUT_CAPTURE_H
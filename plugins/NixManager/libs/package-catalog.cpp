@@ -0,0 +1,468 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "package-catalog.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QPair>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace PackageCatalog {
+
+    static const char kMagic[8] = {'N', 'I', 'X', 'M', 'C', 'A', 'T', '\0'};
+
+    struct StringRef {
+        quint32 offset;
+        quint32 length;
+    };
+
+    struct FileHeader {
+        char magic[8];
+        quint32 version;
+        quint32 record_count;
+        quint32 trigram_count;
+        quint32 reserved;
+        quint64 records_offset;   // FileRecord[record_count]
+        quint64 trigrams_offset;  // FileTrigram[trigram_count]
+        quint64 postings_offset;  // varint deltas
+        quint64 postings_size;
+        quint64 strings_offset;   // string pool
+        quint64 strings_size;
+    };
+
+    struct FileRecord {
+        StringRef attr;
+        StringRef name;
+        StringRef version;
+        StringRef description;
+        StringRef platforms;
+        quint32 flags;
+        quint32 reserved;
+    };
+
+    struct FileTrigram {
+        quint32 key;           // three lowercase bytes
+        quint32 count;         // number of records
+        quint32 postings;      // byte offset into the postings section
+        quint32 postings_size; // bytes
+    };
+
+    static inline char lower(char c) {
+        return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c; // bytes of UTF-8 sequences stay as they are
+    }
+
+    static inline quint32 trigram_key(const char* p) {
+        return (quint32(uchar(p[0])) << 16) | (quint32(uchar(p[1])) << 8) | quint32(uchar(p[2]));
+    }
+
+    // unique trigrams of a lowercase text, sorted
+    static void collect_trigrams(const QByteArray& lower_text, QVector<quint32>& keys) {
+        keys.clear();
+        const char* data = lower_text.constData();
+        for (int i = 0; i + 3 <= lower_text.size(); ++i) {
+            if (data[i] == '\n' || data[i + 1] == '\n' || data[i + 2] == '\n') continue; // spans two fields
+            keys << trigram_key(data + i);
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    // what a search term is matched against
+    static QByteArray searchable(const Package& package) {
+        return package.attr.toLower() + '\n' + package.name.toLower() + '\n' + package.description.toLower();
+    }
+
+    static void put_varint(QByteArray& out, quint32 value) {
+        while (value >= 0x80) {
+            out.append(char((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.append(char(value));
+    }
+
+    static quint64 align8(quint64 value) {
+        return (value + 7) & ~quint64(7);
+    }
+
+    bool write(const QString& path, QVector<Package>& packages, QString& error) {
+        // sorted by lowercased attribute path, so prefix lookups are a binary search
+        QVector<QByteArray> sort_keys;
+        sort_keys.reserve(packages.size());
+        for (const Package& package : packages) sort_keys << package.attr.toLower();
+        QVector<int> order(packages.size());
+        for (int i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            const int cmp = qstrcmp(sort_keys.at(a), sort_keys.at(b));
+            return cmp != 0 ? cmp < 0 : packages.at(a).attr < packages.at(b).attr;
+        });
+        QVector<Package> sorted;
+        sorted.reserve(packages.size());
+        for (int index : order) sorted << packages.at(index);
+        packages.swap(sorted);
+        sort_keys.clear();
+
+        // string pool, every distinct string once (versions, platform lists and descriptions repeat a lot)
+        QByteArray pool;
+        QHash<QByteArray, quint32> interned;
+        auto intern = [&](const QByteArray& value) -> StringRef {
+            if (value.isEmpty()) return StringRef{0, 0};
+            auto it = interned.constFind(value);
+            if (it != interned.constEnd()) return StringRef{it.value(), quint32(value.size())};
+            const quint32 offset = quint32(pool.size());
+            pool.append(value);
+            interned.insert(value, offset);
+            return StringRef{offset, quint32(value.size())};
+        };
+
+        QVector<FileRecord> records(packages.size());
+        for (int i = 0; i < packages.size(); ++i) {
+            const Package& package = packages.at(i);
+            FileRecord& record = records[i];
+            record.attr = intern(package.attr);
+            record.name = intern(package.name);
+            record.version = intern(package.version);
+            record.description = intern(package.description);
+            record.platforms = intern(package.platforms);
+            record.flags = package.flags;
+            record.reserved = 0;
+        }
+        interned.clear();
+
+        // trigram postings in two passes (count, then fill) so the ids sit in one exactly sized array
+        QVector<quint32> keys;
+        QHash<quint32, quint32> counts;
+        for (const Package& package : packages) {
+            collect_trigrams(searchable(package), keys);
+            for (quint32 key : keys) counts[key]++;
+        }
+        QVector<quint32> sorted_keys = QVector<quint32>::fromList(counts.keys());
+        std::sort(sorted_keys.begin(), sorted_keys.end());
+        QHash<quint32, quint32> cursor; // key -> next free slot in ids
+        quint32 total = 0;
+        for (quint32 key : sorted_keys) {
+            cursor.insert(key, total);
+            total += counts.value(key);
+        }
+        QVector<quint32> ids(int(total));
+        for (int i = 0; i < packages.size(); ++i) {
+            collect_trigrams(searchable(packages.at(i)), keys);
+            for (quint32 key : keys) ids[int(cursor[key]++)] = quint32(i); // records go in ascending order
+        }
+
+        QVector<FileTrigram> trigrams;
+        trigrams.reserve(sorted_keys.size());
+        QByteArray postings;
+        quint32 start = 0;
+        for (quint32 key : sorted_keys) {
+            const quint32 count = counts.value(key);
+            FileTrigram trigram{key, count, quint32(postings.size()), 0};
+            quint32 previous = 0;
+            for (quint32 i = start; i < start + count; ++i) {
+                put_varint(postings, ids.at(int(i)) - previous);
+                previous = ids.at(int(i));
+            }
+            trigram.postings_size = quint32(postings.size()) - trigram.postings;
+            trigrams << trigram;
+            start += count;
+        }
+        ids.clear();
+
+        FileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kFormatVersion;
+        header.record_count = quint32(records.size());
+        header.trigram_count = quint32(trigrams.size());
+        header.records_offset = align8(sizeof(FileHeader));
+        header.trigrams_offset = header.records_offset + quint64(records.size()) * sizeof(FileRecord);
+        header.postings_offset = header.trigrams_offset + quint64(trigrams.size()) * sizeof(FileTrigram);
+        header.postings_size = quint64(postings.size());
+        header.strings_offset = header.postings_offset + header.postings_size;
+        header.strings_size = quint64(pool.size());
+
+        QSaveFile file(path); // readers keep the old catalog until this one is complete
+        if (!file.open(QIODevice::WriteOnly)) {
+            error = "Cannot write " + path;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(QByteArray(int(header.records_offset - sizeof(header)), '\0'));
+        file.write(reinterpret_cast<const char*>(records.constData()), qint64(records.size()) * qint64(sizeof(FileRecord)));
+        file.write(reinterpret_cast<const char*>(trigrams.constData()), qint64(trigrams.size()) * qint64(sizeof(FileTrigram)));
+        file.write(postings);
+        file.write(pool);
+        if (!file.commit()) {
+            error = "Cannot write " + path;
+            return false;
+        }
+        qDebug() << "PackageCatalog:" << records.size() << "packages," << trigrams.size() << "trigrams,"
+                 << header.strings_offset + header.strings_size << "bytes";
+        return true;
+    }
+
+    Catalog::~Catalog() {
+        if (m_data) m_file.unmap(const_cast<uchar*>(m_data));
+    }
+
+    bool Catalog::open(const QString& path, QString& error) {
+        if (m_data) {
+            m_file.unmap(const_cast<uchar*>(m_data));
+            m_data = nullptr;
+        }
+        m_file.close();
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            error = "Cannot read " + path;
+            return false;
+        }
+        m_size = m_file.size();
+        if (m_size < qint64(sizeof(FileHeader))) {
+            error = path + " is not a package catalog";
+            m_file.close();
+            return false;
+        }
+        const uchar* data = m_file.map(0, m_size);
+        if (!data) {
+            error = "Cannot map " + path;
+            m_file.close();
+            return false;
+        }
+
+        const FileHeader* h = reinterpret_cast<const FileHeader*>(data);
+        const bool valid = std::memcmp(h->magic, kMagic, sizeof(kMagic)) == 0
+            && h->version == kFormatVersion
+            && h->records_offset + quint64(h->record_count) * sizeof(FileRecord) <= h->trigrams_offset
+            && h->trigrams_offset + quint64(h->trigram_count) * sizeof(FileTrigram) <= h->postings_offset
+            && h->postings_offset + h->postings_size <= h->strings_offset
+            && h->strings_offset + h->strings_size <= quint64(m_size);
+        if (!valid) {
+            error = path + " is truncated or of another format version";
+            m_file.unmap(const_cast<uchar*>(data));
+            m_file.close();
+            return false;
+        }
+        m_data = data;
+        return true;
+    }
+
+    const FileHeader* Catalog::header() const {
+        return reinterpret_cast<const FileHeader*>(m_data);
+    }
+
+    const FileRecord* Catalog::record(quint32 index) const {
+        return reinterpret_cast<const FileRecord*>(m_data + header()->records_offset) + index;
+    }
+
+    const char* Catalog::text(quint32 offset, quint32& length) const {
+        if (quint64(offset) + length > header()->strings_size) length = 0; // corrupt reference, treat as empty
+        return length ? reinterpret_cast<const char*>(m_data + header()->strings_offset + offset) : "";
+    }
+
+    quint32 Catalog::size() const {
+        return m_data ? header()->record_count : 0;
+    }
+
+    quint32 Catalog::flags(quint32 index) const {
+        return record(index)->flags;
+    }
+
+    Package Catalog::package(quint32 index) const {
+        const FileRecord* r = record(index);
+        auto copy = [this](const StringRef& ref) {
+            quint32 length = ref.length;
+            const char* data = text(ref.offset, length);
+            return QByteArray(data, int(length));
+        };
+        Package package;
+        package.attr = copy(r->attr);
+        package.name = copy(r->name);
+        package.version = copy(r->version);
+        package.description = copy(r->description);
+        package.platforms = copy(r->platforms);
+        package.flags = r->flags;
+        return package;
+    }
+
+    // <0, 0 or >0 like strcmp, with 0 meaning the lowercased text starts with lower_prefix
+    static int compare_prefix(const char* text, quint32 length, const QByteArray& lower_prefix) {
+        const quint32 n = qMin(length, quint32(lower_prefix.size()));
+        for (quint32 i = 0; i < n; ++i) {
+            const uchar a = uchar(lower(text[i]));
+            const uchar b = uchar(lower_prefix.at(int(i)));
+            if (a != b) return a < b ? -1 : 1;
+        }
+        return length < quint32(lower_prefix.size()) ? -1 : 0;
+    }
+
+    // first record whose lowercased attribute path is not below lower_prefix
+    qint64 Catalog::lower_bound(const QByteArray& lower_prefix) const {
+        qint64 low = 0;
+        qint64 high = size();
+        while (low < high) {
+            const qint64 middle = (low + high) / 2;
+            const FileRecord* r = record(quint32(middle));
+            quint32 length = r->attr.length;
+            const char* attr = text(r->attr.offset, length);
+            if (compare_prefix(attr, length, lower_prefix) < 0) low = middle + 1;
+            else high = middle;
+        }
+        return low;
+    }
+
+    QVector<quint32> Catalog::with_prefix(const QByteArray& lower_prefix) const {
+        QVector<quint32> result;
+        for (qint64 i = lower_bound(lower_prefix); i < size(); ++i) {
+            const FileRecord* r = record(quint32(i));
+            quint32 length = r->attr.length;
+            const char* attr = text(r->attr.offset, length);
+            if (compare_prefix(attr, length, lower_prefix) != 0) break;
+            result << quint32(i);
+        }
+        return result;
+    }
+
+    qint64 Catalog::find(const QByteArray& attr) const {
+        // exact matches sort right at the start of their prefix range
+        const QByteArray lower_attr = attr.toLower();
+        for (qint64 i = lower_bound(lower_attr); i < size(); ++i) {
+            const FileRecord* r = record(quint32(i));
+            quint32 length = r->attr.length;
+            const char* candidate = text(r->attr.offset, length);
+            if (length != quint32(attr.size()) || compare_prefix(candidate, length, lower_attr) != 0) return -1;
+            if (std::memcmp(candidate, attr.constData(), size_t(attr.size())) == 0) return i;
+        }
+        return -1;
+    }
+
+    const FileTrigram* Catalog::find_trigram(quint32 key) const {
+        const FileTrigram* begin = reinterpret_cast<const FileTrigram*>(m_data + header()->trigrams_offset);
+        const FileTrigram* end = begin + header()->trigram_count;
+        const FileTrigram* it = std::lower_bound(begin, end, key, [](const FileTrigram& t, quint32 k) { return t.key < k; });
+        return (it != end && it->key == key) ? it : nullptr;
+    }
+
+    QVector<quint32> Catalog::postings(const FileTrigram& trigram) const {
+        QVector<quint32> ids;
+        if (quint64(trigram.postings) + trigram.postings_size > header()->postings_size) return ids;
+        ids.reserve(int(trigram.count));
+        const uchar* p = m_data + header()->postings_offset + trigram.postings;
+        const uchar* end = p + trigram.postings_size;
+        quint32 previous = 0;
+        while (p < end) {
+            quint32 delta = 0;
+            int shift = 0;
+            while (p < end) {
+                const uchar byte = *p++;
+                delta |= quint32(byte & 0x7f) << shift;
+                shift += 7;
+                if (!(byte & 0x80)) break;
+            }
+            previous += delta;
+            if (previous < size()) ids << previous;
+        }
+        return ids;
+    }
+
+    QVector<quint32> Catalog::candidates(const QByteArray& lower_term) const {
+        QVector<quint32> result;
+        if (!m_data) return result;
+        if (lower_term.size() < 3) {
+            result.reserve(int(size()));
+            for (quint32 i = 0; i < size(); ++i) result << i;
+            return result;
+        }
+
+        QVector<quint32> keys;
+        collect_trigrams(lower_term, keys);
+        QVector<const FileTrigram*> trigrams;
+        for (quint32 key : keys) {
+            const FileTrigram* trigram = find_trigram(key);
+            if (!trigram) return result; // some part of the term is nowhere
+            trigrams << trigram;
+        }
+        // rarest first, keeps the intersections small
+        std::sort(trigrams.begin(), trigrams.end(), [](const FileTrigram* a, const FileTrigram* b) { return a->count < b->count; });
+
+        result = postings(*trigrams.first());
+        for (int i = 1; i < trigrams.size() && !result.isEmpty(); ++i) {
+            const QVector<quint32> other = postings(*trigrams.at(i));
+            QVector<quint32> both;
+            std::set_intersection(result.constBegin(), result.constEnd(), other.constBegin(), other.constEnd(), std::back_inserter(both));
+            result.swap(both);
+        }
+        return result;
+    }
+
+    static bool contains_lower(const char* text, quint32 length, const QByteArray& lower_term) {
+        const quint32 n = quint32(lower_term.size());
+        if (n == 0) return true;
+        for (quint32 i = 0; i + n <= length; ++i) {
+            quint32 j = 0;
+            while (j < n && lower(text[i + j]) == lower_term.at(int(j))) ++j;
+            if (j == n) return true;
+        }
+        return false;
+    }
+
+    bool Catalog::contains(quint32 index, const QList<QByteArray>& lower_terms) const {
+        const FileRecord* r = record(index);
+        quint32 attr_length = r->attr.length, name_length = r->name.length, description_length = r->description.length;
+        const char* attr = text(r->attr.offset, attr_length);
+        const char* name = text(r->name.offset, name_length);
+        const char* description = text(r->description.offset, description_length);
+        for (const QByteArray& term : lower_terms) {
+            if (!contains_lower(attr, attr_length, term) && !contains_lower(name, name_length, term)
+                && !contains_lower(description, description_length, term)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    QVector<quint32> Catalog::fuzzy(const QByteArray& lower_term, double min_share, int limit) const {
+        QVector<quint32> result;
+        if (!m_data || lower_term.size() < 3) return result;
+
+        QVector<quint32> keys;
+        collect_trigrams(lower_term, keys);
+        QHash<quint32, int> hits; // record -> shared trigrams
+        for (quint32 key : keys) {
+            const FileTrigram* trigram = find_trigram(key);
+            if (!trigram) continue;
+            for (quint32 id : postings(*trigram)) hits[id]++;
+        }
+
+        const int needed = qMax(1, int(std::ceil(min_share * keys.size())));
+        QVector<QPair<int, quint32>> ranked; // (hits, record)
+        for (auto it = hits.constBegin(); it != hits.constEnd(); ++it) {
+            if (it.value() >= needed) ranked << qMakePair(it.value(), it.key());
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const QPair<int, quint32>& a, const QPair<int, quint32>& b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        for (int i = 0; i < ranked.size() && i < limit; ++i) result << ranked.at(i).second;
+        return result;
+    }
+}
@@ -0,0 +1,161 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef PACKAGE_CATALOG_H
+#define PACKAGE_CATALOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Memory-mapped binary catalog of packages, the storage behind PackageIndex.
+ *
+ * Layout (native byte order, the file never leaves the device that wrote it):
+ * - Header: magic, counts and the offsets of the sections below.
+ * - Records: one fixed-size Record per package, sorted by lowercased attribute path,
+ *   so the record array doubles as the sorted name table for prefix lookups.
+ * - Trigrams: sorted table of every lowercase byte trigram of the attribute paths, names
+ *   and descriptions, each pointing at its posting list.
+ * - Postings: ascending record numbers per trigram, delta and varint encoded.
+ * - String pool: every distinct string once, records refer to it by offset and length.
+ *
+ * Opening a catalog only maps the file and checks the header, queries read straight
+ * from the mapping, so memory use doesn't grow with the number of packages.
+ */
+namespace PackageCatalog {
+
+    /**
+    * @brief Bumped whenever the layout changes, older files are rebuilt.
+    */
+    const quint32 kFormatVersion = 1;
+
+    /**
+    * @brief Record flag: the package is available on this device's platform.
+    */
+    const quint32 kAvailable = 1 << 0;
+
+    struct FileHeader;
+    struct FileRecord;
+    struct FileTrigram;
+
+    /**
+    * @brief One package, as handed to write() and returned by Catalog::package().
+    */
+    struct Package {
+        QByteArray attr;         ///< Attribute path without the channel, e.g. "firefox".
+        QByteArray name;         ///< Derivation name, e.g. "firefox-143.0".
+        QByteArray version;      ///< e.g. "143.0", may be empty.
+        QByteArray description;  ///< meta.description, may be empty.
+        QByteArray platforms;    ///< meta.platforms joined by spaces, may be empty.
+        quint32 flags = 0;       ///< kAvailable...
+    };
+
+    /**
+    * @brief Writes a catalog of packages to path (atomically, readers see the old or the new file).
+    * @param packages The packages in any order, sorted in place.
+    * @param error Set to a message on failure.
+    * @return True on success.
+    */
+    bool write(const QString& path, QVector<Package>& packages, QString& error);
+
+    /**
+    * @brief Read-only view of a catalog file.
+    *
+    * Queries take lowercase terms and return record numbers in ascending (alphabetical) order.
+    * Safe to use from several threads once opened.
+    */
+    class Catalog {
+    public:
+        Catalog() = default;
+        ~Catalog();
+
+        Catalog(const Catalog&) = delete;
+        Catalog& operator=(const Catalog&) = delete;
+
+        /**
+        * @brief Maps a catalog file, fails on missing files, other versions and truncated files.
+        */
+        bool open(const QString& path, QString& error);
+
+        bool isOpen() const { return m_data != nullptr; }
+
+        /**
+        * @brief Number of packages.
+        */
+        quint32 size() const;
+
+        /**
+        * @brief Copies one record out of the mapping.
+        */
+        Package package(quint32 index) const;
+
+        /**
+        * @brief The record flags (kAvailable...) without copying any strings.
+        */
+        quint32 flags(quint32 index) const;
+
+        /**
+        * @brief Record number of an exact attribute path, -1 if it isn't in the catalog.
+        */
+        qint64 find(const QByteArray& attr) const;
+
+        /**
+        * @brief Records whose lowercased attribute path starts with lower_prefix.
+        */
+        QVector<quint32> with_prefix(const QByteArray& lower_prefix) const;
+
+        /**
+        * @brief Records whose attribute path, name or description may contain lower_term.
+        *
+        * Candidates from the trigram postings, verify them with contains(). Terms shorter than
+        * three bytes have no trigram and return every record.
+        */
+        QVector<quint32> candidates(const QByteArray& lower_term) const;
+
+        /**
+        * @brief True if every lower_terms entry is in the record's attribute path, name or description.
+        */
+        bool contains(quint32 index, const QList<QByteArray>& lower_terms) const;
+
+        /**
+        * @brief Records sharing most trigrams with lower_term, best first, for misspelled searches.
+        * @param min_share Fraction of the term's trigrams a record needs, e.g. 0.6.
+        * @param limit Return at most this many records.
+        */
+        QVector<quint32> fuzzy(const QByteArray& lower_term, double min_share, int limit) const;
+
+    private:
+        const FileHeader* header() const;
+        const FileRecord* record(quint32 index) const;
+        const char* text(quint32 offset, quint32& length) const;
+        QVector<quint32> postings(const FileTrigram& trigram) const;
+        const FileTrigram* find_trigram(quint32 key) const;
+        qint64 lower_bound(const QByteArray& lower_prefix) const;
+
+        QFile m_file;
+        const uchar* m_data = nullptr;
+        qint64 m_size = 0;
+    };
+}
+
+#endif // PACKAGE_CATALOG_H
@@ -0,0 +1,61 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "package-set.h"
+
+namespace PackageSet {
+
+    QString normalized(const QString& package) {
+        const QString trimmed = package.trimmed();
+        return trimmed.startsWith(QLatin1String("nixpkgs.")) ? QStringLiteral("pkgs") + trimmed.mid(7) : trimmed;
+    }
+
+    QString attribute(const QString& package) {
+        const QString name = normalized(package);
+        return name.startsWith(QLatin1String("pkgs.")) ? name.mid(5) : name;
+    }
+
+    Set::Set(const QStringList& packages) {
+        m_names.reserve(packages.size());
+        m_index.reserve(packages.size());
+        for (const QString& package : packages) insert(package);
+    }
+
+    bool Set::insert(const QString& package) {
+        const QString name = normalized(package);
+        if (name.isEmpty() || m_index.contains(name)) return false;
+        m_index.insert(name);
+        m_names.append(name);
+        return true;
+    }
+
+    Diff diff(const QStringList& current, const QStringList& wanted) {
+        const Set before(current);
+        const Set after(wanted);
+        Diff result;
+        for (const QString& name : after.names()) {
+            if (!before.contains(name)) result.added.append(name);
+        }
+        for (const QString& name : before.names()) {
+            if (!after.contains(name)) result.removed.append(name);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef PACKAGE_SET_H
+#define PACKAGE_SET_H
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Package lists as sets: one spelling per package, hashed membership, stable order.
+ *
+ * Everything that compares package names (the config editor, the wrappers) goes through
+ * normalized(), so "nixpkgs.hello", "pkgs.hello" and " pkgs.hello " are the same package
+ * everywhere. Building a Set and every diff() are linear in the number of packages.
+ */
+namespace PackageSet {
+
+    /**
+    * @brief The spelling packages are compared by: trimmed, "nixpkgs." written as "pkgs.".
+    */
+    QString normalized(const QString& package);
+
+    /**
+    * @brief The attribute path inside nixpkgs, e.g. "hello" for "pkgs.hello" or "nixpkgs.hello".
+    */
+    QString attribute(const QString& package);
+
+    /**
+    * @brief Packages in the order they were first inserted, each normalized spelling once.
+    */
+    class Set {
+    public:
+        Set() = default;
+        explicit Set(const QStringList& packages);
+
+        /**
+        * @brief Adds a package at the end, false if it is already in the set or empty.
+        */
+        bool insert(const QString& package);
+
+        bool contains(const QString& package) const { return m_index.contains(normalized(package)); }
+        int size() const { return m_names.size(); }
+        bool isEmpty() const { return m_names.isEmpty(); }
+
+        /**
+        * @brief The normalized packages, in insertion order.
+        */
+        const QStringList& names() const { return m_names; }
+
+    private:
+        QStringList m_names;
+        QSet<QString> m_index;
+    };
+
+    /**
+    * @brief What turns one package list into another.
+    */
+    struct Diff {
+        QStringList added;    ///< In wanted but not in current, in wanted's order.
+        QStringList removed;  ///< In current but not in wanted, in current's order.
+    };
+
+    /**
+    * @brief Compares two package lists in O(n + m), duplicates and spellings are folded by normalized().
+    */
+    Diff diff(const QStringList& current, const QStringList& wanted);
+}
+
+#endif // PACKAGE_SET_H
@@ -0,0 +1,82 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "process-group.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+
+void GroupedProcess::setupChildProcess() {
+    ::setpgid(0, 0); // runs in the forked child before exec
+}
+
+static bool group_alive(qint64 pgid) {
+    return ::kill(-static_cast<pid_t>(pgid), 0) == 0 || errno == EPERM;
+}
+
+bool terminate_process_group(qint64 pgid, int grace_ms) {
+    if (pgid <= 1) return false; // never signal init or "every process we can reach"
+    if (::kill(-static_cast<pid_t>(pgid), SIGTERM) != 0) return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (group_alive(pgid) && !timer.hasExpired(grace_ms)) {
+        QThread::msleep(50);
+    }
+    if (group_alive(pgid)) {
+        qDebug() << "terminate_process_group: group" << pgid << "ignored SIGTERM, sending SIGKILL";
+        ::kill(-static_cast<pid_t>(pgid), SIGKILL);
+    }
+    return true;
+}
+
+QList<qint64> child_pids(qint64 parent) {
+    QList<qint64> children;
+
+    // fast path, needs CONFIG_PROC_CHILDREN
+    QFile children_file(QStringLiteral("/proc/%1/task/%1/children").arg(parent));
+    if (children_file.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& pid : children_file.readAll().split(' ')) {
+            if (!pid.trimmed().isEmpty()) children << pid.trimmed().toLongLong();
+        }
+        return children;
+    }
+
+    // fallback, 4th field of /proc/<pid>/stat is the parent pid (2nd field "(comm)" may contain spaces)
+    const QStringList entries = QDir(QStringLiteral("/proc")).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& entry : entries) {
+        bool is_pid = false;
+        qint64 pid = entry.toLongLong(&is_pid);
+        if (!is_pid) continue;
+        QFile stat_file(QStringLiteral("/proc/%1/stat").arg(pid));
+        if (!stat_file.open(QIODevice::ReadOnly)) continue;
+        QByteArray stat = stat_file.readAll();
+        QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+        if (fields.size() > 1 && fields.at(1).toLongLong() == parent) children << pid;
+    }
+    return children;
+}
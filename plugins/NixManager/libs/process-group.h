@@ -0,0 +1,55 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef PROCESS_GROUP_H
+#define PROCESS_GROUP_H
+
+#include <QProcess>
+#include <QList>
+
+/**
+ * @brief QProcess whose child becomes the leader of a new process group.
+ *
+ * Everything the child spawns (nix, its builders, curl, ...) inherits the group,
+ * so terminate_process_group() can stop the whole tree at once.
+ */
+class GroupedProcess : public QProcess
+{
+public:
+    using QProcess::QProcess;
+
+protected:
+    void setupChildProcess() override;
+};
+
+/**
+ * @brief Sends SIGTERM to a process group, then SIGKILL if it is still alive after the grace period.
+ * @param pgid The process group id (usually the pid of the group leader).
+ * @param grace_ms How long the group gets to exit after SIGTERM.
+ * @return True if a signal could be delivered to the group.
+ */
+bool terminate_process_group(qint64 pgid, int grace_ms = 2000);
+
+/**
+ * @brief Lists the direct children of a process (read from /proc).
+ */
+QList<qint64> child_pids(qint64 parent);
+
+#endif // PROCESS_GROUP_H
@@ -0,0 +1,121 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "search-ranking.h"
+
+#include <QRegExp>
+#include <algorithm>
+#include <cmath>
+
+namespace SearchRanking {
+
+    // weights, only their order of magnitude matters
+    static const double kExactName = 100.0;
+    static const double kNamePrefix = 40.0;
+    static const double kNameToken = 20.0;
+    static const double kNameSubstring = 10.0;
+    static const double kDescriptionToken = 4.0;
+    static const double kDescriptionSubstring = 1.5;
+    static const double kAllTermsInName = 15.0;
+    static const double kNestedPenalty = 3.0;      // "xfce.thunar" vs "thunar"
+    static const double kLengthPenalty = 0.05;     // per character of the name
+    static const double kPopularity = 3.0;         // times log(1 + popularity)
+    static const double kSourceRank = 2.0;         // divided by 1 + rank
+
+    Query::Query(const QString& quarry)
+        : text(quarry.trimmed().toLower()),
+          terms(text.split(QRegExp("\\s+"), QString::SkipEmptyParts))
+    {
+    }
+
+    static QStringList tokens(const QString& lower) {
+        return lower.split(QRegExp("[^a-z0-9+]+"), QString::SkipEmptyParts);
+    }
+
+    double score(const Query& query, const QString& name, const QString& description, int source_rank, double popularity) {
+        const QString lower_name = name.toLower();
+        const QString lower_description = description.toLower();
+        const QString leaf = lower_name.mid(lower_name.lastIndexOf('.') + 1); // "python3packages.requests" -> "requests"
+        double result = 0;
+
+        if (!query.text.isEmpty()) {
+            if (lower_name == query.text || leaf == query.text) result += kExactName;
+            else if (lower_name.startsWith(query.text) || leaf.startsWith(query.text)) {
+                result += kNamePrefix * query.text.size() / qMax(1, leaf.size()); // "fire" fits "firefox" better than "firefox-devedition"
+            }
+        }
+
+        const QStringList name_tokens = tokens(lower_name);
+        QStringList description_tokens; // only split when a term isn't in the name
+        int in_name = 0;
+        for (const QString& term : query.terms) {
+            if (name_tokens.contains(term)) {
+                result += kNameToken;
+                in_name++;
+            } else if (lower_name.contains(term)) {
+                result += kNameSubstring;
+                in_name++;
+            } else if (!lower_description.isEmpty()) {
+                if (description_tokens.isEmpty()) description_tokens = tokens(lower_description);
+                if (description_tokens.contains(term)) result += kDescriptionToken;
+                else if (lower_description.contains(term)) result += kDescriptionSubstring;
+            }
+        }
+        if (query.terms.size() > 1 && in_name == query.terms.size()) result += kAllTermsInName;
+
+        if (lower_name.contains('.')) result -= kNestedPenalty;
+        result -= kLengthPenalty * lower_name.size();
+        if (popularity > 0) result += kPopularity * std::log1p(popularity);
+        if (source_rank >= 0) result += kSourceRank / (1 + source_rank);
+        return result;
+    }
+
+    // true if a ranks before b
+    static bool better(const std::pair<double, int>& a, const std::pair<double, int>& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    }
+
+    TopK::TopK(int k)
+        : m_k(qMax(0, k))
+    {
+        m_heap.reserve(size_t(m_k));
+    }
+
+    void TopK::offer(double score, int id) {
+        const std::pair<double, int> candidate(score, id);
+        if (int(m_heap.size()) < m_k) {
+            m_heap.push_back(candidate);
+            std::push_heap(m_heap.begin(), m_heap.end(), better); // better() as "less", so the worst is on top
+        } else if (m_k > 0 && better(candidate, m_heap.front())) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), better);
+            m_heap.back() = candidate;
+            std::push_heap(m_heap.begin(), m_heap.end(), better);
+        }
+    }
+
+    QVector<int> TopK::take() {
+        std::sort_heap(m_heap.begin(), m_heap.end(), better); // ascending by "less", i.e. best first
+        QVector<int> ids;
+        ids.reserve(int(m_heap.size()));
+        for (const auto& entry : m_heap) ids << entry.second;
+        m_heap.clear();
+        return ids;
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef SEARCH_RANKING_H
+#define SEARCH_RANKING_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Relevance ranking shared by the local and the remote package search.
+ *
+ * Both backends score their candidates with score() and keep the best ones with a
+ * TopK, so the same query orders packages the same way no matter where they came
+ * from, and the most relevant results are the first ones computed and sent to QML.
+ */
+namespace SearchRanking {
+
+    /**
+    * @brief The query, lowercased and split into words once for all candidates.
+    */
+    struct Query {
+        explicit Query(const QString& quarry);
+
+        QString text;       ///< The whole query, lowercased and trimmed.
+        QStringList terms;  ///< Its whitespace separated words.
+    };
+
+    /**
+    * @brief Relevance of one package for a query, higher is better.
+    *
+    * Adds up, strongest first: the attribute name (or its last component) equals the
+    * query, starts with it, the query words appearing as whole tokens or substrings of
+    * the name, then of the description. Shorter and top-level names win ties, a
+    * popularity signal (e.g. install counts) and the backend's own order
+    * break the remaining ones.
+    *
+    * @param query The query.
+    * @param name Attribute name, e.g. "python3Packages.requests".
+    * @param description Summary or meta.description, may be empty.
+    * @param source_rank Position in the backend's own result order, -1 if it has none.
+    * @param popularity Non-negative popularity signal, 0 if unknown.
+    */
+    double score(const Query& query, const QString& name, const QString& description, int source_rank = -1, double popularity = 0);
+
+    /**
+    * @brief Keeps the k best of any number of scored candidates without sorting all of them.
+    *
+    * Holds at most k entries in a heap, offer() is O(log k).
+    */
+    class TopK {
+    public:
+        explicit TopK(int k);
+
+        /**
+        * @brief Offers a candidate, id identifies it for the caller (e.g. a record or result index).
+        */
+        void offer(double score, int id);
+
+        /**
+        * @brief The kept ids, best first, equal scores in ascending id order. Empties the TopK.
+        */
+        QVector<int> take();
+
+        int size() const { return int(m_heap.size()); }
+
+    private:
+        int m_k;
+        std::vector<std::pair<double, int>> m_heap; // the worst kept candidate on top
+    };
+}
+
+#endif // SEARCH_RANKING_H
@@ -0,0 +1,256 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "shell-pool.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QThreadStorage>
+
+// at most this many shells are kept per worker thread, exec_bash is not re-entrant so one is usually enough.
+static const int kMaxSessionsPerThread = 2;
+
+// how long a single wait for output may block, stderr only output and cancellation are picked up at this rate.
+static const int kPollSliceMs = 100;
+
+// how long sourcing .profile may take when a session starts, a profile that blocks must not hang the worker.
+static const int kStartupTimeoutMs = 30000;
+
+// after killing a command, how long to wait for its end markers before giving up on the whole session.
+static const int kKillSettleMs = 5000;
+
+// Fingerprint of the files a session sourced on start, if it changes the session is stale.
+QString profile_stamp() {
+    const QString home = QString::fromUtf8(qgetenv("HOME"));
+    QString stamp;
+    for (const QString& path : {home + "/.profile", home + "/.nix-profile/etc/profile.d/nix.sh"}) {
+        QFileInfo fi(path);
+        if (fi.exists()) {
+            stamp += QString::number(fi.lastModified().toMSecsSinceEpoch()) + ':' + QString::number(fi.size()) + ';';
+        } else {
+            stamp += QStringLiteral("-;");
+        }
+    }
+    return stamp;
+}
+
+// Wraps a string in single quotes for bash ('it'\''s' style escaping).
+static QString shell_quote(const QString& str) {
+    QString quoted = str;
+    quoted.replace('\'', QStringLiteral("'\\''"));
+    return '\'' + quoted + '\'';
+}
+
+ShellSession::ShellSession() : m_broken(false) {}
+
+ShellSession::~ShellSession() {
+    if (m_proc.state() == QProcess::NotRunning) return;
+    m_proc.closeWriteChannel(); // bash exits on EOF
+    if (!m_proc.waitForFinished(1000)) {
+        m_proc.kill();
+        m_proc.waitForFinished(1000);
+    }
+}
+
+bool ShellSession::start() {
+    m_profile_stamp = profile_stamp();
+    m_proc.start("/bin/bash", QStringList() << "--noprofile" << "--norc");
+    if (!m_proc.waitForStarted()) {
+        qDebug() << "ShellSession: failed to start bash:" << m_proc.errorString();
+        m_broken = true;
+        return false;
+    }
+
+    // Source the profile once, same as every one-shot exec_bash used to do per command.
+    // Not wrapped in a subshell on purpose, the environment has to stay in the session.
+    // Job control puts every command (background job) into its own process group.
+    const QByteArray marker = "__NIXMANAGER_INIT__";
+    m_proc.write(QByteArray("set -m\n"
+                            "source \"$HOME/.profile\" </dev/null >/dev/null 2>&1\n"
+                            "printf '\\n%s %d\\n' '") + marker + "' \"$?\"\n");
+
+    QElapsedTimer started;
+    started.start();
+    QByteArray out;
+    while (!m_broken) {
+        out.append(m_proc.readAllStandardOutput());
+        m_proc.readAllStandardError(); // profile noise is discarded
+        int pos = out.indexOf(marker);
+        if (pos != -1 && out.indexOf('\n', pos) != -1) {
+            int rc = out.mid(pos + marker.size(), out.indexOf('\n', pos) - pos - marker.size()).trimmed().toInt();
+            if (rc != 0) {
+                qDebug() << "ShellSession: sourcing .profile failed with exit code" << rc;
+                m_broken = true;
+            }
+            break;
+        }
+
+        OperationContext::Interruption interrupted = OperationContext::interruption();
+        if (interrupted != OperationContext::Interruption::None || started.hasExpired(kStartupTimeoutMs)) {
+            qDebug() << "ShellSession: sourcing .profile did not finish:"
+                     << (interrupted != OperationContext::Interruption::None
+                         ? OperationContext::interruption_message(interrupted)
+                         : QStringLiteral("timed out"));
+            kill_command(); // whatever the profile is waiting on, bash itself goes with the session
+            m_broken = true;
+            break;
+        }
+
+        m_proc.setReadChannel(QProcess::StandardOutput);
+        if (!m_proc.waitForReadyRead(kPollSliceMs)
+            && (m_proc.state() != QProcess::Running || m_proc.error() != QProcess::Timedout)) {
+            m_broken = true;
+        }
+    }
+    return !m_broken;
+}
+
+bool ShellSession::is_usable() const {
+    return !m_broken && m_proc.state() == QProcess::Running && m_profile_stamp == profile_stamp();
+}
+
+// Kills the running command's process group(s), the session itself survives.
+bool ShellSession::kill_command() {
+    bool killed = false;
+    for (qint64 child : child_pids(m_proc.processId())) {
+        // with job control each child of the session is a group leader
+        killed = terminate_process_group(child) || killed;
+    }
+    return killed;
+}
+
+ShellResult ShellSession::run(const QString& command, const LineSink& sink, OperationLog* log) {
+    ShellResult result{false, -1, QByteArray(), QByteArray(), false, OperationContext::Interruption::None};
+
+    // unique per command so output that happens to contain an old marker can't confuse us.
+    const QByteArray marker = "__NIXMANAGER_" + QByteArray::number(QRandomGenerator::global()->generate64(), 16) + "__";
+
+    // The leading \n in the markers guarantees they start on their own line even if
+    // the command did not end its output with a newline.
+    QByteArray script;
+    // Started as a background job so it gets its own process group, `wait` hands back its exit code.
+    script += "( eval " + shell_quote(command).toUtf8() + " ) </dev/null &\n";
+    script += "wait $!\n";
+    script += "__nm_rc=$?\n";
+    script += "printf '\\n%s %d\\n' '" + marker + "' \"$__nm_rc\"\n";
+    script += "printf '\\n%s\\n' '" + marker + "' >&2\n";
+    m_proc.write(script);
+
+    if (log) log->begin_command(command);
+    OutputCapture out(QStringLiteral("stdout"), sink, log, marker);
+    OutputCapture err(QStringLiteral("stderr"), sink, log, marker);
+
+    // copies the bounded tails into the result, whatever way we leave the loop
+    auto collect = [&]() {
+        result.std_out = out.tail().tail();
+        result.std_err = err.tail().tail();
+        result.truncated = out.tail().truncated() || err.tail().truncated();
+    };
+
+    QElapsedTimer since_kill;
+    forever {
+        out.feed(m_proc.readAllStandardOutput());
+        err.feed(m_proc.readAllStandardError());
+
+        if (out.marker_seen() && err.marker_seen()) break;
+
+        if (result.interrupted == OperationContext::Interruption::None) {
+            result.interrupted = OperationContext::interruption();
+            if (result.interrupted != OperationContext::Interruption::None) {
+                qDebug() << "ShellSession:" << OperationContext::interruption_message(result.interrupted) << "Killing:" << command;
+                if (!kill_command()) {
+                    // job control did not take effect, only taking down the whole session is safe.
+                    terminate_process_group(m_proc.processId());
+                }
+                since_kill.start();
+            }
+        } else if (since_kill.hasExpired(kKillSettleMs)) {
+            qDebug() << "ShellSession: command did not stop after kill, dropping session";
+            terminate_process_group(m_proc.processId());
+            m_broken = true;
+            collect();
+            return result;
+        }
+
+        // stdout marker is always printed first, so wait on whichever channel is still open.
+        // waitForReadyRead() buffers the other channel too, but only returns early for the
+        // selected one, hence the short slice so stderr progress is not held back.
+        m_proc.setReadChannel(!out.marker_seen() ? QProcess::StandardOutput : QProcess::StandardError);
+        if (!m_proc.waitForReadyRead(kPollSliceMs)
+            && (m_proc.state() != QProcess::Running || m_proc.error() != QProcess::Timedout)) {
+            qDebug() << "ShellSession: bash died while running command:" << m_proc.errorString();
+            m_broken = true;
+            collect();
+            return result;
+        }
+    }
+
+    result.exit_code = out.marker_line().mid(marker.size()).trimmed().toInt();
+    if (log) log->end_command(result.exit_code);
+    collect();
+    result.completed = true;
+    return result;
+}
+
+ShellPool::~ShellPool() {
+    qDeleteAll(m_idle);
+}
+
+ShellPool& ShellPool::local() {
+    static QThreadStorage<ShellPool*> pools; // deleted (with its sessions) when the owning thread exits
+    if (!pools.hasLocalData()) {
+        pools.setLocalData(new ShellPool);
+    }
+    return *pools.localData();
+}
+
+ShellSession* ShellPool::acquire() {
+    while (!m_idle.isEmpty()) {
+        ShellSession* session = m_idle.takeLast();
+        if (session->is_usable()) {
+            m_busy++;
+            return session;
+        }
+        delete session; // recycle broken/outdated shells
+    }
+
+    if (m_busy >= kMaxSessionsPerThread) return nullptr;
+
+    ShellSession* session = new ShellSession;
+    if (!session->start()) {
+        delete session;
+        return nullptr;
+    }
+    m_busy++;
+    return session;
+}
+
+void ShellPool::release(ShellSession* session) {
+    if (!session) return;
+    m_busy--;
+    if (session->is_usable()) {
+        m_idle.append(session);
+    } else {
+        delete session;
+    }
+}
@@ -0,0 +1,143 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef SHELL_POOL_H
+#define SHELL_POOL_H
+
+#include <QProcess>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include "operation-context.h"
+#include "process-group.h"
+#include "output-capture.h"
+
+/**
+ * @brief Raw result of a command that was sent to a ShellSession.
+ */
+struct ShellResult {
+    bool completed;      ///< False if the session died before the command's end markers arrived.
+    int exit_code;       ///< Exit code of the command (only meaningful if completed is true).
+    QByteArray std_out;  ///< Tail of what the command wrote to stdout (see TailBuffer).
+    QByteArray std_err;  ///< Tail of what the command wrote to stderr.
+    bool truncated;      ///< True if older output was dropped from std_out/std_err, the log has all of it.
+    OperationContext::Interruption interrupted; ///< Set if the command was killed because its request was cancelled or timed out.
+};
+
+/**
+ * @brief Fingerprint (mtime and size) of $HOME/.profile and nix.sh, changes whenever a login shell would see a different environment.
+ */
+QString profile_stamp();
+
+/**
+ * @brief A long-lived bash process that has already sourced $HOME/.profile.
+ *
+ * Commands are written to the shell's stdin and run in a subshell, so exports,
+ * `cd` or `exit` inside a command never leak into the next one. The end of each
+ * command is framed by a unique marker on stdout (carrying the exit code) and on
+ * stderr, which is how output of consecutive commands is told apart.
+ *
+ * The shell runs with job control enabled (`set -m`), so every command is its own
+ * process group and can be killed together with everything it spawned when the
+ * current request is cancelled or times out, without losing the session.
+ *
+ * A session is bound to the thread that created it (QProcess is not thread safe),
+ * use ShellPool::local() to get one.
+ */
+class ShellSession
+{
+public:
+    ShellSession();
+    ~ShellSession();
+
+    /**
+     * @brief Starts bash and sources $HOME/.profile once.
+     *
+     * Gives up (and kills what the profile started) if sourcing takes longer than
+     * 30 seconds or the current request is cancelled or times out meanwhile.
+     * @return True if the shell is up and the profile was sourced successfully.
+     */
+    bool start();
+
+    /**
+     * @brief Checks whether the session can take another command.
+     *
+     * A session is unusable once it crashed, lost sync with its markers, or once
+     * $HOME/.profile (or nix.sh) changed on disk since it was started, e.g. right
+     * after nix was installed.
+     */
+    bool is_usable() const;
+
+    /**
+     * @brief Runs a command inside the session and blocks until it finished.
+     *
+     * Polls OperationContext::interruption() while waiting and terminates the
+     * command's process group as soon as the current request is interrupted.
+     *
+     * @param command The shell command string to execute.
+     * @param sink Optional callback that receives output line by line while the command runs.
+     * @param log Optional log that receives the complete output.
+     * @return The tail of stdout/stderr and the exit code of the command.
+     */
+    ShellResult run(const QString& command, const LineSink& sink = LineSink(), OperationLog* log = nullptr);
+
+private:
+    bool kill_command();
+
+    GroupedProcess m_proc;
+    bool m_broken;
+    QString m_profile_stamp;
+};
+
+/**
+ * @brief Per-thread pool of warm ShellSession objects.
+ *
+ * Broken or outdated sessions are dropped on acquire/release and replaced by a
+ * fresh one on the next acquire, so a crashed shell never poisons later calls.
+ */
+class ShellPool
+{
+public:
+    ~ShellPool();
+
+    /**
+     * @brief Returns the pool that belongs to the calling thread (created on first use).
+     */
+    static ShellPool& local();
+
+    /**
+     * @brief Hands out an idle, usable session, starting a new one if needed.
+     * @return A session, or nullptr if none could be started (caller should fall back to a one-shot bash).
+     */
+    ShellSession* acquire();
+
+    /**
+     * @brief Returns a session to the pool, recycling it if it is no longer usable.
+     */
+    void release(ShellSession* session);
+
+private:
+    ShellPool() = default;
+
+    QVector<ShellSession*> m_idle;
+    int m_busy = 0;
+};
+
+#endif // SHELL_POOL_H
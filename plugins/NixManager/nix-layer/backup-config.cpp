@@ -240,30 +240,49 @@ std::tuple<bool, QString> restore_config_file(const QString& filename) {
     }
 }
 
-QString get_config_path() {
-    bool success;
-    QStringList output;
-    QStringList full_error;
-
-    std::tie(success, output, full_error) = exec_bash(QString("echo $HOME"));
-
-    if (!output.isEmpty()) {
-        QString userdir = output.first().trimmed(); // Remove trailing newline
-        if (userdir.isEmpty()) {
-            qDebug() << "Error: $HOME is empty. Cannot determine config path.";
-            return QString();
+std::tuple<bool, QString> backup_config_files(const QStringList& filenames) {
+    for (const QString& filename : filenames) {
+        auto [success, message] = backup_config_file(filename);
+        if (!success) {
+            return {false, message};
         }
-        // default user return: /home/phablet/.config/home-manager/home.nix
-        QString config_path = userdir + "/.config/home-manager/home.nix";
+    }
+    return {true, QStringLiteral("SUCCESS: Backups created.")};
+}
 
-        if (!QFile::exists(config_path) || !QFile(config_path).open(QIODevice::ReadOnly)) {
-            // File doesn't exist or can't be opened as a regular file
-            return QString(); // return empty string as per brief in header file 
+std::tuple<bool, QString> restore_config_files(const QStringList& filenames) {
+    QStringList failures;
+    for (const QString& filename : filenames) {
+        auto [success, message] = restore_config_file(filename);
+        if (!success) {
+            failures.append(message);
         }
+    }
+    if (!failures.isEmpty()) {
+        return {false, failures.join('\n')};
+    }
+    return {true, QStringLiteral("SUCCESS: Configuration files restored from backup.")};
+}
 
-        return config_path;
-    } else {
-        qDebug() << "Error: Could not determine userdir using 'echo $HOME'." << full_error;
+QString get_config_path() {
+    // home-manager looks in $XDG_CONFIG_HOME (default $HOME/.config), the cached login environment knows both.
+    const QString userdir = LoginEnvironment::home();
+    if (userdir.isEmpty()) {
+        qDebug() << "Error: $HOME is empty. Cannot determine config path.";
         return QString();
     }
+    // default user return: /home/phablet/.config/home-manager/home.nix
+    // home-manager itself still falls back to the location it used before 22.11
+    const QStringList candidates({
+        LoginEnvironment::xdg_config_home() + "/home-manager/home.nix",
+        LoginEnvironment::xdg_config_home() + "/nixpkgs/home.nix"
+    });
+
+    for (const QString& config_path : candidates) {
+        if (QFile::exists(config_path) && QFile(config_path).open(QIODevice::ReadOnly)) {
+            return config_path;
+        }
+    }
+    // File doesn't exist or can't be opened as a regular file
+    return QString(); // return empty string as per brief in header file
 }
@@ -87,13 +87,33 @@ std::tuple<bool, QString> backup_config_file(const QString& filename);
  */
 std::tuple<bool, QString> restore_config_file(const QString& filename);
 
+/**
+ * @brief Creates backups of several configuration files, see backup_config_file().
+ *
+ * @param filenames The absolute paths of the files (e.g. home.nix and the modules it imports).
+ * @return A tuple: `True` if every file was backed up, and the message of the first failure
+ * (files after it are not backed up) or "SUCCESS".
+ */
+std::tuple<bool, QString> backup_config_files(const QStringList& filenames);
+
+/**
+ * @brief Restores several configuration files from their backups, see restore_config_file().
+ *
+ * Every file is tried, also after one of them failed.
+ *
+ * @param filenames The absolute paths of the files that were backed up.
+ * @return A tuple: `True` if every file was restored, and the messages of the failures joined by newlines or "SUCCESS".
+ */
+std::tuple<bool, QString> restore_config_files(const QStringList& filenames);
+
 /**
  * @brief Determines and verifies the default configuration path for home-manager.
  *
  * This function constructs the expected path to the home-manager configuration file
- * at `~/.config/home-manager/home.nix` by dynamically getting the $HOME
- * using the `echo $HOME` command via `openProcess`. It then checks if a file actually
- * exists at this path.
+ * at `$XDG_CONFIG_HOME/home-manager/home.nix` (usually `~/.config/home-manager/home.nix`),
+ * falling back to the older `$XDG_CONFIG_HOME/nixpkgs/home.nix` home-manager still reads,
+ * using the cached LoginEnvironment, no process is started. It then checks if a file
+ * actually exists at this path. Modules the file imports are found by ConfigGraph.
  *
  * @return The absolute path to the home-manager configuration file if it
  * exists and is a regular file. Returns an empty `std::string` if the
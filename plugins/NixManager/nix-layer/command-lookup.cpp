@@ -0,0 +1,149 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "command-lookup.h"
+#include "package-index.h"
+#include "../libs/login-env.h"
+#include "../libs/search-ranking.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QRegExp>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+
+namespace CommandLookup {
+
+    QString database_path() {
+        const QString path = LoginEnvironment::home() + "/.nix-defexpr/channels/nixpkgs/programs.sqlite";
+        return QFile::exists(path) ? path : QString();
+    }
+
+    struct Provider {
+        QString package;
+        QString command;
+    };
+
+    // runs the lookup on a connection private to this call, QSqlDatabase connections can't be shared between threads
+    static bool query_providers(const QString& path, const QString& command, QList<Provider>& providers, QString& error) {
+        const QString connection = QStringLiteral("nixmanager-programs-%1").arg(quintptr(QThread::currentThreadId()));
+        bool ok = false;
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connection);
+            db.setDatabaseName(path);
+            db.setConnectOptions(QStringLiteral("QSQLITE_OPEN_READONLY")); // the channel lives in the read-only store anyway
+            if (!db.open()) {
+                error = "Cannot open " + path + ": " + db.lastError().text();
+            } else {
+                QSqlQuery pragma(db);
+                pragma.exec(QStringLiteral("PRAGMA mmap_size=268435456")); // read pages straight from the mapping
+
+                // exact matches plus commands starting with it, both served by the (name, system, package) primary key
+                QSqlQuery query(db);
+                query.prepare(QStringLiteral("SELECT name, package FROM Programs WHERE system = ? AND name >= ? AND name < ? LIMIT 1000"));
+                query.addBindValue(QLatin1String(ARCH) + QStringLiteral("-linux"));
+                query.addBindValue(command);
+                query.addBindValue(command + QChar(0xFFFF));
+                if (!query.exec()) {
+                    error = "Cannot query " + path + ": " + query.lastError().text();
+                } else {
+                    while (query.next()) providers << Provider{query.value(1).toString(), query.value(0).toString()};
+                    ok = true;
+                }
+            }
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(connection);
+        return ok;
+    }
+
+    std::tuple<bool, QStringList, QStringList>
+    search(const QString& command) {
+        const QString trimmed = command.trimmed();
+        if (trimmed.isEmpty() || trimmed.contains(QRegExp("\\s"))) {
+            return {false, QStringList(), QStringList{QStringLiteral("Search for a single command, e.g. \"rg\".")}};
+        }
+        const QString path = database_path();
+        if (path.isEmpty()) {
+            return {false, QStringList(), QStringList{QStringLiteral("The nixpkgs channel has no programs.sqlite (only nixos-* and nixpkgs-* channels ship it).")}};
+        }
+
+        QList<Provider> providers;
+        QString error;
+        if (!query_providers(path, trimmed, providers, error)) {
+            return {false, QStringList(), QStringList{error}};
+        }
+
+        // one entry per package, the exact command wins over prefix matches
+        QHash<QString, int> seen; // package -> index in unique
+        QList<Provider> unique;
+        for (const Provider& provider : providers) {
+            auto it = seen.constFind(provider.package);
+            if (it == seen.constEnd()) {
+                seen.insert(provider.package, unique.size());
+                unique << provider;
+            } else if (provider.command == trimmed) {
+                unique[it.value()].command = provider.command;
+            }
+        }
+
+        const SearchRanking::Query query(trimmed);
+        SearchRanking::TopK best(kMaxResults);
+        for (int i = 0; i < unique.size(); ++i) {
+            const double exact = unique.at(i).command == trimmed ? 1000.0 : 0.0; // providing the very command beats any name match
+            best.offer(exact + SearchRanking::score(query, unique.at(i).package, QString()), i);
+        }
+        const QVector<int> order = best.take();
+
+        QStringList packages;
+        for (int index : order) packages << unique.at(index).package;
+        const auto [described, descriptions, describe_error] = PackageIndex::describe(packages); // fails quietly without an index
+
+        QStringList result;
+        for (int i = 0; i < order.size(); ++i) {
+            const Provider& provider = unique.at(order.at(i));
+            QJsonObject object;
+            object["name"] = provider.package;
+            object["summary"] = "provides " + provider.command;
+            object["version"] = "";
+            object["last_updated"] = "";
+            object["command"] = provider.command;
+            if (described && i < descriptions.size()) {
+                const QJsonObject known = QJsonDocument::fromJson(descriptions.at(i).toUtf8()).object();
+                if (known["found"].toBool()) {
+                    if (!known["summary"].toString().isEmpty()) object["summary"] = known["summary"];
+                    object["version"] = known["version"];
+                }
+            }
+            result << QJsonDocument(object).toJson(QJsonDocument::Compact);
+        }
+
+        if (result.isEmpty()) {
+            return {false, result, QStringList{QString("No package provides '%1'!").arg(trimmed)}};
+        }
+        return {true, result, QStringList()};
+    }
+}
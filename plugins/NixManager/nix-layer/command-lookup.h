@@ -0,0 +1,65 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef COMMAND_LOOKUP_H
+#define COMMAND_LOOKUP_H
+
+#include <tuple>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Finds the packages that provide a command ("rg" -> ripgrep).
+ *
+ * nixpkgs channels ship programs.sqlite, the database behind command-not-found
+ * (table Programs: name, system, package). It is opened read-only and memory-mapped
+ * straight from the nixpkgs channel in ~/.nix-defexpr, so a lookup needs neither an
+ * evaluation nor the network.
+ */
+namespace CommandLookup {
+
+    /**
+    * @brief A command lookup returns at most this many packages.
+    */
+    const int kMaxResults = 50;
+
+    /**
+    * @brief Path of the channel's programs.sqlite, empty if the nixpkgs channel has none.
+    */
+    QString database_path();
+
+    /**
+    * @brief Packages providing a command on this device's platform.
+    *
+    * Packages providing exactly this command come first, then the ones providing commands
+    * starting with it, each group ordered by SearchRanking. Packages the local index knows
+    * get its description and version.
+    *
+    * @param command The command, e.g. "rg".
+    * @return A tuple containing:
+    * - bool success: True if the database could be read and something provides the command.
+    * - QStringList results: JSON (like) objects {"name", "summary", "version", "last_updated", "command"}, like PackageIndex::search.
+    * - QStringList full_error: error messages.
+    */
+    std::tuple<bool, QStringList, QStringList>
+    search(const QString& command);
+}
+
+#endif // COMMAND_LOOKUP_H
@@ -0,0 +1,199 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "config-graph.h"
+#include "../libs/package-set.h"
+
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
+namespace ConfigGraph {
+
+    static QMutex s_mutex; // guards s_graphs, graphs themselves are immutable
+    static QHash<QString, GraphPtr> s_graphs;
+
+    QStringList Graph::files() const {
+        QStringList files;
+        for (const auto& document : documents) {
+            if (document->readable) files.append(document->path);
+        }
+        return files;
+    }
+
+    QStringList Graph::packages(const QString& package_type) const {
+        QStringList packages;
+        for (const auto& document : documents) packages += document->packages(package_type);
+        return packages;
+    }
+
+    // the same file reached through a symlink or "../" is visited once
+    static QString identity(const QString& path) {
+        const QString canonical = QFileInfo(path).canonicalFilePath();
+        return canonical.isEmpty() ? path : canonical;
+    }
+
+    static void build_index(Graph& graph) {
+        for (const auto& document : graph.documents) {
+            for (int block = 0; block < document->blocks.size(); ++block) {
+                for (const auto& entry : document->entries.at(block)) {
+                    if (entry.name.isEmpty()) continue;
+                    graph.index[PackageSet::normalized(entry.name)].append(
+                        {document->path, document->blocks.at(block).package_type, entry.line, entry.conditional});
+                }
+            }
+        }
+    }
+
+    GraphPtr load(const QString& root) {
+        // on the calling thread: unchanged files are only a stat thanks to the per-file cache, and
+        // resolving `~/` imports may need the login environment, which lives in the worker's shell pool
+        QVector<ConfigDocument::DocumentPtr> documents;
+        QSet<QString> seen({identity(root)});
+        QStringList queue({root});
+        for (int i = 0; i < queue.size(); ++i) { // breadth first, each level of imports after the one naming it
+            const ConfigDocument::DocumentPtr document = ConfigDocument::load(queue.at(i));
+            documents.append(document);
+            for (const QString& path : document->imports) {
+                const QString id = identity(path);
+                if (seen.contains(id)) continue;
+                seen.insert(id);
+                queue.append(path);
+            }
+        }
+
+        {
+            QMutexLocker locker(&s_mutex);
+            const GraphPtr previous = s_graphs.value(root);
+            if (previous && previous->documents == documents) return previous; // same file models, nothing changed
+        }
+
+        auto graph = std::make_shared<Graph>();
+        graph->root = root;
+        graph->documents = documents;
+        build_index(*graph);
+
+        QMutexLocker locker(&s_mutex);
+        s_graphs.insert(root, graph);
+        return graph;
+    }
+
+    Plan plan(const Graph& graph, const QStringList& to_add, const QStringList& to_delete,
+              const QString& package_type, bool overwrite) {
+        Plan result;
+        const ConfigDocument::Document& root = *graph.documents.first();
+        if (!root.readable) {
+            result.error = QStringLiteral("%1 could not be read.").arg(root.path);
+            return result;
+        }
+
+        int target = -1; // where added packages go
+        bool any_blocks = false;
+        for (int i = 0; i < graph.documents.size(); ++i) {
+            const ConfigDocument::Document& document = *graph.documents.at(i);
+            if (document.readable && !document.parsed) {
+                result.error = QStringLiteral("%1 is not valid Nix (unterminated string, comment or bracket).").arg(document.path);
+                return result;
+            }
+            any_blocks = any_blocks || !document.blocks.isEmpty();
+            if (target == -1 && !package_type.isEmpty() && document.block_index(package_type) != -1) target = i;
+        }
+        if (!any_blocks) {
+            result.error = QStringLiteral("%1 and the modules it imports have no package blocks.").arg(root.path);
+            return result;
+        }
+        if (target == -1 && (!package_type.isEmpty() || !to_add.isEmpty() || overwrite)) {
+            result.error = QStringLiteral("%1 and the modules it imports have no '%2' package block.").arg(root.path, package_type);
+            return result;
+        }
+
+        const PackageSet::Set wanted(to_add);
+        const PackageSet::Set unwanted(to_delete);
+        const QString target_file = target == -1 ? QString() : graph.documents.at(target)->path;
+
+        // the files that list a package to delete, nothing else has to be looked at
+        QSet<QString> owners;
+        for (const QString& name : unwanted.names()) {
+            for (const Location& location : graph.index.value(name)) {
+                if (package_type.isEmpty() || location.package_type == package_type) owners.insert(location.file);
+            }
+        }
+
+        // a package another file keeps listing is not added to the target again
+        QStringList adds;
+        for (const QString& name : wanted.names()) {
+            bool elsewhere = false;
+            if (!unwanted.contains(name)) {
+                for (const Location& location : graph.index.value(name)) {
+                    if (location.file != target_file && location.package_type == package_type && !location.conditional) elsewhere = true;
+                }
+            }
+            if (!elsewhere) adds.append(name);
+        }
+
+        PackageSet::Set added;
+        PackageSet::Set deleted;
+        for (int i = 0; i < graph.documents.size(); ++i) {
+            const ConfigDocument::DocumentPtr& document = graph.documents.at(i);
+            if (!document->readable || document->blocks.isEmpty()) continue;
+            if (!package_type.isEmpty() && document->block_index(package_type) == -1) continue;
+
+            QStringList deletes;
+            if (overwrite) deletes = to_delete + PackageSet::diff(document->packages(package_type), to_add).removed;
+            else if (owners.contains(document->path)) deletes = to_delete;
+            const bool adding = i == target && !adds.isEmpty();
+            if (deletes.isEmpty() && !adding) continue;
+
+            const ConfigEdit::Plan file_plan = ConfigEdit::plan(*document, adding ? adds : QStringList(), deletes, package_type);
+            if (!file_plan.ok) {
+                result.error = file_plan.error;
+                return result;
+            }
+            for (const QString& name : file_plan.added) {
+                if (added.insert(name)) result.added.append(name);
+            }
+            for (const QString& name : file_plan.deleted) {
+                if (deleted.insert(name)) result.deleted.append(name);
+            }
+            if (!file_plan.splices.isEmpty()) result.files.append({document, file_plan});
+        }
+        result.ok = true;
+        return result;
+    }
+
+    bool write(const Plan& plan, QString& error) {
+        for (const FilePlan& file : plan.files) {
+            if (!ConfigDocument::save(file.document->path, ConfigEdit::apply(file.document->text, file.plan.splices))) {
+                error = QStringLiteral("%1 could not be written.").arg(file.document->path);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    QStringList diff(const Plan& plan) {
+        QStringList out;
+        for (const FilePlan& file : plan.files) {
+            out += ConfigEdit::diff(file.document->path, file.document->text, file.plan.splices);
+        }
+        return out;
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef CONFIG_GRAPH_H
+#define CONFIG_GRAPH_H
+
+#include "nix-config.h"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <memory>
+
+/**
+ * @brief A configuration file together with every module it imports.
+ *
+ * home.nix often only lists a few packages itself and pulls the rest in with
+ * `imports = [ ./desktop.nix ./dev ];`. The graph follows those imports (recursively,
+ * each file once) and indexes which file lists which package, so reads and edits cover
+ * the whole configuration. Files come from the ConfigDocument cache, so a file is only
+ * read and parsed again when it changed.
+ */
+namespace ConfigGraph {
+
+    /**
+     * @brief One place a package is listed.
+     */
+    struct Location {
+        QString file;              ///< The module that lists it.
+        QString package_type;      ///< The package block it is in (e.g. "home").
+        int line = -1;             ///< 0-indexed line of the element.
+        bool conditional = false;  ///< The element is in a conditional list.
+    };
+
+    /**
+     * @brief The configuration and its imported modules, immutable once built.
+     */
+    struct Graph {
+        QString root;                                       ///< The configuration file the graph starts at.
+        QVector<ConfigDocument::DocumentPtr> documents;     ///< The root first, then its imports breadth first, every file once.
+        QHash<QString, QVector<Location>> index;            ///< Normalized package -> where it is listed, in document order.
+
+        /**
+         * @brief Paths of every file of the graph that could be read, root first.
+         */
+        QStringList files() const;
+
+        /**
+         * @brief Packages of every block of a package type in every file, in document order.
+         */
+        QStringList packages(const QString& package_type) const;
+    };
+
+    using GraphPtr = std::shared_ptr<const Graph>;
+
+    /**
+     * @brief Returns the graph of a configuration file, reading only files that changed.
+     *
+     * Imports are followed breadth first, each file once. If none of the files changed since the
+     * last call for the same root, the previous graph (and its index) is returned as is.
+     *
+     * @param root The full path to the Nix configuration file.
+     * @return The graph, with an unreadable root as its only (not readable) document if root could not be read.
+     */
+    GraphPtr load(const QString& root);
+
+    /**
+     * @brief The edit of one file of the graph.
+     */
+    struct FilePlan {
+        ConfigDocument::DocumentPtr document;
+        ConfigEdit::Plan plan;
+    };
+
+    /**
+     * @brief The edits that add and delete packages across the graph.
+     */
+    struct Plan {
+        bool ok = false;            ///< False if the edit cannot be made, see error.
+        QString error;              ///< Why the edit cannot be made.
+        QVector<FilePlan> files;    ///< Only the files that change, in document order.
+        QStringList added;          ///< Packages that were not listed anywhere yet.
+        QStringList deleted;        ///< Packages that were found and are removed (from any file).
+    };
+
+    /**
+     * @brief Plans adding and deleting packages across the graph, see ConfigEdit::plan().
+     *
+     * Packages are deleted from every file the index lists them in. Added packages go to
+     * the first file (root first) that has a block of package_type, packages another file
+     * already lists are not added again. Files nothing is deleted from or added to are not
+     * looked at.
+     *
+     * @param graph The configuration to edit.
+     * @param to_add Packages to add.
+     * @param to_delete Packages to delete.
+     * @param package_type The type of package block to change (e.g., "home"), empty only to delete from all blocks.
+     * @param overwrite If true, every package of package_type that is not in to_add is deleted, in every file.
+     */
+    Plan plan(const Graph& graph, const QStringList& to_add, const QStringList& to_delete,
+              const QString& package_type, bool overwrite = false);
+
+    /**
+     * @brief Writes every file of a plan, each once.
+     *
+     * @param error Set to the file that could not be written, files before it are already written.
+     * @return True if every file was written.
+     */
+    bool write(const Plan& plan, QString& error);
+
+    /**
+     * @brief Unified diff of a plan, see ConfigEdit::diff(), one file after the other.
+     */
+    QStringList diff(const Plan& plan);
+}
+
+#endif // CONFIG_GRAPH_H
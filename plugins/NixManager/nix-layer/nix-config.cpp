@@ -20,117 +20,853 @@
 
 
 #include "nix-config.h"
+#include "config-graph.h"
+#include "../libs/login-env.h"
+#include "../libs/package-set.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
 
 // Function to trim leading/trailing whitespace from a string
 QString trim(const QString& str) {
-    size_t first = str.toStdString().find_first_not_of(" \t\n\r\f\v");
-    if (std::string::npos == first) {
-        return str;
-    }
-    size_t last = str.toStdString().find_last_not_of(" \t\n\r\f\v");
-    return QString::fromStdString(str.toStdString().substr(first, (last - first + 1)));
+    return str.trimmed();
 }
 
 // Function to get leading whitespace length
 int getLeadingWhitespaceLength(const QString& str) {
-    size_t first = str.toStdString().find_first_not_of(" \t\n\r\f\v");
-    if (std::string::npos == first) {
-       return str.length();
+    int first = 0;
+    while (first < str.length() && str.at(first).isSpace()) {
+        ++first;
     }
     return first;
 }
 
 
-QStringList readFile(const QString &path) {
+// whole file in one read, lines are split from the same buffer so byte offsets and line numbers agree
+QByteArray readFile(const QString &path, bool* ok = nullptr) {
     QFile file(path);
-    QStringList lines;
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return lines; // empty on error
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-        lines.append(in.readLine());
-    }
+    const bool opened = file.open(QIODevice::ReadOnly);
+    if (ok) *ok = opened;
+    if (!opened) return QByteArray(); // empty on error
+    QByteArray text = file.readAll();
     file.close();
+    return text;
+}
+
+
+// same lines QTextStream::readLine would give, without a trailing empty line
+QStringList splitLines(const QByteArray &text) {
+    QStringList lines = QString::fromUtf8(text).split('\n');
+    if (!lines.isEmpty() && lines.last().isEmpty()) lines.removeLast();
+    for (QString &line : lines) {
+        if (line.endsWith('\r')) line.chop(1);
+    }
     return lines;
 }
 
 
-bool writeFile(const QString &path, const QStringList &lines) {
+// writes text as is, edits are spliced into the bytes that were read so nothing else of the file changes
+bool writeFile(const QString &path, const QByteArray &text) {
     QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
-    QTextStream out(&file);
-    for (const QString &line : lines) {
-        out << line << '\n'; // this single line is responsible for config file working DO NOT CHANGE or you will wreck all newline char
-    }
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    const bool written = file.write(text) == text.size();
     file.close();
-    return true;
+    return written;
 }
 
-namespace FileProcessing {
+namespace NixSyntax {
+
+    enum class TokenKind {
+        Identifier,     // also keywords (with, let, in, rec, inherit, or...)
+        Dot,
+        Assign,
+        Semicolon,
+        Concat,         // ++
+        OpenBracket,
+        CloseBracket,
+        OpenParen,
+        CloseParen,
+        OpenBrace,
+        CloseBrace,
+        Interpolation,  // ${ outside of a string, closed by CloseBrace
+        String,         // "..." or ''...'', interpolations included
+        Path,           // ./x.nix, /abs, ~/x, <nixpkgs>
+        Number,
+        Other           // any other operator or byte
+    };
 
-    // Structure to represent a package block    // defined in header!
-    // struct PackageBlock {
-    //     std::string package_type;
-    //     int start_line;
-    //     int end_line;
-    //     int start_indent;
-    // };
+    struct Token {
+        TokenKind kind;
+        int begin;      // byte offsets into the text, end is exclusive
+        int end;
+        int line;       // 0-indexed
+        int match;      // index of the matching bracket token, -1 if none
+    };
+
+    static bool is_id_start(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    static bool is_id_char(char c) {
+        return is_id_start(c) || (c >= '0' && c <= '9') || c == '\'' || c == '-';
+    }
+
+    static bool is_path_char(char c) {
+        return is_id_start(c) || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '+' || c == '/';
+    }
+
+    static bool is_uri_char(char c) {
+        return is_path_char(c) || (c != '\0' && std::strchr("%?:@&=$,!~*'_", c) != nullptr);
+    }
 
     /**
-     * @brief Generates a list of packages from a configuration file.
+     * @brief Splits Nix source into tokens, every byte is looked at a constant number of times.
      *
-     * The function reads a configuration file, identifies the '.packages' block,
-     * and extracts the package type, start line, and end line. It returns a list
-     * of PackageBlock structs, where each struct represents a .packages block.
+     * Strings (interpolations included) become one token, comments and whitespace are dropped.
+     */
+    class Lexer {
+    public:
+        explicit Lexer(const QByteArray& text) : m_data(text.constData()), m_size(text.size()) {}
+
+        // tokenizes the whole text, false if a string or comment is not terminated or brackets do not match
+        bool run(QVector<Token>& tokens) {
+            Token token;
+            while (next(token)) tokens.append(token);
+            if (!m_ok) return false;
+
+            // lines, one pass over the text
+            int line = 0;
+            int pos = 0;
+            for (Token& t : tokens) {
+                for (; pos < t.begin; ++pos) {
+                    if (m_data[pos] == '\n') ++line;
+                }
+                t.line = line;
+            }
+
+            // brackets, one pass over the tokens
+            QVector<int> open;
+            for (int i = 0; i < tokens.size(); ++i) {
+                const TokenKind kind = tokens.at(i).kind;
+                if (kind == TokenKind::OpenBracket || kind == TokenKind::OpenParen ||
+                    kind == TokenKind::OpenBrace || kind == TokenKind::Interpolation) {
+                    open.append(i);
+                    continue;
+                }
+                TokenKind expected;
+                if (kind == TokenKind::CloseBracket) expected = TokenKind::OpenBracket;
+                else if (kind == TokenKind::CloseParen) expected = TokenKind::OpenParen;
+                else if (kind == TokenKind::CloseBrace) expected = TokenKind::OpenBrace;
+                else continue;
+                if (open.isEmpty()) return false;
+                const int o = open.takeLast();
+                const TokenKind opened = tokens.at(o).kind;
+                if (opened != expected && !(expected == TokenKind::OpenBrace && opened == TokenKind::Interpolation)) return false;
+                tokens[o].match = i;
+                tokens[i].match = o;
+            }
+            return open.isEmpty();
+        }
+
+    private:
+        char peek(int offset) const {
+            return m_pos + offset < m_size ? m_data[m_pos + offset] : '\0';
+        }
+
+        void skip_trivia() {
+            while (m_pos < m_size) {
+                const char c = m_data[m_pos];
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                    ++m_pos;
+                } else if (c == '#') {
+                    while (m_pos < m_size && m_data[m_pos] != '\n') ++m_pos;
+                } else if (c == '/' && peek(1) == '*') {
+                    m_pos += 2;
+                    while (m_pos < m_size && !(m_data[m_pos] == '*' && peek(1) == '/')) ++m_pos;
+                    if (m_pos >= m_size) {
+                        m_ok = false; // unterminated comment
+                        return;
+                    }
+                    m_pos += 2;
+                } else {
+                    return;
+                }
+            }
+        }
+
+        // m_pos is right after "${", stops after the matching '}'
+        bool skip_interpolation() {
+            int depth = 1;
+            Token token;
+            while (next(token)) {
+                if (token.kind == TokenKind::OpenBrace || token.kind == TokenKind::Interpolation) {
+                    ++depth;
+                } else if (token.kind == TokenKind::CloseBrace && --depth == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // m_pos is on the opening quote
+        bool skip_string() {
+            ++m_pos;
+            while (m_pos < m_size) {
+                const char c = m_data[m_pos];
+                if (c == '\\') {
+                    m_pos += 2;
+                } else if (c == '"') {
+                    ++m_pos;
+                    return true;
+                } else if (c == '$' && peek(1) == '$') {
+                    m_pos += 2;
+                } else if (c == '$' && peek(1) == '{') {
+                    m_pos += 2;
+                    if (!skip_interpolation()) return false;
+                } else {
+                    ++m_pos;
+                }
+            }
+            return false;
+        }
+
+        // m_pos is on the opening ''
+        bool skip_indented_string() {
+            m_pos += 2;
+            while (m_pos < m_size) {
+                const char c = m_data[m_pos];
+                if (c == '\'' && peek(1) == '\'') {
+                    if (peek(2) == '\'' || peek(2) == '$') {
+                        m_pos += 3; // ''' and ''$ escapes
+                    } else if (peek(2) == '\\') {
+                        m_pos += 4; // ''\ escapes the next character
+                    } else {
+                        m_pos += 2;
+                        return true;
+                    }
+                } else if (c == '$' && peek(1) == '$') {
+                    m_pos += 2;
+                } else if (c == '$' && peek(1) == '{') {
+                    m_pos += 2;
+                    if (!skip_interpolation()) return false;
+                } else {
+                    ++m_pos;
+                }
+            }
+            return false;
+        }
+
+        // length of a <...> search path at m_pos, 0 if it is a comparison
+        int angle_path_length() const {
+            int end = m_pos + 1;
+            while (end < m_size && is_path_char(m_data[end])) ++end;
+            return end > m_pos + 1 && end < m_size && m_data[end] == '>' ? end + 1 - m_pos : 0;
+        }
+
+        bool next(Token& token) {
+            skip_trivia();
+            if (!m_ok || m_pos >= m_size) return false;
+
+            const int begin = m_pos;
+            const char c = m_data[m_pos];
+            TokenKind kind = TokenKind::Other;
+            if (c == '"') {
+                kind = TokenKind::String;
+                if (!skip_string()) m_ok = false;
+            } else if (c == '\'' && peek(1) == '\'') {
+                kind = TokenKind::String;
+                if (!skip_indented_string()) m_ok = false;
+            } else if ((c == '.' && (peek(1) == '/' || (peek(1) == '.' && peek(2) == '/'))) ||
+                       (c == '~' && peek(1) == '/') ||
+                       (c == '/' && peek(1) != '/' && is_path_char(peek(1)))) {
+                kind = TokenKind::Path;
+                if (c == '~') ++m_pos; // not a path character itself
+                while (m_pos < m_size && is_path_char(m_data[m_pos])) ++m_pos;
+            } else if (c == '<' && angle_path_length() > 0) {
+                kind = TokenKind::Path;
+                m_pos += angle_path_length();
+            } else if (is_id_start(c)) {
+                kind = TokenKind::Identifier;
+                while (m_pos < m_size && is_id_char(m_data[m_pos])) ++m_pos;
+                if (peek(0) == ':' && is_uri_char(peek(1))) { // https://example.org is a (deprecated) URI literal
+                    kind = TokenKind::String;
+                    ++m_pos;
+                    while (m_pos < m_size && is_uri_char(m_data[m_pos])) ++m_pos;
+                } else if (peek(0) == '/' && peek(1) != '/' && is_path_char(peek(1))) { // foo/bar is a relative path
+                    kind = TokenKind::Path;
+                    while (m_pos < m_size && is_path_char(m_data[m_pos])) ++m_pos;
+                }
+            } else if (c >= '0' && c <= '9') {
+                kind = TokenKind::Number;
+                while (m_pos < m_size && (is_id_char(m_data[m_pos]) || m_data[m_pos] == '.')) ++m_pos;
+            } else if (c == '$' && peek(1) == '{') {
+                kind = TokenKind::Interpolation;
+                m_pos += 2;
+            } else if (c == '+' && peek(1) == '+') {
+                kind = TokenKind::Concat;
+                m_pos += 2;
+            } else if (c == '.' && peek(1) == '.' && peek(2) == '.') {
+                m_pos += 3; // ellipsis of a function argument set
+            } else if ((c == '=' || c == '!' || c == '<' || c == '>') && peek(1) == '=') {
+                m_pos += 2;
+            } else if ((c == '/' && peek(1) == '/') || (c == '&' && peek(1) == '&') ||
+                       (c == '|' && peek(1) == '|') || (c == '-' && peek(1) == '>')) {
+                m_pos += 2;
+            } else {
+                switch (c) {
+                case '.': kind = TokenKind::Dot; break;
+                case '=': kind = TokenKind::Assign; break;
+                case ';': kind = TokenKind::Semicolon; break;
+                case '[': kind = TokenKind::OpenBracket; break;
+                case ']': kind = TokenKind::CloseBracket; break;
+                case '(': kind = TokenKind::OpenParen; break;
+                case ')': kind = TokenKind::CloseParen; break;
+                case '{': kind = TokenKind::OpenBrace; break;
+                case '}': kind = TokenKind::CloseBrace; break;
+                default: break;
+                }
+                ++m_pos;
+            }
+
+            token = {kind, begin, qMin(m_pos, m_size), 0, -1};
+            return true;
+        }
+
+        const char* m_data;
+        int m_size;
+        int m_pos = 0;
+        bool m_ok = true;
+    };
+
+    /**
+     * @brief Finds package list bindings (home.packages, environment.systemPackages...) in a token stream.
      *
-     * @param filename The path to the configuration file.
-     * @return A list of PackageBlock structs, where each struct represents a package.
+     * Every token is visited once by the binding scan and at most once more by the value
+     * parser of the binding it belongs to, bracket groups are skipped through their match.
+     * The path literals of the module's top-level `imports` list are collected on the way.
      */
-   QVector<PackageBlock> process_file(const QString& filename) {
-        QVector<PackageBlock> package_blocks;
-        PackageBlock current_package_block;
-        current_package_block.package_type = "";
-        current_package_block.start_line = -1;
-        current_package_block.end_line = -1;
-        current_package_block.start_indent = -1;
-
-        try {
-            QStringList lines = readFile(filename);
-            int i = 0;
-            for (const QString &line : lines) {
-                QString stripped_line = trim(line);
-                if (current_package_block.start_line == -1 && line.contains(".packages") && !stripped_line.startsWith('#')) { // must not be a comment, must have a ".packages" and be on start of block.
-                    current_package_block.start_indent = getLeadingWhitespaceLength(line);
-                    qsizetype pos = line.indexOf(".packages");
-                    if (pos == -1) continue;
-                    QString package_type = line.left(pos).trimmed();
-                    current_package_block.package_type = package_type;
-                    current_package_block.start_line = i + 1; // so line after home.packages = [
-                } else if (current_package_block.start_line == -1 && line.contains(".systemPackages") && !stripped_line.startsWith('#')) { // obsulete check useful only in case configuration.nix is used.
-                    current_package_block.start_indent = getLeadingWhitespaceLength(line);
-                    current_package_block.package_type = "system";
-                    current_package_block.start_line = i + 1; // so line after home.packages = [
-                } else if (current_package_block.start_line != -1 && !stripped_line.startsWith('#') && // must not be a comment/on the same indent as start, must have a "];" and not be on start of block.
-                           getLeadingWhitespaceLength(line) == current_package_block.start_indent &&
-                           line.contains("];")) {
-                    current_package_block.end_line = i - 1; // so line before ];
-                    package_blocks.push_back(current_package_block);
-                    current_package_block.package_type = ""; //reset
-                    current_package_block.start_line = -1; // taking advantage of the fact -1 is not valid line number for conditional checks with minimal logic.
-                    current_package_block.end_line = -1; // set to -1 so there will be an error if it is not set.
-                    current_package_block.start_indent = -1; // set to -1 so there will be an error if it is not set.
+    class Parser {
+    public:
+        Parser(const QByteArray& text, const QVector<Token>& tokens,
+               QVector<FileProcessing::PackageBlock>& blocks, QVector<QVector<ConfigDocument::PackageEntry>>& entries,
+               QStringList* imports = nullptr)
+            : m_text(text), m_tokens(tokens), m_blocks(blocks), m_entries(entries), m_imports(imports) {}
+
+        void run() {
+            struct Scope {
+                int close;      // token index that ends the scope, -1 for let (ends at "in")
+                bool attrs;     // bindings in it are attributes
+                QString prefix; // attribute path of the set
+            };
+            QVector<Scope> scopes;
+            QHash<int, QString> set_prefixes; // '{' token index -> attribute path the set is bound to
+
+            for (int i = 0; i < m_tokens.size(); ++i) {
+                const Token& token = m_tokens.at(i);
+                if (token.kind == TokenKind::OpenBrace) {
+                    if (token.match + 1 < m_tokens.size() && is_char(token.match + 1, ':')) {
+                        add_arguments(i); // { config, pkgs, ... }: a function, not an attribute set
+                        i = token.match;
+                        continue;
+                    }
+                    scopes.append({token.match, true, set_prefixes.value(i)});
+                    continue;
+                }
+                if (token.kind == TokenKind::Interpolation) {
+                    scopes.append({token.match, false, QString()});
+                    continue;
+                }
+                if (token.kind == TokenKind::CloseBrace) {
+                    while (!scopes.isEmpty() && scopes.last().close != i) scopes.removeLast(); // unclosed lets
+                    if (!scopes.isEmpty()) scopes.removeLast();
+                    continue;
+                }
+                if (is_word(i, "let")) {
+                    scopes.append({-1, false, QString()});
+                    continue;
+                }
+                if (is_word(i, "in") && !scopes.isEmpty() && scopes.last().close == -1) {
+                    scopes.removeLast();
+                    continue;
+                }
+
+                // attrpath = value; starts a binding right after '{' or ';' of an attribute set (or "let")
+                if (scopes.isEmpty() || i == 0) continue;
+                const TokenKind before = m_tokens.at(i - 1).kind;
+                if (before != TokenKind::OpenBrace && before != TokenKind::Semicolon && !is_word(i - 1, "let")) continue;
+                if (!scopes.last().attrs) {
+                    if (scopes.last().close == -1 && token.kind == TokenKind::Identifier &&
+                        i + 1 < m_tokens.size() && m_tokens.at(i + 1).kind == TokenKind::Assign) {
+                        m_lexical.insert(source(token.begin, token.end));
+                    }
+                    continue;
+                }
+
+                QStringList path;
+                int j = i;
+                while (j < m_tokens.size() && (m_tokens.at(j).kind == TokenKind::Identifier || m_tokens.at(j).kind == TokenKind::String)) {
+                    path.append(attr_name(j));
+                    if (j + 1 < m_tokens.size() && m_tokens.at(j + 1).kind == TokenKind::Dot) j += 2;
+                    else {
+                        ++j;
+                        break;
+                    }
+                }
+                if (path.isEmpty() || j >= m_tokens.size() || m_tokens.at(j).kind != TokenKind::Assign) continue;
+
+                const QString& prefix = scopes.last().prefix;
+                if (!prefix.isEmpty()) path = prefix.split('.') + path;
+                const int value = j + 1;
+                if (value < m_tokens.size()) {
+                    int set = value;
+                    if (is_word(set, "rec")) ++set;
+                    if (set < m_tokens.size() && m_tokens.at(set).kind == TokenKind::OpenBrace) {
+                        set_prefixes.insert(set, path.join('.'));
+                    }
+                }
+
+                if (path.size() == 1 && path.first() == QLatin1String("imports")) {
+                    add_imports(value);
+                    continue;
+                }
 
+                const QString last = path.takeLast();
+                if (last == QLatin1String("systemPackages")) {
+                    add_block(QStringLiteral("system"), i, value);
+                } else if (last == QLatin1String("packages") && !path.isEmpty()) {
+                    add_block(path.join('.'), i, value);
                 }
-                i++;
             }
-        } catch (const std::exception& e) {
-            qDebug() << "Exception occurred! , error is " << e.what();
         }
 
-        return package_blocks;
+    private:
+        bool is_word(int i, const char* word) const {
+            if (i >= m_tokens.size() || m_tokens.at(i).kind != TokenKind::Identifier) return false;
+            const Token& token = m_tokens.at(i);
+            const int length = token.end - token.begin;
+            return int(qstrlen(word)) == length && qstrncmp(m_text.constData() + token.begin, word, length) == 0;
+        }
+
+        bool is_char(int i, char c) const {
+            const Token& token = m_tokens.at(i);
+            return token.end - token.begin == 1 && m_text.at(token.begin) == c;
+        }
+
+        // remembers the names a function argument set binds, the '{' is at open
+        void add_arguments(int open) {
+            const int close = m_tokens.at(open).match;
+            for (int i = open + 1; i < close; i = skip_atom(i)) {
+                if (m_tokens.at(i).kind == TokenKind::Identifier && (i == open + 1 || is_char(i - 1, ','))) {
+                    m_lexical.insert(source(m_tokens.at(i).begin, m_tokens.at(i).end));
+                }
+            }
+        }
+
+        QString source(int begin, int end) const {
+            return QString::fromUtf8(m_text.constData() + begin, end - begin);
+        }
+
+        // one attribute path component, quotes of "quoted" names dropped
+        QString attr_name(int i) const {
+            const Token& token = m_tokens.at(i);
+            if (token.kind == TokenKind::String && token.end - token.begin >= 2 && m_text.at(token.begin) == '"') {
+                return source(token.begin + 1, token.end - 1);
+            }
+            return source(token.begin, token.end);
+        }
+
+        int skip_atom(int i) const {
+            const int match = m_tokens.at(i).match;
+            return match > i ? match + 1 : i + 1;
+        }
+
+        // index of the ';' that ends "with x;" / "assert x;" starting at i, end if there is none
+        int next_semicolon(int i, int end) const {
+            while (i < end && m_tokens.at(i).kind != TokenKind::Semicolon) i = skip_atom(i);
+            return i;
+        }
+
+        // index after the "in" of a let starting at i (the token after "let")
+        int skip_let(int i, int end) const {
+            int depth = 1;
+            while (i < end) {
+                if (is_word(i, "let")) ++depth;
+                else if (is_word(i, "in") && --depth == 0) return i + 1;
+                i = skip_atom(i);
+            }
+            return end;
+        }
+
+        // index of the ';' that ends the binding value starting at i
+        int value_end(int i) const {
+            const int end = m_tokens.size();
+            while (i < end) {
+                const TokenKind kind = m_tokens.at(i).kind;
+                if (kind == TokenKind::Semicolon || kind == TokenKind::CloseBrace ||
+                    kind == TokenKind::CloseBracket || kind == TokenKind::CloseParen) return i;
+                if (is_word(i, "with") || is_word(i, "assert")) i = next_semicolon(i + 1, end) + 1;
+                else if (is_word(i, "let")) i = skip_let(i + 1, end);
+                else i = skip_atom(i);
+            }
+            return end;
+        }
+
+        int indent_of_line(int offset) const {
+            int start = offset;
+            while (start > 0 && m_text.at(start - 1) != '\n') --start;
+            int indent = 0;
+            while (start + indent < offset && (m_text.at(start + indent) == ' ' || m_text.at(start + indent) == '\t')) ++indent;
+            return indent;
+        }
+
+        void add_block(const QString& package_type, int binding, int value) {
+            FileProcessing::PackageBlock block;
+            block.package_type = package_type;
+            block.start_line = -1;
+            block.end_line = -1;
+            block.start_indent = indent_of_line(m_tokens.at(binding).begin);
+            block.binding_begin = m_tokens.at(binding).begin;
+
+            const int end = value_end(value);
+            block.value_begin = value < end ? m_tokens.at(value).begin : m_tokens.at(value - 1).end;
+            block.value_end = value < end ? m_tokens.at(end - 1).end : block.value_begin;
+
+            m_block = &block;
+            m_current_entries.clear();
+            parse_expression(value, end, false, false);
+
+            if (block.list_open != -1) {
+                const int open = m_list_open_token;
+                block.start_line = m_tokens.at(open).line + 1;
+                block.end_line = m_tokens.at(m_tokens.at(open).match).line - 1;
+            }
+
+            m_blocks.append(block);
+            m_entries.append(m_current_entries);
+            m_block = nullptr;
+        }
+
+        // path literals of "imports = [ ./a.nix ./b ] ++ [ ... ];", anything else in the lists is not a file we can follow
+        void add_imports(int value) {
+            if (!m_imports) return;
+            const int end = value_end(value);
+            for (int i = value; i < end; i = skip_atom(i)) {
+                if (m_tokens.at(i).kind != TokenKind::OpenBracket) continue;
+                const int close = m_tokens.at(i).match;
+                for (int element = i + 1; element < close; element = skip_atom(element)) {
+                    const Token& token = m_tokens.at(element);
+                    if (token.kind != TokenKind::Path || m_text.at(token.begin) == '<') continue;
+                    // ./${name}.nix lexes as several tokens without space between them
+                    if (m_tokens.at(element - 1).end == token.begin && element - 1 != i) continue;
+                    if (m_tokens.at(element + 1).begin == token.end && element + 1 != close) continue;
+                    m_imports->append(source(token.begin, token.end));
+                }
+            }
+        }
+
+        void parse_expression(int begin, int end, bool with_pkgs, bool conditional) {
+            if (begin >= end) return;
+            if (is_word(begin, "with")) {
+                const int semicolon = next_semicolon(begin + 1, end);
+                const bool scope_is_pkgs = semicolon == begin + 2 && is_word(begin + 1, "pkgs");
+                parse_expression(semicolon + 1, end, with_pkgs || scope_is_pkgs, conditional);
+                return;
+            }
+            if (is_word(begin, "assert")) {
+                parse_expression(next_semicolon(begin + 1, end) + 1, end, with_pkgs, conditional);
+                return;
+            }
+            if (is_word(begin, "let")) {
+                parse_expression(skip_let(begin + 1, end), end, with_pkgs, conditional);
+                return;
+            }
+
+            // a ++ b ++ c
+            int term = begin;
+            for (int i = begin; i <= end;) {
+                if (i == end || m_tokens.at(i).kind == TokenKind::Concat) {
+                    parse_term(term, i, with_pkgs, conditional);
+                    term = i + 1;
+                    ++i;
+                } else {
+                    i = skip_atom(i);
+                }
+            }
+        }
+
+        void parse_term(int begin, int end, bool with_pkgs, bool conditional) {
+            if (begin >= end) return;
+            const Token& first = m_tokens.at(begin);
+            if (first.kind == TokenKind::OpenBracket && first.match == end - 1) {
+                parse_list(begin, with_pkgs, conditional);
+                return;
+            }
+            if (first.kind == TokenKind::OpenParen && first.match == end - 1) {
+                parse_expression(begin + 1, end - 1, with_pkgs, conditional);
+                return;
+            }
+
+            // lib.optionals cond [ ... ], the condition can be any number of atoms
+            int head = begin;
+            while (head + 2 < end && m_tokens.at(head).kind == TokenKind::Identifier &&
+                   m_tokens.at(head + 1).kind == TokenKind::Dot) head += 2;
+            if (is_word(head, "optionals")) {
+                int last = head + 1;
+                for (int i = head + 1; i < end; i = skip_atom(i)) last = i;
+                if (last > head + 1 && m_tokens.at(last).kind == TokenKind::OpenBracket && m_tokens.at(last).match == end - 1) {
+                    parse_list(last, with_pkgs, true);
+                    return;
+                }
+            }
+        }
+
+        void parse_list(int open, bool with_pkgs, bool conditional) {
+            const int close = m_tokens.at(open).match;
+            if (!conditional && m_block->list_open == -1) {
+                m_block->list_open = m_tokens.at(open).begin;
+                m_block->list_close = m_tokens.at(close).begin;
+                m_block->list_with_pkgs = with_pkgs;
+                m_list_open_token = open;
+            }
+
+            for (int i = open + 1; i < close;) {
+                const int start = i;
+                bool attr_path = false;
+                if (m_tokens.at(i).kind == TokenKind::Identifier) {
+                    attr_path = true;
+                    ++i;
+                    while (i + 1 < close && m_tokens.at(i).kind == TokenKind::Dot &&
+                           (m_tokens.at(i + 1).kind == TokenKind::Identifier || m_tokens.at(i + 1).kind == TokenKind::String)) i += 2;
+                    if (i < close && is_word(i, "or") && i + 1 < close) { // pkgs.foo or null
+                        attr_path = false;
+                        i = skip_atom(i + 1);
+                    }
+                } else {
+                    i = skip_atom(i);
+                }
+
+                ConfigDocument::PackageEntry entry;
+                entry.text = source(m_tokens.at(start).begin, m_tokens.at(i - 1).end);
+                if (attr_path) {
+                    // under "with pkgs;" a name comes from pkgs unless a function argument or let binding shadows it
+                    const bool from_pkgs = with_pkgs && !m_lexical.contains(source(m_tokens.at(start).begin, m_tokens.at(start).end));
+                    entry.name = from_pkgs ? QStringLiteral("pkgs.") + entry.text : entry.text;
+                }
+                entry.line = m_tokens.at(start).line;
+                entry.begin = m_tokens.at(start).begin;
+                entry.end = m_tokens.at(i - 1).end;
+                entry.conditional = conditional;
+                m_current_entries.append(entry);
+            }
+        }
+
+        const QByteArray& m_text;
+        const QVector<Token>& m_tokens;
+        QVector<FileProcessing::PackageBlock>& m_blocks;
+        QVector<QVector<ConfigDocument::PackageEntry>>& m_entries;
+        QStringList* m_imports;
+
+        QSet<QString> m_lexical; // names bound by function arguments and lets, "with" does not shadow them
+
+        // state of the block add_block is working on
+        FileProcessing::PackageBlock* m_block = nullptr;
+        QVector<ConfigDocument::PackageEntry> m_current_entries;
+        int m_list_open_token = -1;
+    };
+
+} // namespace NixSyntax
+
+namespace FileProcessing {
+
+    /**
+     * @brief Finds the package blocks and their package entries of a configuration file.
+     *
+     * The text is tokenized once and the package list bindings (e.g. `home.packages = with pkgs; [ ... ];`)
+     * are parsed from the tokens, so lists on one line, several packages per line, `++`
+     * concatenations and `lib.optionals` are all seen, with the byte range of every element.
+     *
+     * @param text The configuration file.
+     * @param package_blocks Receives one PackageBlock struct per package list binding.
+     * @param entries Receives the package entries of package_blocks[i].
+     * @param imports If not null, receives the path literals of the `imports` list as written.
+     * @return False if the file is not valid Nix as far as the lexer can tell (nothing is found then).
+     */
+    static bool scan_text(const QByteArray& text, QVector<PackageBlock>& package_blocks,
+                          QVector<QVector<ConfigDocument::PackageEntry>>& entries, QStringList* imports = nullptr) {
+        QVector<NixSyntax::Token> tokens;
+        tokens.reserve(text.size() / 4);
+        if (!NixSyntax::Lexer(text).run(tokens)) {
+            qDebug() << "configuration file has an unterminated string, comment or bracket, not parsing it";
+            return false;
+        }
+        NixSyntax::Parser(text, tokens, package_blocks, entries, imports).run();
+        return true;
+    }
+
+    /**
+     * @brief Generates a list of packages from the lines of a configuration file.
+     *
+     * @param lines The configuration file, one entry per line.
+     * @return A list of PackageBlock structs, where each struct represents a package.
+     */
+    QVector<PackageBlock> process_lines(const QStringList& lines) {
+        return ConfigDocument::parse(QString(), lines)->blocks;
+    }
+
+    QVector<PackageBlock> process_file(const QString& filename) {
+        return ConfigDocument::load(filename)->blocks;
     }
 
 } // namespace FileProcessing
 
+namespace ConfigDocument {
+
+    // identifies one version of a file, any write changes at least one of these
+    struct FileStamp {
+        qint64 mtime_ns = 0;
+        qint64 size = 0;
+        quint64 inode = 0;
+
+        bool operator==(const FileStamp& other) const {
+            return mtime_ns == other.mtime_ns && size == other.size && inode == other.inode;
+        }
+    };
+
+    struct CacheEntry {
+        FileStamp stamp;
+        DocumentPtr document;
+    };
+
+    static QMutex s_mutex;  // guards s_cache, documents themselves are immutable
+    static QHash<QString, CacheEntry> s_cache;
+
+    static bool stamp_of(const QString& path, FileStamp& stamp) {
+        struct stat st;
+        if (::stat(QFile::encodeName(path).constData(), &st) != 0) return false;
+        stamp.mtime_ns = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        stamp.size = st.st_size;
+        stamp.inode = st.st_ino;
+        return true;
+    }
+
+    // absolute path of an imported path literal, a directory stands for its default.nix
+    static QString import_path(const QString& file, const QString& literal) {
+        QString path;
+        if (literal.startsWith(QLatin1String("~/"))) path = LoginEnvironment::home() + literal.mid(1);
+        else if (literal.startsWith('/')) path = literal;
+        else path = QFileInfo(file).absolutePath() + '/' + literal;
+        path = QDir::cleanPath(path);
+        if (QFileInfo(path).isDir()) path += QStringLiteral("/default.nix");
+        return path;
+    }
+
+    static std::shared_ptr<Document> build(const QString& path, const QByteArray& text) {
+        auto document = std::make_shared<Document>();
+        document->path = path;
+        document->readable = true;
+        document->text = text;
+        document->lines = splitLines(text);
+        QStringList imports;
+        document->parsed = FileProcessing::scan_text(document->text, document->blocks, document->entries, &imports);
+        if (!path.isEmpty()) {
+            for (const QString& literal : imports) document->imports.append(import_path(path, literal));
+        }
+        return document;
+    }
+
+    // the file lines make up, one '\n' after every line
+    static QByteArray join_lines(const QStringList& lines) {
+        QByteArray text;
+        for (const QString& line : lines) {
+            text += line.toUtf8();
+            text += '\n';
+        }
+        return text;
+    }
+
+    int Document::block_index(const QString& package_type) const {
+        for (int i = 0; i < blocks.size(); ++i) {
+            if (blocks.at(i).package_type == package_type) return i;
+        }
+        return -1;
+    }
+
+    QStringList Document::packages(const QString& package_type) const {
+        QStringList packages;
+        for (int i = 0; i < blocks.size(); ++i) {
+            if (blocks.at(i).package_type != package_type) continue;
+            for (const auto& entry : entries.at(i)) {
+                if (!entry.name.isEmpty()) packages.append(entry.name);
+            }
+        }
+        return packages;
+    }
+
+    DocumentPtr parse(const QString& path, const QStringList& lines) {
+        return build(path, join_lines(lines));
+    }
+
+    DocumentPtr parse(const QString& path, const QByteArray& text) {
+        return build(path, text);
+    }
+
+    DocumentPtr load(const QString& path) {
+        FileStamp stamp;
+        if (!stamp_of(path, stamp)) {
+            QMutexLocker locker(&s_mutex);
+            s_cache.remove(path);
+            auto document = std::make_shared<Document>();
+            document->path = path;
+            return document;
+        }
+
+        {
+            QMutexLocker locker(&s_mutex);
+            auto it = s_cache.constFind(path);
+            if (it != s_cache.constEnd() && it->stamp == stamp) return it->document;
+        }
+
+        // read without holding the lock, if the file changes after stat() the next load sees a new stamp and reads again
+        bool readable = false;
+        const QByteArray text = readFile(path, &readable);
+        if (!readable) {
+            auto document = std::make_shared<Document>();
+            document->path = path;
+            return document;
+        }
+
+        DocumentPtr document = build(path, text);
+        QMutexLocker locker(&s_mutex);
+        s_cache.insert(path, {stamp, document});
+        return document;
+    }
+
+    DocumentPtr save(const QString& path, const QByteArray& text) {
+        if (!writeFile(path, text)) {
+            QMutexLocker locker(&s_mutex);
+            s_cache.remove(path);
+            return DocumentPtr();
+        }
+
+        DocumentPtr document = build(path, text);
+        FileStamp stamp;
+        QMutexLocker locker(&s_mutex);
+        if (stamp_of(path, stamp)) s_cache.insert(path, {stamp, document});
+        else s_cache.remove(path);
+        return document;
+    }
+
+} // namespace ConfigDocument
+
 namespace PackageChecks {
 
     /**
@@ -159,181 +895,413 @@ namespace PackageChecks {
 
 } // namespace PackageChecks
 
-namespace PackageOperations {
+namespace ConfigEdit {
 
-    /**
-     * @brief Reads and extracts packages from a configuration file based on the specified packages type.
-     *
-     * @param filename The path to the configuration file.
-     * @param package_type The type of packages to extract (e.g., 'home', 'system').
-     * @return A list of packages extracted from the configuration file, filtered to exclude comments, newlines, and unsupported syntax.
-     */
-    QStringList read_packages(const QString& filename, const QString& package_type) {
-        QStringList packages;
-        QVector<FileProcessing::PackageBlock> package_blocks = FileProcessing::process_file(filename);
-
-        if (PackageChecks::check_package_blocks(package_blocks)) {
-            return packages;
-        }
-
-        try {
-            for (const auto& package_block : package_blocks) {
-                if (package_block.package_type == package_type) {
-                    QStringList lines = readFile(filename);
-                    int current_line_num = 0;
-                    for (const QString &line : lines) {
-                        if (current_line_num >= package_block.start_line && current_line_num <= package_block.end_line) { // must be withing specified limits
-                            QString stripped_line = trim(line);
-                            if (!stripped_line.startsWith('#') && // must not be a comment, a context (), a bracket [] or an empty line.
-                                !stripped_line.contains('(') &&
-                                !stripped_line.contains(')') &&
-                                !stripped_line.contains('[') &&
-                                !stripped_line.contains(']') &&
-                                !stripped_line.isEmpty()) {
-                                packages.append(stripped_line);
-                            }
-                        }
-                        current_line_num++;
-                    }
-                }
+    static bool is_blank(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    static qsizetype line_start(const QByteArray& text, qsizetype offset) {
+        while (offset > 0 && text.at(offset - 1) != '\n') --offset;
+        return offset;
+    }
+
+    // offset of the '\n' that ends the line, or the end of the text
+    static qsizetype line_end(const QByteArray& text, qsizetype offset) {
+        const qsizetype newline = text.indexOf('\n', offset);
+        return newline == -1 ? text.size() : newline;
+    }
+
+    // the bytes an element takes up, with the whitespace (or the whole line) deleting it would leave behind
+    static Splice deletion(const QByteArray& text, const ConfigDocument::PackageEntry& entry) {
+        const qsizetype start = line_start(text, entry.begin);
+        const qsizetype stop = line_end(text, entry.end);
+        qsizetype before = entry.begin;
+        while (before > start && is_blank(text.at(before - 1))) --before;
+        qsizetype after = entry.end;
+        while (after < stop && is_blank(text.at(after))) ++after;
+
+        if (before == start && (after == stop || text.at(after) == '#')) {
+            return {start, stop < text.size() ? stop + 1 : stop, QByteArray()}; // alone on its line, a trailing comment goes with it
+        }
+        if (after < stop && text.at(after) != '#' && text.at(after) != ']') {
+            return {entry.begin, after, QByteArray()}; // another element follows on the same line
+        }
+        if (before == start) {
+            return {entry.begin, after, QByteArray()}; // the line goes on with ']' or a comment, keep its indentation
+        }
+        return {before, entry.end, QByteArray()};
+    }
+
+    // adds names at the end of the block's first list, one per line or all on one line like the list already is
+    static Splice insertion(const ConfigDocument::Document& document, int block, const QStringList& names) {
+        const QByteArray& text = document.text;
+        const FileProcessing::PackageBlock& package_block = document.blocks.at(block);
+        const qsizetype open = package_block.list_open;
+        const qsizetype close = package_block.list_close;
+
+        const ConfigDocument::PackageEntry* last = nullptr;
+        for (const auto& entry : document.entries.at(block)) {
+            if (entry.begin > open && entry.end <= close) last = &entry;
+        }
+
+        const qsizetype close_line = line_start(text, close);
+        bool close_alone = close_line > open;
+        for (qsizetype i = close_line; close_alone && i < close; ++i) {
+            if (!is_blank(text.at(i))) close_alone = false;
+        }
+
+        if (close_alone) {
+            QByteArray indent;
+            const qsizetype last_line = last ? line_start(text, last->begin) : -1;
+            if (last && last_line > open) {
+                qsizetype i = last_line;
+                while (i < last->begin && is_blank(text.at(i))) ++i;
+                indent = text.mid(last_line, i - last_line);
+            } else {
+                indent = text.mid(close_line, close - close_line) + "  ";
             }
-        } catch (const std::exception& e) {
-            qDebug() << "Exception occurred! , error is " << e.what();
+            QByteArray lines;
+            for (const QString& name : names) {
+                lines += indent + name.toUtf8() + '\n';
+            }
+            return {close_line, close_line, lines};
         }
 
-        return packages;
+        qsizetype at = close;
+        while (at > open + 1 && is_blank(text.at(at - 1))) --at;
+        QByteArray words;
+        for (const QString& name : names) {
+            words += ' ' + name.toUtf8();
+        }
+        if (at == close) words += ' ';
+        return {at, at, words};
     }
 
-    /**
-     * @brief Adds packages to a configuration file or overwrites them.
-     *
-     * @param filename The path to the configuration file.
-     * @param packages A list of packages to add to the file.
-     * @param package_type The type of package block to add to (e.g., 'home', 'system').
-     * @param overwrite Whether to overwrite existing packages in the file. Defaults to false.
-     * @return Packages added in list data type.
-     */
-    QStringList add_packages(const QString& filename, QStringList packages, const QString& package_type, bool overwrite) {
-        QStringList processed_packages;
-        for (const auto& package : packages) {
-            if (package.startsWith("nixpkgs")) { // startsWith("nixpkgs")
-                processed_packages.append(QStringLiteral("pkgs") + package.mid(QStringLiteral("nixpkgs").length())); // if a package starts with nixpkgs.name it will become pkgs.name
+    // deletions merged where they overlap, insertions moved out of deletions, everything sorted by offset
+    static QVector<Splice> normalized_splices(const QByteArray& text, QVector<Splice> deletions, const QVector<Splice>& insertions) {
+        std::sort(deletions.begin(), deletions.end(), [](const Splice& a, const Splice& b) { return a.begin < b.begin; });
+        QVector<Splice> result;
+        for (const Splice& splice : deletions) {
+            if (!result.isEmpty() && splice.begin <= result.last().end) {
+                result.last().end = qMax(result.last().end, splice.end);
             } else {
-                processed_packages.append(package); // if a package has starts with *.name will leave it be and assume user knows what he is doing or get served an error by later error catching in nix-wrapper.cpp
+                result.append(splice);
+            }
+        }
+        // several elements deleted from one line can leave it blank, then the line goes as well,
+        // otherwise the blanks on both sides of the merged range would be left next to each other
+        for (Splice& splice : result) {
+            const qsizetype start = line_start(text, splice.begin);
+            const qsizetype stop = line_end(text, splice.end);
+            if (splice.end == line_start(text, splice.end)) continue; // already whole lines
+            qsizetype before = splice.begin;
+            while (before > start && is_blank(text.at(before - 1))) --before;
+            qsizetype after = splice.end;
+            while (after < stop && is_blank(text.at(after))) ++after;
+            if (before == start && (after == stop || text.at(after) == '#')) {
+                splice.begin = start;
+                splice.end = stop < text.size() ? stop + 1 : stop;
+            } else if (before < splice.begin && (after > splice.end || after == stop)) {
+                if (before == start) splice.end = after;
+                else splice.begin = before;
+            }
+        }
+        for (Splice splice : insertions) {
+            for (const Splice& removed : result) {
+                if (removed.begin < splice.begin && splice.begin < removed.end) {
+                    // the deletion already decided about the blanks, the names take the place of the deleted elements
+                    splice.begin = splice.end = removed.end;
+                    const bool blank_before = removed.begin == line_start(text, removed.begin) || is_blank(text.at(removed.begin - 1));
+                    if (blank_before && splice.text.startsWith(' ')) splice.text.remove(0, 1);
+                    if (removed.end < text.size() && !is_blank(text.at(removed.end)) && text.at(removed.end) != '\n'
+                        && !splice.text.endsWith(' ')) splice.text += ' ';
+                }
             }
+            result.append(splice);
         }
-        packages = processed_packages;
+        // an insertion goes before a deletion that starts at the same offset
+        std::stable_sort(result.begin(), result.end(), [](const Splice& a, const Splice& b) {
+            return a.begin < b.begin || (a.begin == b.begin && a.end - a.begin < b.end - b.begin);
+        });
+        return result;
+    }
 
-        if (packages.isEmpty()) {
-            packages.append("#empty"); // Add a placeholder to prevent syntax issues
+    Plan plan(const ConfigDocument::Document& document, const QStringList& to_add, const QStringList& to_delete,
+              const QString& package_type, bool overwrite) {
+        Plan result;
+        if (!document.readable) {
+            result.error = QStringLiteral("%1 could not be read.").arg(document.path);
+            return result;
+        }
+        if (!document.parsed) {
+            result.error = QStringLiteral("%1 is not valid Nix (unterminated string, comment or bracket).").arg(document.path);
+            return result;
+        }
+        if (PackageChecks::check_package_blocks(document.blocks)) {
+            result.error = QStringLiteral("%1 has no package blocks or several of the same type.").arg(document.path);
+            return result;
+        }
+        const int target = package_type.isEmpty() ? -1 : document.block_index(package_type);
+        if (target == -1 && (!package_type.isEmpty() || !to_add.isEmpty() || overwrite)) {
+            result.error = QStringLiteral("%1 has no '%2' package block.").arg(document.path, package_type);
+            return result;
         }
 
-        QVector<FileProcessing::PackageBlock> package_blocks = FileProcessing::process_file(filename);
-        QStringList existing_packages = overwrite ? QStringList() : read_packages(filename, package_type);
+        const PackageSet::Set wanted(to_add);
+        const PackageSet::Set unwanted(to_delete);
 
-        if (PackageChecks::check_package_blocks(package_blocks)) {
-            return QStringList();
+        QVector<Splice> deletions;
+        PackageSet::Set deleted;
+        QStringList present; // unconditional packages that stay
+        for (int block = 0; block < document.blocks.size(); ++block) {
+            if (target != -1 && block != target) continue;
+            for (const auto& entry : document.entries.at(block)) {
+                if (entry.name.isEmpty()) continue;
+                if (unwanted.contains(entry.name) || (overwrite && !wanted.contains(entry.name))) {
+                    deletions.append(deletion(document.text, entry));
+                    if (deleted.insert(entry.name)) result.deleted.append(entry.name);
+                } else if (!entry.conditional) {
+                    present.append(entry.name);
+                }
+            }
         }
 
-        for (const auto& package : existing_packages) {
-            packages.append(package);
+        QVector<Splice> insertions;
+        result.added = PackageSet::diff(present, wanted.names()).added;
+        if (!result.added.isEmpty()) {
+            const FileProcessing::PackageBlock& package_block = document.blocks.at(target);
+            if (package_block.list_open == -1) {
+                result.error = QStringLiteral("The '%1' package block in %2 has no list to add packages to.").arg(package_type, document.path);
+                return result;
+            }
+
+            // write "hello" rather than "pkgs.hello" into a "with pkgs;" list that already does so
+            bool short_names = false;
+            if (package_block.list_with_pkgs) {
+                for (const auto& entry : document.entries.at(target)) {
+                    if (!entry.name.isEmpty() && entry.begin > package_block.list_open && entry.end <= package_block.list_close) {
+                        short_names = entry.text != entry.name;
+                    }
+                }
+            }
+            QStringList names;
+            for (const QString& name : result.added) {
+                names.append(short_names && name.startsWith(QLatin1String("pkgs.")) ? name.mid(5) : name);
+            }
+            insertions.append(insertion(document, target, names));
+        }
+
+        result.splices = normalized_splices(document.text, deletions, insertions);
+        result.ok = true;
+        return result;
+    }
+
+    QByteArray apply(const QByteArray& text, const QVector<Splice>& splices) {
+        QByteArray result;
+        result.reserve(text.size() + 256);
+        qsizetype cursor = 0;
+        for (const Splice& splice : splices) {
+            result.append(text.constData() + cursor, splice.begin - cursor);
+            result.append(splice.text);
+            cursor = splice.end;
         }
+        result.append(text.constData() + cursor, text.size() - cursor);
+        return result;
+    }
+
+    // end of the old lines a splice touches, an insertion at the start of a line or a deletion up to one touches none past it
+    static qsizetype touched_until(const QByteArray& text, const Splice& splice) {
+        if (splice.end == line_start(text, splice.end) && (splice.end > splice.begin || splice.end == line_start(text, splice.begin))) {
+            return splice.end;
+        }
+        const qsizetype stop = line_end(text, splice.end);
+        return stop < text.size() ? stop + 1 : stop;
+    }
 
-        // Remove duplicates and maintain order
-        QSet<QString> seen_packages_set;
-        QStringList unique_packages;
-        for (const QString &pkg : packages) {
-            if (!seen_packages_set.contains(pkg)) {
-                unique_packages.append(pkg);
-                seen_packages_set.insert(pkg);
+    static QStringList split_lines(const QByteArray& bytes) {
+        QStringList lines = QString::fromUtf8(bytes).split('\n');
+        if (!lines.isEmpty() && lines.last().isEmpty()) lines.removeLast();
+        return lines;
+    }
+
+    QStringList diff(const QString& path, const QByteArray& text, const QVector<Splice>& splices) {
+        QStringList out;
+        if (splices.isEmpty()) return out;
+        const QByteArray after = apply(text, splices);
+        out << QStringLiteral("--- %1").arg(path) << QStringLiteral("+++ %1").arg(path);
+
+        qsizetype delta = 0;     // offset in after minus offset in text, before the current hunk
+        int line_delta = 0;      // same for line numbers
+        int old_line = 0;        // lines of text before `counted`
+        qsizetype counted = 0;
+        for (int i = 0; i < splices.size();) {
+            const qsizetype begin = line_start(text, splices.at(i).begin);
+            qsizetype end = touched_until(text, splices.at(i));
+            qsizetype hunk_delta = splices.at(i).text.size() - (splices.at(i).end - splices.at(i).begin);
+            int j = i + 1;
+            for (; j < splices.size() && line_start(text, splices.at(j).begin) <= end; ++j) {
+                end = qMax(end, touched_until(text, splices.at(j)));
+                hunk_delta += splices.at(j).text.size() - (splices.at(j).end - splices.at(j).begin);
             }
+
+            old_line += text.mid(counted, begin - counted).count('\n');
+            counted = begin;
+            const QStringList removed = split_lines(text.mid(begin, end - begin));
+            const QStringList added = split_lines(after.mid(begin + delta, end - begin + hunk_delta));
+            const int new_line = old_line + line_delta;
+            out << QStringLiteral("@@ -%1,%2 +%3,%4 @@")
+                       .arg(removed.isEmpty() ? old_line : old_line + 1).arg(removed.size())
+                       .arg(added.isEmpty() ? new_line : new_line + 1).arg(added.size());
+            for (const QString& line : removed) out << QLatin1Char('-') + line;
+            for (const QString& line : added) out << QLatin1Char('+') + line;
+
+            delta += hunk_delta;
+            line_delta += added.size() - removed.size();
+            i = j;
         }
-        packages = unique_packages;
+        return out;
+    }
 
-        try {
-            for (const auto& package_block : package_blocks) {
-                if (package_block.package_type == package_type) {
-                    QStringList lines = readFile(filename);
+} // namespace ConfigEdit
 
-                    QStringList new_package_lines;
-                    for (const auto& pkg : packages) {
-                        new_package_lines.append(QString(QChar(' ')).repeated(package_block.start_indent + 2) + pkg); // make indent
-                    }
+namespace PackageOperations {
 
-                    // insert empty line at front
-                    new_package_lines.insert(0, QString());
-
-                    // Replace the lines in the package block
-                    // std::cerr << "start of block " << package_block.start_line << " end of block " << package_block.end_line << std::endl;
-                    if (package_block.start_line >= 0 && static_cast<qsizetype>(package_block.end_line) < lines.size()) { // basic checks to validate start/end line were correctly read and make sense.
-                        if (package_block.start_line < package_block.end_line) { // if there is more then one line between true end/start of block (which is offset by one when we get it hence true end/start is syntax of the array we are typing into).
-                            lines = lines.mid(0, package_block.start_line) + new_package_lines + lines.mid(package_block.start_line + package_block.end_line - package_block.start_line); // erase extra lines (so we won't end up with duplicates) and insert new packages
-                        } else if (package_block.start_line == package_block.end_line) {
-                            lines = lines.mid(0, package_block.start_line) + new_package_lines + lines.mid(package_block.start_line); // insert new packages
-                        }
-                    }
+    // writes a planned edit, false if a file could not be written
+    static bool write_plan(const ConfigGraph::Plan& plan) {
+        QString error;
+        if (!ConfigGraph::write(plan, error)) {
+            qDebug() << "could not write to file, path or perms incorrect! " << error;
+            return false;
+        }
+        return true;
+    }
 
-                    bool success = writeFile(filename, lines);
-                    if (!success) {
-                        qDebug() << "could not write to file, path or perms incorrect! " << filename;
-                        return QStringList();
-                    }
+    /**
+     * @brief Reads and extracts packages from a configuration file and the modules it imports based on the specified packages type.
+     *
+     * @param filename The path to the configuration file.
+     * @param package_type The type of packages to extract (e.g., 'home', 'system').
+     * @return A list of packages extracted from the configuration, filtered to exclude comments, newlines, and unsupported syntax.
+     */
+    QStringList read_packages(const QString& filename, const QString& package_type) {
+        return ConfigGraph::load(filename)->packages(package_type);
+    }
+
+    /**
+     * @brief Lists which file of the configuration every package of a type is in.
+     *
+     * @param filename The path to the configuration file.
+     * @param package_type The type of packages to list (e.g., 'home', 'system').
+     * @return success, one {"name", "file", "line", "conditional"} JSON object per package in file order, errors.
+     */
+    std::tuple<bool, QStringList, QStringList> read_package_files(const QString& filename, const QString& package_type) {
+        ConfigGraph::GraphPtr graph = ConfigGraph::load(filename);
+        if (!graph->documents.first()->readable) {
+            return {false, QStringList(), QStringList({QStringLiteral("%1 could not be read.").arg(filename)})};
+        }
+
+        QStringList result;
+        QStringList unreadable;
+        for (const auto& document : graph->documents) {
+            if (!document->readable) {
+                unreadable.append(QStringLiteral("%1 is imported but could not be read.").arg(document->path));
+                continue;
+            }
+            for (int block = 0; block < document->blocks.size(); ++block) {
+                if (document->blocks.at(block).package_type != package_type) continue;
+                for (const auto& entry : document->entries.at(block)) {
+                    if (entry.name.isEmpty()) continue;
+                    QJsonObject object;
+                    object["name"] = entry.name;
+                    object["file"] = document->path;
+                    object["line"] = entry.line + 1;
+                    object["conditional"] = entry.conditional;
+                    result.append(QString::fromUtf8(QJsonDocument(object).toJson(QJsonDocument::Compact)));
                 }
             }
-        } catch (const std::exception& e) {
-            qDebug() << "Exception occurred! , error is " << e.what();
         }
-        return packages;
+        return {true, result, unreadable};
     }
 
     /**
-     * @brief Deletes a list of packages from a configuration file.
+     * @brief Adds packages to a configuration file or overwrites them.
+     *
+     * @param filename The path to the configuration file.
+     * @param packages A list of packages to add to the file.
+     * @param package_type The type of package block to add to (e.g., 'home', 'system').
+     * @param overwrite Whether to overwrite existing packages in the file. Defaults to false.
+     * @return success, the packages of the type after the change.
+     */
+    std::tuple<bool, QStringList> add_packages(const QString& filename, QStringList packages, const QString& package_type, bool overwrite) {
+        const ConfigGraph::Plan plan = ConfigGraph::plan(*ConfigGraph::load(filename), packages, QStringList(), package_type, overwrite);
+        if (!plan.ok) {
+            qDebug() << plan.error;
+            return {false, QStringList()};
+        }
+        if (!write_plan(plan)) {
+            return {false, QStringList()};
+        }
+        return {true, read_packages(filename, package_type)};
+    }
+
+    /**
+     * @brief Deletes a list of packages from a configuration file and the modules it imports.
      *
      * @param filename The name of the file from which to delete packages.
      * @param packages A list of packages to delete.
      * @param package_type The type of package to delete. If not specified, all package types will be checked. Defaults to empty string.
-     * @return A list of packages that were successfully deleted.
+     * @return success, the packages that were deleted.
      */
-    QStringList delete_packages(const QString& filename, const QStringList& packages, const QString& package_type) {
-        QStringList deleted_packages;
-        QVector<FileProcessing::PackageBlock> package_blocks = FileProcessing::process_file(filename);
-
-        if (PackageChecks::check_package_blocks(package_blocks)) {
-            return QStringList();
+    std::tuple<bool, QStringList> delete_packages(const QString& filename, const QStringList& packages, const QString& package_type) {
+        const ConfigGraph::Plan plan = ConfigGraph::plan(*ConfigGraph::load(filename), QStringList(), packages, package_type);
+        if (!plan.ok) {
+            qDebug() << plan.error;
+            return {false, QStringList()};
         }
-
-        QSet<QString> seen_types;
-        if (package_type.isEmpty()) {
-            for (const auto &package_block : package_blocks)
-                seen_types.insert(package_block.package_type);
-        } else {
-            seen_types.insert(package_type);
+        if (!write_plan(plan)) {
+            return {false, QStringList()};
         }
+        return {true, plan.deleted};
+    }
 
-        for (const auto& type : seen_types) {
-            QStringList existing_packages = read_packages(filename, type);
-            QStringList packages_to_delete;
-
-            // find intersection (packages to delete)
-            for (const auto& pkg_to_del : packages) {
-                if (existing_packages.contains(pkg_to_del)) {
-                    packages_to_delete.append(pkg_to_del);
-                }
-            }
-
-            // build updated_packages = existing_packages - packages_to_delete
-            QStringList updated_packages;
-            for (const auto& existing_pkg : existing_packages) {
-                if (!packages_to_delete.contains(existing_pkg)) { // we skip adding packages we don't want
-                    updated_packages.append(existing_pkg);
-                }
-            }
 
-            add_packages(filename, updated_packages, type, true); // then we use override feature on add_packages to "delete" the packages we skiped over.
+    /**
+     * @brief Deletes and adds packages of one package type in a single edit of the configuration.
+     *
+     * @param filename The path to the configuration file.
+     * @param to_add Packages to add, they go at the end of the list of the first file with a block of the type.
+     * @param to_delete Packages to remove, from whichever file lists them.
+     * @param package_type The type of package block to change (e.g., 'home', 'system').
+     * @return success, the packages of the type after the change, the packages that were deleted.
+     */
+    std::tuple<bool, QStringList, QStringList> apply_changes(const QString& filename, const QStringList& to_add, const QStringList& to_delete, const QString& package_type) {
+        const ConfigGraph::Plan plan = ConfigGraph::plan(*ConfigGraph::load(filename), to_add, to_delete, package_type);
+        if (!plan.ok) {
+            qDebug() << plan.error;
+            return {false, QStringList(), QStringList()};
+        }
 
-            deleted_packages.append(packages_to_delete);
+        if (!write_plan(plan)) {
+            return {false, QStringList(), plan.deleted};
         }
-        return deleted_packages;
+        return {true, read_packages(filename, package_type), plan.deleted};
     }
 
-} // namespace PackageOperations
\ No newline at end of file
+    /**
+     * @brief Shows what apply_changes would change in the configuration, without writing it.
+     *
+     * @param filename The path to the configuration file.
+     * @param to_add Packages to add.
+     * @param to_delete Packages to remove.
+     * @param package_type The type of package block to change (e.g., 'home', 'system').
+     * @return success, the unified diff of the change, the reason the change cannot be made.
+     */
+    std::tuple<bool, QStringList, QStringList> preview_changes(const QString& filename, const QStringList& to_add, const QStringList& to_delete, const QString& package_type) {
+        const ConfigGraph::Plan plan = ConfigGraph::plan(*ConfigGraph::load(filename), to_add, to_delete, package_type);
+        if (!plan.ok) {
+            return {false, QStringList(), QStringList({plan.error})};
+        }
+        return {true, ConfigGraph::diff(plan), QStringList()};
+    }
+} // namespace PackageOperations
@@ -24,12 +24,15 @@
 #define NIX_CONFIG_H
 
 #include <QString>
+#include <QByteArray>
 #include <QStringList>
 #include <QVector>
 #include <QSet>
 #include <QDebug>
 #include <QFile>
 #include <QTextStream>
+#include <tuple>
+#include <memory>
 
 // Function declarations
 
@@ -39,7 +42,7 @@
  * @param str The input string to be trimmed.
  * @return A new string with leading and trailing whitespace removed.
  */
-std::string trim(const std::string& str);
+QString trim(const QString& str);
 
 /**
  * @brief Calculates the number of leading whitespace characters in a string.
@@ -47,7 +50,7 @@ std::string trim(const std::string& str);
  * @param str The input string.
  * @return The count of leading whitespace characters.
  */
-int getLeadingWhitespaceLength(const std::string& str);
+int getLeadingWhitespaceLength(const QString& str);
 
 namespace FileProcessing {
     /**
@@ -58,12 +61,18 @@ namespace FileProcessing {
         int start_line;            ///< The 0-indexed starting line number of the block in the file.
         int end_line;              ///< The 0-indexed ending line number of the block in the file.
         int start_indent;          ///< The leading whitespace length of the block's start line.
+        qsizetype binding_begin = -1;  ///< Byte offset of the attribute path (e.g. `home.packages`).
+        qsizetype value_begin = -1;    ///< Byte offset of the value expression (after '=').
+        qsizetype value_end = -1;      ///< Byte offset right after the value expression (before ';').
+        qsizetype list_open = -1;      ///< Byte offset of the '[' of the first unconditional list in the value, -1 if there is none.
+        qsizetype list_close = -1;     ///< Byte offset of the matching ']'.
+        bool list_with_pkgs = false;   ///< The list is in the scope of `with pkgs;`.
     };
 
     /**
      * @brief Processes a configuration file to identify and extract package blocks.
      *
-     * This function reads the specified file line by line to determine the
+     * This function tokenizes the specified file and parses its package list bindings to determine the
      * boundaries and types of different package definition blocks (e.g., `environment.systemPackages`,
      * `home.packages`). It's crucial for understanding the structure of the Nix
      * configuration for subsequent package operations.
@@ -72,6 +81,14 @@ namespace FileProcessing {
      * @return A QVector of PackageBlock structs, each describing a found package block.
      */
     QVector<PackageBlock> process_file(const QString& filename);
+
+    /**
+     * @brief Same as process_file, for a configuration file that is already in memory.
+     *
+     * @param lines The configuration file, one entry per line.
+     * @return A QVector of PackageBlock structs, each describing a found package block.
+     */
+    QVector<PackageBlock> process_lines(const QStringList& lines);
 } // namespace FileProcessing
 
 namespace PackageChecks {
@@ -88,48 +105,222 @@ namespace PackageChecks {
     bool check_package_blocks(const std::vector<FileProcessing::PackageBlock>& package_blocks);
 } // namespace PackageChecks
 
+namespace ConfigDocument {
+    /**
+     * @brief One package entry of a package block.
+     */
+    struct PackageEntry {
+        QString name;             ///< The package (e.g. "pkgs.hello", also for `hello` under `with pkgs;`), empty if the element is not a plain attribute path.
+        QString text;             ///< The element as written in the file.
+        int line = -1;            ///< The 0-indexed line the element starts on.
+        qsizetype begin = -1;     ///< Byte offset of the element in Document::text.
+        qsizetype end = -1;       ///< Byte offset right after the element.
+        bool conditional = false; ///< The element is in a conditional list (e.g. `lib.optionals cond [ ... ]`).
+    };
+
+    /**
+     * @brief Parsed model of a configuration file, built from a single tokenization of its text.
+     *
+     * Documents are immutable once built and shared between threads, edits are planned
+     * against a document with ConfigEdit and written through save().
+     */
+    struct Document {
+        QString path;                                   ///< The file the model was built from.
+        bool readable = false;                          ///< False if the file could not be read.
+        bool parsed = false;                            ///< False if the file is not valid Nix as far as the lexer can tell.
+        QByteArray text;                                ///< The file as read.
+        QStringList lines;                              ///< The file, one entry per line.
+        QVector<FileProcessing::PackageBlock> blocks;   ///< Package blocks in file order.
+        QVector<QVector<PackageEntry>> entries;         ///< Package entries of blocks[i].
+        QStringList imports;                            ///< Files the top-level `imports` list names, absolute (a directory as its default.nix).
+
+        /**
+         * @brief Index of the first block of a package type, -1 if there is none.
+         */
+        int block_index(const QString& package_type) const;
+
+        /**
+         * @brief Packages of every block of a package type, in file order, elements that are not a plain package are left out.
+         */
+        QStringList packages(const QString& package_type) const;
+    };
+
+    using DocumentPtr = std::shared_ptr<const Document>;
+
+    /**
+     * @brief Builds the model of a file that is already in memory, nothing is cached.
+     *
+     * @param path The file the lines belong to.
+     * @param lines The configuration file, one entry per line.
+     */
+    DocumentPtr parse(const QString& path, const QStringList& lines);
+
+    /**
+     * @brief Same as parse(), for the text of a configuration file.
+     */
+    DocumentPtr parse(const QString& path, const QByteArray& text);
+
+    /**
+     * @brief Returns the model of a configuration file, reading the file only if it changed.
+     *
+     * Models are cached per path and stay valid as long as the file's mtime, size and
+     * inode do not change, so edits made by anything else (a restored backup, the user's
+     * editor) are picked up on the next load.
+     *
+     * @param path The full path to the Nix configuration file.
+     * @return The model, with `readable` false (and no blocks) if the file could not be read.
+     */
+    DocumentPtr load(const QString& path);
+
+    /**
+     * @brief Writes a configuration file and caches the model of what was written.
+     *
+     * @param path The full path to the Nix configuration file.
+     * @param text The new content of the file.
+     * @return The model of the written file, nullptr if the file could not be written.
+     */
+    DocumentPtr save(const QString& path, const QByteArray& text);
+} // namespace ConfigDocument
+
+namespace ConfigEdit {
+    /**
+     * @brief Replaces the bytes [begin, end) of a document's text with `text`, an insertion if begin == end.
+     */
+    struct Splice {
+        qsizetype begin;
+        qsizetype end;
+        QByteArray text;
+    };
+
+    /**
+     * @brief The splices that turn a document into the edited configuration.
+     */
+    struct Plan {
+        bool ok = false;            ///< False if the edit cannot be made, see error.
+        QString error;              ///< Why the edit cannot be made.
+        QVector<Splice> splices;    ///< Sorted by offset and not overlapping.
+        QStringList added;          ///< Packages that were not in the block yet.
+        QStringList deleted;        ///< Packages that were found and are removed.
+    };
+
+    /**
+     * @brief Plans adding and deleting packages as text splices at the byte ranges of the parsed model.
+     *
+     * Deleted elements are cut out together with the whitespace (or the whole line, comment included)
+     * they leave behind, added packages go at the end of the block's first unconditional list in the
+     * layout it already has (one per line or all on one line). Nothing else of the file changes, so
+     * the cost is proportional to the number of changes, not to the size of the file.
+     *
+     * @param document The document to edit.
+     * @param to_add Packages to add to the block of package_type, already present ones are skipped.
+     * @param to_delete Packages to delete from every list of the block (of every block if package_type is empty).
+     * @param package_type The type of package block to change (e.g., "home"), empty only to delete from all blocks.
+     * @param overwrite If true, every package of the block that is not in to_add is deleted as well.
+     */
+    Plan plan(const ConfigDocument::Document& document, const QStringList& to_add, const QStringList& to_delete,
+              const QString& package_type, bool overwrite = false);
+
+    /**
+     * @brief Applies sorted, non overlapping splices to a text.
+     */
+    QByteArray apply(const QByteArray& text, const QVector<Splice>& splices);
+
+    /**
+     * @brief Unified diff (without context lines) of what the splices change, one entry per line.
+     *
+     * @param path The file name to show in the diff header.
+     * @param text The text the splices were planned against.
+     * @param splices Sorted, non overlapping splices.
+     */
+    QStringList diff(const QString& path, const QByteArray& text, const QVector<Splice>& splices);
+} // namespace ConfigEdit
+
+/**
+ * Every operation below works on the configuration file and the modules it imports
+ * (see ConfigGraph), filename is the root of that configuration.
+ */
 namespace PackageOperations {
     /**
      * @brief Reads packages of a specific type from the configuration file.
      *
-     * This function parses the content of a designated package block within the
-     * configuration file and extracts the list of package names.
+     * This function parses the content of the designated package blocks within the
+     * configuration file and its imported modules and extracts the list of package names.
      *
      * @param filename The full path to the Nix configuration file.
      * @param package_type The type of package block to read (e.g., "system", "home", etc., mapping to `PackageBlock::package_type`).
-     * @return A QStringList, where each QString is a package name.
+     * @return A QStringList, where each QString is a package name, the root's packages first.
      */
     QStringList read_packages(const QString& filename, const QString& package_type);
 
+    /**
+     * @brief Lists which file of the configuration every package of a type is in.
+     *
+     * @param filename The full path to the Nix configuration file.
+     * @param package_type The type of package block to read (e.g., "home").
+     * @return A tuple: true if the configuration could be read, one {"name", "file", "line", "conditional"}
+     * JSON object per package (line is 1-indexed), and the imported files that could not be read.
+     */
+    std::tuple<bool, QStringList, QStringList> read_package_files(const QString& filename, const QString& package_type);
+
     /**
      * @brief Adds new packages to a specified block in the configuration file.
      *
      * This function inserts new package entries into the relevant package block
-     * within the configuration file. It can either append to the existing list
-     * or replace it entirely based on the `overwrite` flag.
+     * (the root's, or the first imported module's that has one). It can either append
+     * to the existing list or replace the packages of the type entirely based on the `overwrite` flag.
      *
      * @param filename The full path to the Nix configuration file.
      * @param packages A vector of strings representing the package names to add.
      * @param package_type The type of package block to modify (e.g., "system", "home").
      * @param overwrite If true, existing packages in the block are replaced by the new list. If false, new packages are added. Defaults to false.
-     * @return A QStringList representing the *new* state of packages in that block after the operation.
+     * @return A tuple: false if the edit could not be made or a file could not be written (some files
+     * may have been written already), and the *new* state of packages in that block after the operation.
      */
     // std::vector<std::string> add_packages(const std::string& filename, std::vector<std::string> packages, const std::string& package_type, bool overwrite = false);
-    QStringList add_packages(const QString& filename, QStringList packages, const QString& package_type, bool overwrite = false);
+    std::tuple<bool, QStringList> add_packages(const QString& filename, QStringList packages, const QString& package_type, bool overwrite = false);
 
     /**
      * @brief Deletes specified packages from a block in the configuration file.
      *
      * This function removes one or more package entries from a specific package
-     * block within the configuration file.
+     * block within the configuration file or whichever imported module lists them.
      *
      * @param filename The full path to the Nix configuration file.
      * @param packages A vector of strings representing the package names to delete.
      * @param package_type The type of package block to modify (e.g., "system", "home"). If empty, attempts to delete from all found blocks.
-     * @return A QStringList representing the *new* state of packages in the modified block(s) after the operation.
+     * @return A tuple: false if the edit could not be made or a file could not be written (some files
+     * may have been written already), and the packages that were deleted.
      */
     // std::vector<std::string> delete_packages(const std::string& filename, const std::vector<std::string>& packages, const std::string& package_type = "");
-    QStringList delete_packages(const QString& filename, const QStringList& packages, const QString& package_type = QString());
+    std::tuple<bool, QStringList> delete_packages(const QString& filename, const QStringList& packages, const QString& package_type = QString());
+
+    /**
+     * @brief Deletes and adds packages of one package block in a single edit of the configuration file.
+     *
+     * All edits are made in memory and every changed file is written once, the result is the
+     * same as delete_packages followed by add_packages.
+     *
+     * @param filename The full path to the Nix configuration file.
+     * @param to_add Package names to add.
+     * @param to_delete Package names to delete.
+     * @param package_type The type of package block to modify (e.g., "system", "home").
+     * @return A tuple: true if the file was changed, the *new* state of packages in that block,
+     * and the packages that were actually deleted.
+     */
+    std::tuple<bool, QStringList, QStringList> apply_changes(const QString& filename, const QStringList& to_add, const QStringList& to_delete, const QString& package_type);
+
+    /**
+     * @brief Shows what apply_changes would change in the configuration file, without writing it.
+     *
+     * @param filename The full path to the Nix configuration file.
+     * @param to_add Package names to add.
+     * @param to_delete Package names to delete.
+     * @param package_type The type of package block to modify (e.g., "system", "home").
+     * @return A tuple: true if the change can be made, the unified diff of the change (one entry per line,
+     * empty if nothing would change), and the reason it cannot be made.
+     */
+    std::tuple<bool, QStringList, QStringList> preview_changes(const QString& filename, const QStringList& to_add, const QStringList& to_delete, const QString& package_type);
+
 } // namespace PackageOperations
 
 #endif // NIX_CONFIG_H
\ No newline at end of file
@@ -19,6 +19,15 @@
  */
 
 #include "nix-interact.h" // Include the declarative header
+#include "nix-log.h"
+
+// Runs a nix tool with internal-json logging when the installed nix supports it, so progress and
+// errors arrive as typed events (see NixLog), while results and logs keep the readable text.
+// home-manager has no way to pass --log-format on to nix, it keeps the human readable format.
+static std::tuple<bool, QStringList, QStringList>
+exec_nix(const QString& program, const QStringList& arguments) {
+    return exec_direct(program, NixLog::log_format_args() + arguments, LoginEnvironment::snapshot(), NixLog::humanize_line);
+}
 
 namespace HomeManager {
     std::tuple<bool, QStringList, QStringList, QStringList>
@@ -33,12 +42,12 @@ namespace HomeManager {
         bool success;
 
         // enable/disable insecure packages during switch
-        QString command = QStringLiteral("home-manager switch");
+        QProcessEnvironment env = LoginEnvironment::snapshot();
         if (allow_insecure) { // adds env variable NIXPKGS_ALLOW_INSECURE=1 which enables insecure packages.
-            command = QStringLiteral("export NIXPKGS_ALLOW_INSECURE=1 && home-manager switch");
+            env.insert(QStringLiteral("NIXPKGS_ALLOW_INSECURE"), QStringLiteral("1"));
         }
 
-        std::tie(success, output, full_error) = exec_bash(command);
+        std::tie(success, output, full_error) = exec_direct(QStringLiteral("home-manager"), {QStringLiteral("switch")}, env);
 
 
         for (const QString &line : full_error) {
@@ -62,7 +71,7 @@ namespace HomeManager {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("home-manager --version"));
+        std::tie(success, output, full_error) = exec_direct(QStringLiteral("home-manager"), {QStringLiteral("--version")});
 
         // Return one list and the bool as a tuple
         return {success, output, full_error}; // for failure
@@ -73,10 +82,9 @@ namespace HomeManager {
         // Initialize the lists for output and full error
         QStringList output;
         QStringList full_error;
-        QString command = QStringLiteral("home-manager expire-generations '%1'").arg(timestamp);
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(command);
+        std::tie(success, output, full_error) = exec_direct(QStringLiteral("home-manager"), {QStringLiteral("expire-generations"), timestamp});
 
         // Return one list and the bool as a tuple
         return {success, output, full_error}; // for failure
@@ -90,7 +98,7 @@ namespace HomeManager {
         QStringList result;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("home-manager generations"));
+        std::tie(success, output, full_error) = exec_direct(QStringLiteral("home-manager"), {QStringLiteral("generations")});
 
         // Return one list and the bool as a tuple
         if (output.isEmpty()) {
@@ -135,61 +143,6 @@ namespace HomeManager {
 
 namespace NixEnv {
 
-    std::tuple<bool, QStringList, QStringList>
-    quarry(const QString& quarry) {
-        // Initialize the lists for output and full error
-        QStringList full_error;
-        QStringList output;
-        QString command = QStringLiteral("nix-env -qaP %1").arg(quarry); // Replace "%s" placeholder with quarry
-        QStringList result;
-        bool success;
-
-        std::tie(success, output, full_error) = exec_bash(command);
-
-        // Return on failure conditions
-        if (!success) {
-            return {success, output, full_error};
-        }
-        if (output.isEmpty()) {
-            return {false, output, QStringList{QStringLiteral("No packages found!")}};
-        }
-        if (output == QStringList{QStringLiteral("Killed")}) {
-            return {false, output, QStringList{QStringLiteral("Command timed out!")}};
-        }
-
-        // Example of healthy output before:
-        // nixpkgs.firefox-esr      firefox-140.3.0esr
-        // nixpkgs.firefox          firefox-143.0
-        // ...
-
-        // Process the output to extract package names and summaries
-        for (const QString &line : output) {
-            // Split on whitespace into at most 2 parts (pkg_name and summary)
-            QStringList parts = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-            if (parts.size() < 2) continue;
-
-            QString pkg_name = parts.at(0);
-            QString summary = parts.mid(1).join(' '); // join remainder as summary
-
-            // Remove leading namespace "nixpkgs." if present
-            int dotPos = pkg_name.indexOf('.');
-            if (dotPos != -1) pkg_name = pkg_name.mid(dotPos + 1);
-
-            // Create JSON-like structured string (compatibility with original)
-            QString structured_output = QStringLiteral("{\"name\": \"%1\", \"summary\": \"%2\", \"last_updated\": \"\"}")
-                                            .arg(pkg_name, summary);
-            result << structured_output;
-        }
-
-        // Example of healthy output after:
-        // [
-        //   {"name":"firefox-esr","summary":"firefox-140.3.0esr","last_updated":""}, ...
-        // ]
-
-        return {success, result, full_error};
-        
-    }
-
     std::tuple<bool, QStringList, QStringList>
     list_generations() {
         // Initialize the lists for output and full error
@@ -198,7 +151,7 @@ namespace NixEnv {
         QStringList result;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-env --list-generations"));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-env"), {QStringLiteral("--list-generations")});
 
         // Return early on failure conditions
         if (!success) {
@@ -250,7 +203,7 @@ namespace NixEnv {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-env --switch-generation %1").arg(generation_id));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-env"), {QStringLiteral("--switch-generation"), generation_id});
 
         // Return the two lists as a tuple + success bool
         return {success, output, full_error};
@@ -264,7 +217,7 @@ namespace NixEnv {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-env --delete-generations %1").arg(generation_id));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-env"), {QStringLiteral("--delete-generations"), generation_id});
 
         // Return the two lists as a tuple + success bool
         return {success, output, full_error};
@@ -278,7 +231,7 @@ namespace NixEnv {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-env --delete-generations old"));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-env"), {QStringLiteral("--delete-generations"), QStringLiteral("old")});
 
         // Return the two lists as a tuple + success bool
         return {success, output, full_error};
@@ -296,7 +249,7 @@ namespace NixChannel {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-channel --update"));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-channel"), {QStringLiteral("--update")});
 
         // Return the two lists as a tuple + success bool
         return {success, output, full_error};
@@ -311,7 +264,7 @@ namespace NixChannel {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-channel --add %1 %2").arg(url, name));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-channel"), {QStringLiteral("--add"), url, name});
 
         // Return the two lists as a tuple
         return {success, output, full_error};
@@ -325,7 +278,7 @@ namespace NixChannel {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-channel --remove %1").arg(name));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-channel"), {QStringLiteral("--remove"), name});
 
         // Return the two lists as a tuple
         return {success, output, full_error};
@@ -340,7 +293,7 @@ namespace NixChannel {
         QStringList full_error;
         bool success;
 
-        std::tie(success, output, full_error) = exec_bash(QStringLiteral("nix-channel --list"));
+        std::tie(success, output, full_error) = exec_nix(QStringLiteral("nix-channel"), {QStringLiteral("--list")});
 
         if (output.isEmpty()) {
             full_error << QStringLiteral("No Channels Found!");
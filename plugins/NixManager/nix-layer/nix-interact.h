@@ -104,25 +104,6 @@ namespace HomeManager {
 }
 
 namespace NixEnv {
-    /**
-    * @brief Queries the Nix package manager for available packages based on a search term.
-    *
-    * This function constructs and executes a Nix command to list all available packages
-    * that match the specified search term. It processes the output to extract relevant
-    * package names and their summaries, returning them in a structured format. If the command
-    * fails or no packages are found, appropriate error messages are returned.
-    *
-    * @param quarry A string representing the search term for the Nix command (e.g., "firefox").
-    * @return A tuple containing:
-    * - bool detected: True if success (command exited 0),
-    * false otherwise (e.g., no packages found, command timeout, or execution error).
-    * - QStringList packages: A vector of strings formatted as JSON-like
-    * objects containing package names and summaries. 
-    * - QStringList full_error: error messages if the query failed.
-    */
-    std::tuple<bool, QStringList, QStringList>
-    quarry(const QString& quarry);
-
     /**
     * @brief Queries the Nix package manager for available generations.
     *
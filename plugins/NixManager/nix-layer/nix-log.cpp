@@ -0,0 +1,124 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "nix-log.h"
+#include "../libs/openprocess.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+
+namespace NixLog {
+
+    static const QByteArray kPrefix = QByteArrayLiteral("@nix ");
+
+    // nix formats error messages for terminals, the colours are of no use here.
+    static QString strip_ansi(const QString& text) {
+        static const QRegularExpression re_ansi(QStringLiteral("\x1b\\[[0-9;]*[A-Za-z]"));
+        QString plain = text;
+        plain.remove(re_ansi);
+        return plain;
+    }
+
+    bool parse(const QByteArray& line, Event& event) {
+        if (!line.startsWith(kPrefix)) return false;
+        QJsonParseError parse_error;
+        QJsonDocument doc = QJsonDocument::fromJson(line.mid(kPrefix.size()), &parse_error);
+        if (parse_error.error != QJsonParseError::NoError || !doc.isObject()) return false;
+
+        QJsonObject obj = doc.object();
+        const QString action = obj.value("action").toString();
+        event = Event();
+        event.id = static_cast<qint64>(obj.value("id").toDouble());
+        event.level = obj.value("level").toInt(LvlInfo);
+        event.fields = obj.value("fields").toArray();
+
+        if (action == QLatin1String("msg")) {
+            event.kind = Event::Message;
+            event.text = strip_ansi(obj.value("msg").toString());
+            event.file = obj.value("file").toString();
+            event.line = obj.value("line").toInt();
+            event.column = obj.value("column").toInt();
+        } else if (action == QLatin1String("start")) {
+            event.kind = Event::Start;
+            event.parent = static_cast<qint64>(obj.value("parent").toDouble());
+            event.type = obj.value("type").toInt();
+            event.text = obj.value("text").toString();
+        } else if (action == QLatin1String("stop")) {
+            event.kind = Event::Stop;
+        } else if (action == QLatin1String("result")) {
+            event.kind = Event::Result;
+            event.type = obj.value("type").toInt();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    QString display_text(const Event& event) {
+        switch (event.kind) {
+        case Event::Message:
+            return event.level <= LvlInfo ? event.text : QString();
+        case Event::Start:
+            return event.level <= LvlInfo ? event.text : QString();
+        case Event::Result:
+            if ((event.type == ResBuildLogLine || event.type == ResPostBuildLogLine) && !event.fields.isEmpty()) {
+                return strip_ansi(event.fields.at(0).toString());
+            }
+            return QString();
+        default:
+            return QString();
+        }
+    }
+
+    QByteArray humanize_line(const QByteArray& line) {
+        Event event;
+        if (!parse(line, event)) return line;
+        return display_text(event).toUtf8();
+    }
+
+    QStringList log_format_args() {
+        // asked once, a nix upgrade while the app runs is not worth another process per call
+        static QMutex mutex;
+        static bool known = false;
+        static QStringList args;
+
+        QMutexLocker locker(&mutex);
+        if (known) return args;
+
+        auto [success, output, full_error] = exec_direct(QStringLiteral("nix-env"), {QStringLiteral("--version")});
+        if (!success || output.isEmpty()) return args; // not installed (yet), ask again next time
+
+        // e.g. "nix-env (Nix) 2.18.1"
+        static const QRegularExpression re_version(QStringLiteral(R"((\d+)\.(\d+))"));
+        QRegularExpressionMatch match = re_version.match(output.first());
+        if (match.hasMatch()) {
+            int major = match.captured(1).toInt();
+            int minor = match.captured(2).toInt();
+            if (major > 2 || (major == 2 && minor >= 4)) {
+                args << QStringLiteral("--log-format") << QStringLiteral("internal-json") << QStringLiteral("-v");
+            }
+        }
+        known = true;
+        return args;
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef NIX_LOG_H
+#define NIX_LOG_H
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Reader for nix's machine readable log format (`--log-format internal-json`).
+ *
+ * With that format nix writes one event per stderr line, prefixed with "@nix ":
+ * @nix {"action":"start","id":7,"level":3,"parent":0,"text":"building '...drv'","type":105,"fields":["/nix/store/...drv","",1,1]}
+ * @nix {"action":"result","id":5,"type":105,"fields":[2,9,1,0]}
+ * @nix {"action":"stop","id":7}
+ * @nix {"action":"msg","level":0,"msg":"error: ...","raw_msg":"...","file":"/home/.../home.nix","line":12,"column":5}
+ * The numeric values mirror nix's ActivityType, ResultType and Verbosity enums.
+ */
+namespace NixLog {
+    enum ActivityType {
+        ActUnknown = 0,
+        ActCopyPath = 100,
+        ActFileTransfer = 101,
+        ActRealise = 102,
+        ActCopyPaths = 103,
+        ActBuilds = 104,
+        ActBuild = 105,
+        ActOptimiseStore = 106,
+        ActVerifyPaths = 107,
+        ActSubstitute = 108,
+        ActQueryPathInfo = 109,
+        ActPostBuildHook = 110,
+        ActBuildWaiting = 111,
+        ActFetchTree = 112
+    };
+
+    enum ResultType {
+        ResFileLinked = 100,
+        ResBuildLogLine = 101,
+        ResUntrustedPath = 102,
+        ResCorruptedPath = 103,
+        ResSetPhase = 104,
+        ResProgress = 105,
+        ResSetExpected = 106,
+        ResPostBuildLogLine = 107,
+        ResFetchStatus = 108
+    };
+
+    enum Verbosity {
+        LvlError = 0,
+        LvlWarn = 1,
+        LvlNotice = 2,
+        LvlInfo = 3,
+        LvlTalkative = 4,
+        LvlChatty = 5,
+        LvlDebug = 6,
+        LvlVomit = 7
+    };
+
+    /**
+     * @brief One decoded log event.
+     */
+    struct Event {
+        enum Kind { Message, Start, Stop, Result };
+
+        Kind kind = Message;
+        qint64 id = 0;          ///< Activity id (Start/Stop/Result).
+        qint64 parent = 0;      ///< Parent activity id (Start).
+        int type = 0;           ///< ActivityType for Start, ResultType for Result.
+        int level = LvlInfo;    ///< Verbosity (Message/Start).
+        QString text;           ///< Message text (ANSI escapes removed) or activity description.
+        QJsonArray fields;      ///< Type specific values, e.g. [done, expected, running, failed] for ResProgress.
+        QString file;           ///< Source position of an error message, if nix reported one.
+        int line = 0;
+        int column = 0;
+    };
+
+    /**
+     * @brief Decodes an "@nix {...}" line.
+     * @return False if the line is not an internal-json event (e.g. plain output of a child process).
+     */
+    bool parse(const QByteArray& line, Event& event);
+
+    /**
+     * @brief The part of an event a human would have seen in the normal log format.
+     *
+     * Messages up to info level, descriptions of started activities and build log
+     * lines have text, progress bookkeeping has none (empty string).
+     */
+    QString display_text(const Event& event);
+
+    /**
+     * @brief Line transform for OutputCapture: turns events into their display text
+     * (dropping pure progress events) and passes every other line through unchanged,
+     * so results and log files stay readable.
+     */
+    QByteArray humanize_line(const QByteArray& line);
+
+    /**
+     * @brief Extra arguments that switch a nix command to internal-json logging.
+     *
+     * Empty if the installed nix is too old to report activities and error
+     * positions (< 2.4), callers then get the regular human readable log.
+     */
+    QStringList log_format_args();
+}
+
+#endif // NIX_LOG_H
@@ -0,0 +1,205 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "nix-progress.h"
+
+#include <QJsonDocument>
+
+namespace NixProgress {
+
+    qint64 parse_size(const QString& number, const QString& unit) {
+        double value = number.toDouble();
+        if (unit.startsWith('K')) value *= 1024.0;
+        else if (unit.startsWith('M')) value *= 1024.0 * 1024.0;
+        else if (unit.startsWith('G')) value *= 1024.0 * 1024.0 * 1024.0;
+        return static_cast<qint64>(value);
+    }
+
+    // counter-only internal-json updates (e.g. download progress) are reported at most this often.
+    static const int kCounterReportIntervalMs = 250;
+
+    Parser::Parser() : m_phase(QStringLiteral("running")), m_line_is_error(false) {}
+
+    bool Parser::feed(const QString& line) {
+        m_line_is_error = false;
+        if (line.startsWith(QStringLiteral("@nix "))) return feed_event(line);
+
+        m_line = line;
+        feed_human(line);
+        return true;
+    }
+
+    bool Parser::feed_event(const QString& line) {
+        NixLog::Event event;
+        if (!NixLog::parse(line.toUtf8(), event)) return false;
+        m_line = NixLog::display_text(event);
+        bool changed = false;
+
+        switch (event.kind) {
+        case NixLog::Event::Start:
+            m_activities.insert(event.id, event.type);
+            if (event.type == NixLog::ActBuild) {
+                m_phase = QStringLiteral("building");
+                changed = true;
+            } else if (event.type == NixLog::ActCopyPath || event.type == NixLog::ActSubstitute) {
+                m_phase = QStringLiteral("fetching");
+                changed = true;
+            } else if (event.type == NixLog::ActFileTransfer && m_phase != QLatin1String("fetching")) {
+                m_phase = QStringLiteral("downloading");
+                changed = true;
+            }
+            break;
+        case NixLog::Event::Stop:
+            m_activities.remove(event.id);
+            break;
+        case NixLog::Event::Result: {
+            const int activity = m_activities.value(event.id, NixLog::ActUnknown);
+            if (event.type == NixLog::ResProgress && event.fields.size() >= 2) {
+                // fields: done, expected, running, failed
+                const qint64 done = static_cast<qint64>(event.fields.at(0).toDouble());
+                const qint64 expected = static_cast<qint64>(event.fields.at(1).toDouble());
+                if (activity == NixLog::ActBuilds) {
+                    m_counters.derivations_built = static_cast<int>(done);
+                    m_counters.derivations_total = static_cast<int>(expected);
+                    changed = true;
+                } else if (activity == NixLog::ActCopyPaths) {
+                    m_counters.paths_fetched = static_cast<int>(done);
+                    m_counters.paths_total = static_cast<int>(expected);
+                    changed = true;
+                } else if (activity == NixLog::ActFileTransfer) {
+                    m_transferred.insert(event.id, done);
+                    qint64 total = 0;
+                    for (qint64 bytes : m_transferred) total += bytes;
+                    m_counters.download_bytes = total;
+                    changed = true;
+                }
+            } else if (event.type == NixLog::ResSetExpected && event.fields.size() >= 2
+                       && event.fields.at(0).toInt() == NixLog::ActFileTransfer) {
+                // fields: activity type, expected amount (bytes to download for copy-paths)
+                m_counters.download_bytes_total = static_cast<qint64>(event.fields.at(1).toDouble());
+                changed = true;
+            }
+            break;
+        }
+        case NixLog::Event::Message:
+            if (event.level == NixLog::LvlError) {
+                m_errors << event;
+                m_line_is_error = true;
+            }
+            break;
+        }
+
+        if (!m_line.isEmpty()) {
+            m_since_report.start();
+            return true;
+        }
+        if (changed && (!m_since_report.isValid() || m_since_report.hasExpired(kCounterReportIntervalMs))) {
+            m_since_report.start();
+            return true;
+        }
+        return false;
+    }
+
+    bool Parser::feed_human(const QString& line) {
+        // Examples of the lines we care about (nix 2.x, non-tty output):
+        // these 3 derivations will be built:
+        // this derivation will be built:
+        // these 12 paths will be fetched (34.50 MiB download, 120.10 MiB unpacked):
+        // building '/nix/store/...-home-manager-generation.drv'...
+        // copying path '/nix/store/...-firefox-143.0' from 'https://cache.nixos.org'...
+        // downloading 'https://nixos.org/channels/...'...
+        // unpacking channels...
+        // Starting Home Manager activation
+        static const QRegularExpression re_drv_total(QStringLiteral(R"(^\s*these (\d+) derivations will be built)"));
+        static const QRegularExpression re_paths_total(QStringLiteral(R"(^\s*these (\d+) paths will be fetched \(([\d.]+) ([KMG]i?B) download)"));
+        static const QRegularExpression re_path_total(QStringLiteral(R"(^\s*this path will be fetched \(([\d.]+) ([KMG]i?B) download)"));
+
+        QRegularExpressionMatch match;
+        if ((match = re_drv_total.match(line)).hasMatch()) {
+            m_counters.derivations_total += match.captured(1).toInt();
+            return true;
+        }
+        if (line.trimmed().startsWith(QStringLiteral("this derivation will be built"))) {
+            m_counters.derivations_total += 1;
+            return true;
+        }
+        if ((match = re_paths_total.match(line)).hasMatch()) {
+            m_counters.paths_total += match.captured(1).toInt();
+            m_counters.download_bytes_total += parse_size(match.captured(2), match.captured(3));
+            return true;
+        }
+        if ((match = re_path_total.match(line)).hasMatch()) {
+            m_counters.paths_total += 1;
+            m_counters.download_bytes_total += parse_size(match.captured(1), match.captured(2));
+            return true;
+        }
+        if (line.startsWith(QStringLiteral("building '"))) {
+            m_counters.derivations_built++;
+            m_phase = QStringLiteral("building");
+            return true;
+        }
+        if (line.startsWith(QStringLiteral("copying path '"))) {
+            m_counters.paths_fetched++;
+            if (m_counters.paths_total > 0) {
+                m_counters.download_bytes = m_counters.download_bytes_total
+                                            * qMin(m_counters.paths_fetched, m_counters.paths_total)
+                                            / m_counters.paths_total;
+            }
+            m_phase = QStringLiteral("fetching");
+            return true;
+        }
+        if (line.startsWith(QStringLiteral("downloading '"))) {
+            m_phase = QStringLiteral("downloading");
+            return true;
+        }
+        if (line.startsWith(QStringLiteral("unpacking "))) {
+            m_phase = QStringLiteral("unpacking");
+            return true;
+        }
+        if (line.startsWith(QStringLiteral("Starting Home Manager activation"))) {
+            m_phase = QStringLiteral("activating");
+            return true;
+        }
+        return false;
+    }
+
+    QString Parser::to_json(const QString& stream) const {
+        QJsonObject progressObj;
+        progressObj["stream"] = stream;
+        progressObj["line"] = m_line;
+        progressObj["phase"] = m_phase;
+        progressObj["derivations_built"] = m_counters.derivations_built;
+        progressObj["derivations_total"] = m_counters.derivations_total;
+        progressObj["paths_fetched"] = m_counters.paths_fetched;
+        progressObj["paths_total"] = m_counters.paths_total;
+        progressObj["download_bytes"] = static_cast<double>(m_counters.download_bytes);
+        progressObj["download_bytes_total"] = static_cast<double>(m_counters.download_bytes_total);
+        if (m_line_is_error && !m_errors.isEmpty()) {
+            const NixLog::Event& error = m_errors.last();
+            QJsonObject errorObj;
+            errorObj["message"] = error.text;
+            errorObj["file"] = error.file;
+            errorObj["line"] = error.line;
+            errorObj["column"] = error.column;
+            progressObj["error"] = errorObj;
+        }
+        return QJsonDocument(progressObj).toJson(QJsonDocument::Compact);
+    }
+}
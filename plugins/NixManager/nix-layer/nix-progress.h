@@ -0,0 +1,101 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef NIX_PROGRESS_H
+#define NIX_PROGRESS_H
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include "nix-log.h"
+
+namespace NixProgress {
+    /**
+     * @brief Running totals of what nix/home-manager reported so far.
+     */
+    struct Counters {
+        int derivations_total = 0;      ///< From "these N derivations will be built:".
+        int derivations_built = 0;      ///< Number of "building '...drv'" lines seen.
+        int paths_total = 0;            ///< From "these N paths will be fetched (...)".
+        int paths_fetched = 0;          ///< Number of "copying path '...' from '...'" lines seen.
+        qint64 download_bytes_total = 0; ///< Download size announced in the fetch summary.
+        qint64 download_bytes = 0;      ///< Estimate, download_bytes_total scaled by paths_fetched/paths_total.
+    };
+
+    /**
+     * @brief Turns nix's build/download output into phases and counters.
+     *
+     * Feed it every output line of an operation in order, it keeps track of the
+     * current phase (e.g. "evaluating", "building", "fetching", "activating") and
+     * the counters above. Both the human readable format and internal-json events
+     * (see NixLog) are understood, the latter give exact counters and error positions.
+     * Lines it does not understand are ignored.
+     */
+    class Parser {
+    public:
+        Parser();
+
+        /**
+         * @brief Updates phase and counters from one line of output.
+         * @return True if the line is worth reporting: every human readable line, and
+         * internal-json events that carry text or (at most every 250ms) new counters.
+         */
+        bool feed(const QString& line);
+
+        const Counters& counters() const { return m_counters; }
+        const QString& phase() const { return m_phase; }
+
+        /**
+         * @brief Error messages nix reported as internal-json events so far, with source positions if known.
+         */
+        const QList<NixLog::Event>& errors() const { return m_errors; }
+
+        /**
+         * @brief Builds the progress payload emitted through Controller::operation_progress for the last fed line.
+         * @param stream The stream the line came from ("stdout"/"stderr").
+         * @return JSON string with "stream", "line" (the display text for internal-json events), "phase",
+         * all counters and, if the line was an error event, "error": {"message", "file", "line", "column"}.
+         */
+        QString to_json(const QString& stream) const;
+
+    private:
+        bool feed_human(const QString& line);
+        bool feed_event(const QString& line);
+
+        QString m_phase;
+        Counters m_counters;
+        QString m_line;                     // display text of the last fed line
+        bool m_line_is_error;
+        QList<NixLog::Event> m_errors;
+        QHash<qint64, int> m_activities;    // running activity id -> NixLog::ActivityType
+        QHash<qint64, qint64> m_transferred; // file transfer activity id -> bytes done
+        QElapsedTimer m_since_report;       // rate limit for counter-only updates
+    };
+
+    /**
+     * @brief Parses sizes as printed by nix, e.g. "12.5 MiB", into bytes.
+     */
+    qint64 parse_size(const QString& number, const QString& unit);
+}
+
+#endif // NIX_PROGRESS_H
@@ -64,6 +64,52 @@ QString create_func_json_response(const QString& func_name, std::tuple<bool, QSt
     }
 }
 
+// fills packages from a JSON array of package names, returns an error response if packagesJsonString isn't one.
+QString parse_package_list(const QString& packagesJsonString, QStringList& packages)
+{
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(packagesJsonString.toUtf8(), &parseError);
+
+    if (parseError.error != QJsonParseError::NoError) {
+        qWarning() << "Failed to parse packages JSON:" << parseError.errorString();
+        return createJsonResponse(
+            false,
+            "Invalid input: Failed to parse packages JSON.",
+            QStringList(),
+            QStringList({"Invalid package list format."}),
+            QStringList({parseError.errorString()})
+        );
+    }
+    if (!doc.isArray()) {
+        qWarning() << "Expected a JSON array of packages, but received a different type.";
+        return createJsonResponse(
+            false,
+            "Invalid input: Expected a JSON array for packages.",
+            QStringList(),
+            QStringList({"Invalid package list format."}),
+            QStringList({"Input JSON is not an array."})
+        );
+    }
+    for (const QJsonValue& value : doc.array()) {
+        if (value.isString()) {
+            packages.append(value.toString());
+        } else {
+            qWarning() << "JSON array contains non-string elements. Skipping.";
+        }
+    }
+    return QString();
+}
+
+// home.nix and every imported module an edit could write, all of them are backed up and restored together
+QStringList editable_config_files(const QString& config_path)
+{
+    QStringList files;
+    for (const QString& file : ConfigGraph::load(config_path)->files()) {
+        if (file == config_path || QFileInfo(file).isWritable()) files.append(file);
+    }
+    return files;
+}
+
 namespace PackageManipulation {
     // universal output of all functions 
     // // On Success
@@ -107,7 +153,7 @@ namespace PackageManipulation {
                 QStringList(),
                 QStringList({"Failed to find config file."}), // This line is fine if simple_error is meant to be a single string array
                 QStringList({
-                    QStringLiteral("The configuration file path could not be determined (e.g., 'echo $HOME' failed or path not found). at %1").arg(actual_config_file_path)
+                    QStringLiteral("The configuration file path could not be determined (e.g., $HOME unknown or path not found). at %1").arg(actual_config_file_path)
                 })
             );
         }
@@ -154,7 +200,7 @@ namespace PackageManipulation {
                 QStringList(),
                 QStringList({"Failed to find config file."}),
                 QStringList({
-                    QStringLiteral("The configuration file path could not be determined (e.g., 'echo $HOME' failed or path not found). at %1").arg(actual_config_file_path)
+                    QStringLiteral("The configuration file path could not be determined (e.g., $HOME unknown or path not found). at %1").arg(actual_config_file_path)
                 })
             );
         }
@@ -171,6 +217,39 @@ namespace PackageManipulation {
         );
     }
 
+    QString read_package_files_wrapper(const QString& packageType)
+    {
+        qDebug() << "read_package_files_wrapper() function invoked from QML!";
+
+        QString actual_config_file_path = get_config_path();
+        if (actual_config_file_path.isEmpty()) {
+            return createJsonResponse(
+                false,
+                "Operation failed: Could not determine configuration file path.",
+                QStringList(),
+                QStringList({"Failed to find config file."}),
+                QStringList({
+                    QStringLiteral("The configuration file path could not be determined (e.g., $HOME unknown or path not found). at %1").arg(actual_config_file_path)
+                })
+            );
+        }
+
+        return create_func_json_response("PackageOperations::read_package_files(...)",
+            PackageOperations::read_package_files(actual_config_file_path, packageType));
+    }
+
+    QString describe_packages_wrapper(const QString& packagesJsonString)
+    {
+        qDebug() << "describe_packages_wrapper() function invoked from QML!";
+
+        QStringList packages;
+        const QString parse_error = parse_package_list(packagesJsonString, packages);
+        if (!parse_error.isEmpty()) {
+            return parse_error;
+        }
+        return create_func_json_response("PackageIndex::describe(packages)", PackageIndex::describe(packages));
+    }
+
     QString add_packages_wrapper(const QString& packagesJsonString, bool allow_insecure, const QString& packageType, bool overwrite)
     {
         qDebug() << "add_packages_wrapper() function invoked from QML! Packages JSON:" << packagesJsonString
@@ -185,7 +264,7 @@ namespace PackageManipulation {
                 QStringList(),
                 QStringList({"Failed to find config file."}),
                 QStringList({
-                    QStringLiteral("The configuration file path could not be determined (e.g., 'echo $HOME' failed or path not found). at %1").arg(actual_config_file_path)
+                    QStringLiteral("The configuration file path could not be determined (e.g., $HOME unknown or path not found). at %1").arg(actual_config_file_path)
                 })
             );
         }
@@ -227,8 +306,9 @@ namespace PackageManipulation {
 
         // --- TRANSACTIONAL LOGIC START ---
 
-        // 1. Make a backup of the config file
-        auto [backup_success, backup_msg] = backup_config_file(actual_config_file_path);
+        // 1. Make a backup of the config file (and the modules it imports)
+        const QStringList config_files = editable_config_files(actual_config_file_path);
+        auto [backup_success, backup_msg] = backup_config_files(config_files);
         if (!backup_success) {
             qWarning() << "Failed to create backup before adding packages:" << backup_msg;
             // Python equivalent: return packages_added , [[] ,["failed to backup too risky to run without, exiting."], [backup_error]]
@@ -244,22 +324,32 @@ namespace PackageManipulation {
         }
 
         // 2. Run the package addition code
-        QStringList added_packages = PackageOperations::add_packages(
+        auto [edit_success, added_packages] = PackageOperations::add_packages(
             actual_config_file_path, // Use the determined path
             packages_to_add,
             packageType,
             overwrite
         );
 
-        // 3. Try to apply the config
-        qDebug() << "Attempting to apply new config...";
-        auto [success, output, simple_error_vec, full_error_vec] = HomeManager::hm_switch(allow_insecure); // Renamed to avoid shadowing QJsonArray simple_error/full_error
+        bool success = edit_success;
+        QStringList simple_error_vec;
+        QStringList full_error_vec;
+        if (!edit_success) { // a half written config must not be switched to
+            qWarning() << "Failed to edit config file, restoring backup.";
+            simple_error_vec.append("Failed to edit the configuration file.");
+            full_error_vec.append(QStringLiteral("No usable '%1' package block in %2 or the file could not be written.").arg(packageType, actual_config_file_path));
+        } else {
+            // 3. Try to apply the config
+            qDebug() << "Attempting to apply new config...";
+            QStringList output;
+            std::tie(success, output, simple_error_vec, full_error_vec) = HomeManager::hm_switch(allow_insecure);
+        }
 
-        if (!success) { // Check if hm_switch reported any errors
+        if (!success) { // Check if the edit or hm_switch reported any errors
             qWarning() << "Failed to apply config after adding packages. Restoring backup.";
 
             // 4. On fail, run restore
-            auto [restore_success, restore_msg] = restore_config_file(actual_config_file_path);
+            auto [restore_success, restore_msg] = restore_config_files(config_files);
             // bool restore_success = true;
             // std::string restore_msg = "safety off for testing resotre did not happen!!!!!";
             if (!restore_success) {
@@ -317,7 +407,7 @@ namespace PackageManipulation {
                 QStringList(),
                 QStringList({"Failed to find config file."}),
                 QStringList({
-                    QStringLiteral("The configuration file path could not be determined (e.g., 'echo $HOME' failed or path not found). at %1").arg(actual_config_file_path)
+                    QStringLiteral("The configuration file path could not be determined (e.g., $HOME unknown or path not found). at %1").arg(actual_config_file_path)
                 })
             );
         }
@@ -359,8 +449,9 @@ namespace PackageManipulation {
 
         // --- TRANSACTIONAL LOGIC START ---
 
-        // 1. Make a backup of the config file
-        auto [backup_success, backup_msg] = backup_config_file(actual_config_file_path);
+        // 1. Make a backup of the config file (and the modules it imports)
+        const QStringList config_files = editable_config_files(actual_config_file_path);
+        auto [backup_success, backup_msg] = backup_config_files(config_files);
         if (!backup_success) {
             qWarning() << "Failed to create backup before deleting packages:" << backup_msg;
             // Python equivalent: return packages_deleted , [[] ,["failed to backup too risky to run without, exiting."], [backup_error]]
@@ -376,17 +467,27 @@ namespace PackageManipulation {
         }
 
         // 2. Run the package deletion code
-        QStringList deleted_packages = PackageOperations::delete_packages(actual_config_file_path, packages_to_delete, packageType.isEmpty() ? QString() : packageType);
-
-        // 3. Try to apply the config
-        qDebug() << "Attempting to apply new config...";
-        auto [success, output, simple_error_vec, full_error_vec] = HomeManager::hm_switch(true); // Renamed to avoid shadowing (true on allow insecure because we are deleting no point in specifying it in delete function)
+        auto [edit_success, deleted_packages] = PackageOperations::delete_packages(actual_config_file_path, packages_to_delete, packageType.isEmpty() ? QString() : packageType);
+
+        bool success = edit_success;
+        QStringList simple_error_vec;
+        QStringList full_error_vec;
+        if (!edit_success) { // a half written config must not be switched to
+            qWarning() << "Failed to edit config file, restoring backup.";
+            simple_error_vec.append("Failed to edit the configuration file.");
+            full_error_vec.append(QStringLiteral("The packages could not be removed from %1 or a file could not be written.").arg(actual_config_file_path));
+        } else {
+            // 3. Try to apply the config
+            qDebug() << "Attempting to apply new config...";
+            QStringList output;
+            std::tie(success, output, simple_error_vec, full_error_vec) = HomeManager::hm_switch(true); // true on allow insecure because we are deleting no point in specifying it in delete function
+        }
 
-        if (!success) { // Check if hm_switch reported any errors
+        if (!success) { // Check if the edit or hm_switch reported any errors
             qWarning() << "Failed to apply config after deleting packages. Restoring backup.";
 
             // 4. On fail, run restore
-            auto [restore_success, restore_msg] = restore_config_file(actual_config_file_path);
+            auto [restore_success, restore_msg] = restore_config_files(config_files);
             if (!restore_success) {
                 qCritical() << "CRITICAL ERROR: Failed to restore backup after failed hm_switch:" << restore_msg;
                 // Python equivalent: simple_error.insert(0, "failed to restore you're {filename}.backup probably does not exist!")
@@ -428,12 +529,161 @@ namespace PackageManipulation {
         // --- TRANSACTIONAL LOGIC END ---
     }
 
-    QString search_packages_wrapper(const QString& quarry, const bool local, const QString& base_url, const int timeout)
+    QString apply_changes_wrapper(const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure, const QString& packageType)
+    {
+        qDebug() << "apply_changes_wrapper() function invoked from QML! Add:" << toAddJsonString
+                << ", Delete:" << toDeleteJsonString << ", Package Type:" << packageType;
+
+        QString actual_config_file_path = get_config_path(); // Get the dynamically determined path
+        if (actual_config_file_path.isEmpty()) {
+            return createJsonResponse(
+                false,
+                "Operation failed: Could not determine configuration file path.",
+                QStringList(),
+                QStringList({"Failed to find config file."}),
+                QStringList({
+                    QStringLiteral("The configuration file path could not be determined (e.g., $HOME unknown or path not found). at %1").arg(actual_config_file_path)
+                })
+            );
+        }
+
+        QStringList packages_to_add;
+        QStringList packages_to_delete;
+        QString parse_error = parse_package_list(toAddJsonString, packages_to_add);
+        if (parse_error.isEmpty()) parse_error = parse_package_list(toDeleteJsonString, packages_to_delete);
+        if (!parse_error.isEmpty()) {
+            return parse_error;
+        }
+
+        if (packages_to_add.isEmpty() && packages_to_delete.isEmpty()) {
+            return createJsonResponse(
+                true,
+                "Operation Successfull: Nothing to change.",
+                PackageOperations::read_packages(actual_config_file_path, packageType),
+                QStringList(),
+                QStringList()
+            );
+        }
+
+        // --- TRANSACTIONAL LOGIC START ---
+        // one backup, one write and one hm_switch for the whole change, so it is applied or rolled back as a unit
+
+        // 1. Make a backup of the config file (and the modules it imports)
+        const QStringList config_files = editable_config_files(actual_config_file_path);
+        auto [backup_success, backup_msg] = backup_config_files(config_files);
+        if (!backup_success) {
+            qWarning() << "Failed to create backup before applying changes:" << backup_msg;
+            return createJsonResponse(
+                false,
+                "Operation failed: Could not create config backup, too risky to proceed.",
+                QStringList(),
+                QStringList({"Failed to create backup, operation aborted."}),
+                QStringList({backup_msg})
+            );
+        } else {
+            qDebug() << "Config backup created successfully:" << backup_msg;
+        }
+
+        // 2. Make all the edits in memory and write the config once
+        auto [edit_success, new_packages, deleted_packages] = PackageOperations::apply_changes(
+            actual_config_file_path,
+            packages_to_add,
+            packages_to_delete,
+            packageType
+        );
+
+        bool success = edit_success;
+        QStringList simple_error_vec;
+        QStringList full_error_vec;
+        if (!edit_success) {
+            qWarning() << "Failed to edit config file, restoring backup.";
+            simple_error_vec.append("Failed to edit the configuration file.");
+            full_error_vec.append(QStringLiteral("No usable '%1' package block in %2 or the file could not be written.").arg(packageType, actual_config_file_path));
+        } else {
+            // 3. Try to apply the config (allow_insecure only matters for what is added)
+            qDebug() << "Attempting to apply new config...";
+            QStringList output;
+            std::tie(success, output, simple_error_vec, full_error_vec) = HomeManager::hm_switch(allow_insecure || packages_to_add.isEmpty());
+        }
+
+        if (!success) {
+            qWarning() << "Failed to apply changes. Restoring backup.";
+
+            // 4. On fail, run restore
+            auto [restore_success, restore_msg] = restore_config_files(config_files);
+            if (!restore_success) {
+                qCritical() << "CRITICAL ERROR: Failed to restore backup after failed apply_changes:" << restore_msg;
+                simple_error_vec.insert(0, QString("Failed to restore configuration. Your backup '%1.backup' might not exist or is corrupted.").arg(actual_config_file_path));
+                full_error_vec.append(QString("Backup restore failed: %1").arg(restore_msg));
+
+                return createJsonResponse(
+                    false,
+                    "CRITICAL ERROR: Failed to apply changes AND could not restore backup. Configuration might be unstable.",
+                    QStringList(),
+                    simple_error_vec,
+                    full_error_vec
+                );
+            } else {
+                qDebug() << "Backup restored successfully:" << restore_msg;
+                return createJsonResponse(
+                    false,
+                    "Failed to apply changes, backup restored. Please check your configuration.",
+                    QStringList(),
+                    simple_error_vec,
+                    full_error_vec
+                );
+            }
+        }
+
+        qDebug() << "Config applied successfully, deleted:" << deleted_packages;
+        return createJsonResponse(
+            true,
+            "Operation Successfull: Applied package changes.",
+            new_packages,
+            QStringList(),
+            QStringList()
+        );
+        // --- TRANSACTIONAL LOGIC END ---
+    }
+
+    QString preview_changes_wrapper(const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType)
+    {
+        qDebug() << "preview_changes_wrapper() function invoked from QML! Add:" << toAddJsonString
+                << ", Delete:" << toDeleteJsonString << ", Package Type:" << packageType;
+
+        QString actual_config_file_path = get_config_path(); // Get the dynamically determined path
+        if (actual_config_file_path.isEmpty()) {
+            return createJsonResponse(
+                false,
+                "Operation failed: Could not determine configuration file path.",
+                QStringList(),
+                QStringList({"Failed to find config file."}),
+                QStringList({
+                    QStringLiteral("The configuration file path could not be determined (e.g., $HOME unknown or path not found). at %1").arg(actual_config_file_path)
+                })
+            );
+        }
+
+        QStringList packages_to_add;
+        QStringList packages_to_delete;
+        QString parse_error = parse_package_list(toAddJsonString, packages_to_add);
+        if (parse_error.isEmpty()) parse_error = parse_package_list(toDeleteJsonString, packages_to_delete);
+        if (!parse_error.isEmpty()) {
+            return parse_error;
+        }
+
+        return create_func_json_response("PackageOperations::preview_changes(...)",
+            PackageOperations::preview_changes(actual_config_file_path, packages_to_add, packages_to_delete, packageType));
+    }
+
+    QString search_packages_wrapper(const QString& quarry, const bool local, const QString& base_url, const int timeout, const bool by_command)
     {
         qDebug() << "search_packages_wrapper() function invoked from QML!, redirecting to quarry functions.";
         
-        if (local) {
-            return create_func_json_response("NixEnv::quarry(quarry)", NixEnv::quarry(quarry)); 
+        if (by_command) {
+            return create_func_json_response("CommandLookup::search(quarry)", CommandLookup::search(quarry));
+        } else if (local) {
+            return create_func_json_response("PackageIndex::search(quarry)", PackageIndex::search(quarry)); 
         } else {
             return create_func_json_response("NixHubAPI::quarry(quarry , base_url)", NixHubAPI::quarry(quarry , base_url, timeout)); 
         }
@@ -472,7 +722,15 @@ namespace ChannelManipulation {
     QString update_channels_wrapper()
     {
         // Correctly call the backend C++ function `update_channel`
-        return create_func_json_response("NixChannel::update_channels()", NixChannel::update_channels()); 
+        auto [success, output, full_error] = NixChannel::update_channels();
+        if (success) {
+            // new channel revision, build its local search index now rather than on the next search
+            auto [indexed, index_output, index_error] = PackageIndex::ensure_index();
+            if (!indexed) {
+                full_error << QStringLiteral("Channels updated, but the local search index could not be built:") << index_error;
+            }
+        }
+        return create_func_json_response("NixChannel::update_channels()", std::make_tuple(success, output, full_error)); 
     }
 
     QString list_channels_wrapper()
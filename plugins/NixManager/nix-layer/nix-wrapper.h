@@ -33,9 +33,12 @@
 
 // custom libs
 #include "nix-config.h" // read/add/delete
+#include "config-graph.h" // imported modules
 #include "backup-config.h" // backup/restore/config_path
 #include "nix-interact.h" // apply/update/detect
 #include "nixhub-api.h" // search
+#include "package-index.h" // local search
+#include "command-lookup.h" // search by command
 
 namespace PackageManipulation {
 
@@ -84,6 +87,26 @@ namespace PackageManipulation {
     // QString read_packages_wrapper(const QString& packageType = QString::fromStdString("home"));
     QString read_packages_wrapper(const QString& packageType);
 
+    /**
+    * @brief Lists which file of the configuration (home.nix or an imported module) every package of a type is in.
+    *
+    * @param packageType The type of package block to read (e.g., "home", "system").
+    * @return A JSON string whose output holds one {"name", "file", "line", "conditional"} object per package,
+    * full_error lists imported files that could not be read.
+    */
+    QString read_package_files_wrapper(const QString& packageType);
+
+    /**
+    * @brief Looks installed packages up in the local package index (version, description, platform).
+    *
+    * Only uses an index that already exists, it never evaluates nixpkgs itself.
+    *
+    * @param packagesJsonString A JSON array of package names as returned by read_packages (e.g. ["pkgs.firefox"]).
+    * @return A JSON string with one {"name", "found", "summary", "version", "available"} object per package,
+    * or a JSON object with error details if there is no index yet.
+    */
+    QString describe_packages_wrapper(const QString& packagesJsonString);
+
     /**
     * @brief Adds new packages to the Nix configuration file.
     *
@@ -119,6 +142,33 @@ namespace PackageManipulation {
     // QString delete_packages_wrapper(const QString& packagesJsonString, const QString& packageType = QString::fromStdString("home"));
     QString delete_packages_wrapper(const QString& packagesJsonString, const QString& packageType);
 
+    /**
+     * @brief Deletes and adds packages as one transaction.
+     *
+     * Every edit is made in memory, the configuration file is written once and a single
+     * hm_switch applies the whole change. If anything fails the backup is restored, so the
+     * change is applied or rolled back as a unit.
+     *
+     * @param toAddJsonString A JSON string representing a QJsonArray of package names to add.
+     * @param toDeleteJsonString A JSON string representing a QJsonArray of package names to delete.
+     * @param allow_insecure allows the installation of insecure packages with known CVE.
+     * @param packageType The type of package block to modify (e.g., "home", "system").
+     * @return A JSON string indicating success/failure, along with data (the packages of the block
+     * after the change) or error messages and output from the Nix build process.
+     */
+    QString apply_changes_wrapper(const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure, const QString& packageType);
+
+    /**
+     * @brief Shows what apply_changes_wrapper would change in the configuration file, nothing is written or built.
+     *
+     * @param toAddJsonString A JSON string representing a QJsonArray of package names to add.
+     * @param toDeleteJsonString A JSON string representing a QJsonArray of package names to delete.
+     * @param packageType The type of package block to modify (e.g., "home", "system").
+     * @return A JSON string indicating success/failure, with the unified diff of the change as data
+     * (one entry per line, empty if nothing would change) or why the change cannot be made.
+     */
+    QString preview_changes_wrapper(const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType);
+
     /**
     * @brief Searches for packages based on a query string.
     *
@@ -132,11 +182,13 @@ namespace PackageManipulation {
     * or a remote search (false).
     * @param base_url A string representing the URL for the remote search API. Defaults 
     * to "https://search.devbox.sh".
+    * @param by_command Treat quarry as a command name and return the packages providing it
+    * (see CommandLookup), local and base_url are ignored then.
     * @return A JSON string indicating success or failure, along with the search 
     * results or error messages.
     */
     // QString search_packages_wrapper(const QString& quarry, const bool local = false, const QString& base_url = QString::fromStdString("https://search.devbox.sh"));
-    QString search_packages_wrapper(const QString& quarry, const bool local, const QString& base_url, const int timeout);
+    QString search_packages_wrapper(const QString& quarry, const bool local, const QString& base_url, const int timeout, const bool by_command);
 }
 
 namespace ChannelManipulation {
@@ -21,42 +21,93 @@
 // Include nlohmann/json header
 
 #include "nixhub-api.h" // header
+#include "../libs/http-cache.h"
+#include "package-index.h" // platforms of packages we know locally
+#include "platform-check.h" // platforms of the rest, evaluated locally
+#include "../libs/search-ranking.h"
 
 
-std::tuple<bool, QString> httpGetRawUrl(const QString &rawUrl, int timeoutMs) {
+// one manager per worker thread (QNetworkAccessManager is not thread safe), kept alive across calls to reuse sockets
+static QNetworkAccessManager& thread_manager() {
+    static QThreadStorage<QNetworkAccessManager*> managers;
+    if (!managers.hasLocalData()) managers.setLocalData(new QNetworkAccessManager);
+    return *managers.localData();
+}
+
+// package metadata changes at most daily, search results a bit more often
+static const qint64 kDetailsTtlMs = 24 * 3600 * 1000;
+static const qint64 kSearchTtlMs = 3600 * 1000;
+
+static qint64 ttl_for(const QString &rawUrl) {
+    return rawUrl.contains(QStringLiteral("/v2/pkg?")) ? kDetailsTtlMs : kSearchTtlMs;
+}
+
+static QNetworkRequest make_request(const QString &rawUrl, const HttpCache::Entry &cached = HttpCache::Entry()) {
     QUrl url = QUrl::fromEncoded(rawUrl.toUtf8()); // don't forget encoding!!
     QNetworkRequest req(url); // create rq object
     req.setHeader(QNetworkRequest::UserAgentHeader, "nixhub/1.0");
-    static QNetworkAccessManager mgr;           // keep alive across calls, avoids destroying it while replies are still running and reuses sockets/IO efficiency
+    // stale cache entry: ask the server whether it changed instead of downloading it again
+    if (cached.found && !cached.etag.isEmpty()) req.setRawHeader("If-None-Match", cached.etag);
+    if (cached.found && !cached.last_modified.isEmpty()) req.setRawHeader("If-Modified-Since", cached.last_modified);
+    return req;
+}
+
+// Turns a finished (or timed out) reply into httpGetRawUrl's result and updates the cache.
+// A stale cache entry is served when the server says it's unchanged or can't be reached.
+static std::tuple<bool, QString> finish_reply(QNetworkReply *reply, const QString &rawUrl, const HttpCache::Entry &cached, bool timed_out) {
+    if (timed_out || reply->error() != QNetworkReply::NoError) {
+        const QString err = timed_out ? QStringLiteral("timeout") : reply->errorString();
+        if (cached.found) {
+            qDebug() << "httpGetRawUrl: serving stale cache for" << rawUrl << "(" << err << ")";
+            return {true, QString::fromUtf8(cached.body)};
+        }
+        return {false, err};
+    }
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304 && cached.found) {
+        HttpCache::refresh(rawUrl);
+        return {true, QString::fromUtf8(cached.body)};
+    }
+    QByteArray data = reply->readAll();
+    if (!data.isEmpty()) HttpCache::store(rawUrl, data, reply->rawHeader("ETag"), reply->rawHeader("Last-Modified"));
+    return {true, QString::fromUtf8(data)};
+}
+
+std::tuple<bool, QString> httpGetRawUrl(const QString &rawUrl, int timeoutMs) {
+    const HttpCache::Entry cached = HttpCache::lookup(rawUrl);
+    if (cached.found && cached.age_ms < ttl_for(rawUrl)) {
+        return {true, QString::fromUtf8(cached.body)}; // fresh enough, no request at all
+    }
+
+    QNetworkRequest req = make_request(rawUrl, cached);
+    QNetworkAccessManager& mgr = thread_manager();
     QEventLoop loop; 
     QNetworkReply *reply = mgr.get(req); 
     QObject::connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit); // Connects the reply's finished signal to the event loop's quit slot
     QTimer timer; timer.setSingleShot(true);
     QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit); // Connects the timer's timeout signal to the same event loop quit
     timer.start(timeoutMs);
+    QTimer cancel_poll; // stop waiting as soon as the current request gets cancelled or times out
+    QObject::connect(&cancel_poll, &QTimer::timeout, &loop, [&loop]() {
+        if (OperationContext::interruption() != OperationContext::Interruption::None) loop.quit();
+    });
+    cancel_poll.start(100);
     loop.exec();
-    if (!timer.isActive()) { reply->abort(); reply->deleteLater(); return {false, QStringLiteral("timeout")}; } // If the timer is no longer active it means it fired (timeout occurred) before we explicitly stopped it. 
-    if (reply->error() != QNetworkReply::NoError) {
-        QString err = reply->errorString();
-        reply->deleteLater();
-        return {false, err};
+    if (OperationContext::interruption() != OperationContext::Interruption::None && !reply->isFinished()) {
+        reply->abort(); reply->deleteLater();
+        return {false, OperationContext::interruption_message(OperationContext::interruption())};
     }
-    QByteArray data = reply->readAll();
+    const bool timed_out = !timer.isActive(); // If the timer is no longer active it means it fired (timeout occurred) before we explicitly stopped it.
+    if (timed_out) reply->abort();
+    auto result = finish_reply(reply, rawUrl, cached, timed_out);
     reply->deleteLater();
-    return {true, QString::fromUtf8(data)};
+    return result;
 }
 
 namespace NixHubAPI {
-    // Function to fetch package details
-    std::tuple<bool, QJsonObject, QString>
-    fetchPackageDetails(const QString& package_id, const QString& base_url, int timeoutMs) {
-        const QString api_heading = "/v2/pkg?name=";
-        QString assembled_url = base_url + api_heading + package_id; // for example: https://search.devbox.sh/v2/pkg?name=firefox (base_url being: https://search.devbox.sh , package_id being: firefox)
-
+    // Turns the response of a details request into the package's QJsonObject
+    static std::tuple<bool, QJsonObject, QString>
+    parse_package_details(bool success, const QString& output) {
         QString errors = ""; //init QString
-        QString output;
-        bool success;
-        std::tie(success, output) = httpGetRawUrl(assembled_url, timeoutMs);
         if (!success) { // if not successful check why
             if (output == "timeout") { // if timeout log as such
                 errors += "\nRequest timeout";
@@ -85,9 +136,187 @@ namespace NixHubAPI {
         return {true, doc.object(), errors}; // return API results as QJsonObject
     }
 
-    std::tuple<bool, QStringList, QStringList>
-    quarry(const QString& quarry, const QString& base_url, const int timeoutS)
+    static QString details_url(const QString& package_id, const QString& base_url) {
+        const QString api_heading = "/v2/pkg?name=";
+        return base_url + api_heading + package_id; // for example: https://search.devbox.sh/v2/pkg?name=firefox (base_url being: https://search.devbox.sh , package_id being: firefox)
+    }
+
+    // Function to fetch package details
+    std::tuple<bool, QJsonObject, QString>
+    fetchPackageDetails(const QString& package_id, const QString& base_url, int timeoutMs) {
+        QString output;
+        bool success;
+        std::tie(success, output) = httpGetRawUrl(details_url(package_id, base_url), timeoutMs);
+        return parse_package_details(success, output);
+    }
+
+    QVector<std::tuple<bool, QJsonObject, QString>>
+    fetchPackageDetailsBatch(const QStringList& package_ids, const QString& base_url, int timeoutMs, int deadlineMs,
+                             int concurrency, const DetailCallback& on_result) {
+        QVector<std::tuple<bool, QJsonObject, QString>> results(package_ids.size(), std::make_tuple(false, QJsonObject(), QStringLiteral("\nRequest not started")));
+        if (package_ids.isEmpty()) return results;
+
+        QNetworkAccessManager& mgr = thread_manager();
+        QEventLoop loop; // runs the replies on this worker's thread, they all share it
+        QHash<QNetworkReply*, int> in_flight; // reply -> index in package_ids
+        int next = 0;
+        int done = 0;
+        QString stop_reason; // set once we stop waiting, replies aborted after that get it as error
+
+        QVector<HttpCache::Entry> cached(package_ids.size());
+
+        std::function<void()> start_next;
+        auto record = [&](int index, bool success, const QString& output) {
+            results[index] = parse_package_details(success, output);
+            done++;
+            if (on_result) {
+                on_result(index, std::get<0>(results[index]), std::get<1>(results[index]), std::get<2>(results[index]));
+            }
+        };
+        auto on_finished = [&](QNetworkReply* reply) {
+            const int index = in_flight.take(reply);
+            if (!stop_reason.isEmpty()) {
+                results[index] = std::make_tuple(false, QJsonObject(), "\n" + stop_reason);
+                done++;
+                reply->deleteLater();
+                return;
+            }
+            const QString url = details_url(package_ids.at(index), base_url);
+            auto [success, output] = finish_reply(reply, url, cached.at(index), reply->property("timed_out").toBool());
+            reply->deleteLater();
+            record(index, success, output);
+            start_next();
+        };
+        start_next = [&]() {
+            while (in_flight.size() < qMax(1, concurrency) && next < package_ids.size()) {
+                const int index = next++;
+                const QString url = details_url(package_ids.at(index), base_url);
+                cached[index] = HttpCache::lookup(url);
+                if (cached.at(index).found && cached.at(index).age_ms < ttl_for(url)) {
+                    record(index, true, QString::fromUtf8(cached.at(index).body)); // fresh from disk, no request
+                    continue;
+                }
+                QNetworkReply* reply = mgr.get(make_request(url, cached.at(index)));
+                in_flight.insert(reply, index);
+                QTimer* timer = new QTimer(reply); // per-request budget, dies with the reply
+                timer->setSingleShot(true);
+                QObject::connect(timer, &QTimer::timeout, reply, [reply]() {
+                    reply->setProperty("timed_out", true);
+                    reply->abort(); // emits finished
+                });
+                timer->start(timeoutMs);
+                QObject::connect(reply, &QNetworkReply::finished, timer, &QTimer::stop);
+                QObject::connect(reply, &QNetworkReply::finished, &loop, [&on_finished, reply]() { on_finished(reply); });
+            }
+            if (done == package_ids.size()) loop.quit();
+        };
+
+        QTimer deadline; deadline.setSingleShot(true); // the whole batch has to be done by then
+        QObject::connect(&deadline, &QTimer::timeout, &loop, &QEventLoop::quit);
+        deadline.start(qMax(0, deadlineMs));
+        QTimer cancel_poll; // stop as soon as the current request gets cancelled, superseded or times out
+        QObject::connect(&cancel_poll, &QTimer::timeout, &loop, [&loop]() {
+            if (OperationContext::interruption() != OperationContext::Interruption::None) loop.quit();
+        });
+        cancel_poll.start(100);
+
+        start_next();
+        if (done < package_ids.size()) loop.exec();
+
+        if (done < package_ids.size()) {
+            const OperationContext::Interruption interrupted = OperationContext::interruption();
+            stop_reason = interrupted != OperationContext::Interruption::None
+                ? OperationContext::interruption_message(interrupted)
+                : QStringLiteral("Search deadline exceeded");
+            qDebug() << "NixHubAPI: stopping detail fetches," << stop_reason << "-" << done << "of" << package_ids.size() << "done";
+            const QList<QNetworkReply*> running = in_flight.keys();
+            for (QNetworkReply* reply : running) reply->abort(); // finished fires right away and records stop_reason
+            for (int index = next; index < package_ids.size(); ++index) {
+                results[index] = std::make_tuple(false, QJsonObject(), "\n" + stop_reason); // never started
+            }
+        }
+        return results;
+    }
+
+    // true if one of the package's releases is built for this device's architecture
+    static bool matches_arch(const QJsonObject& package_details) {
+        const QString arch = QLatin1String(ARCH) == QLatin1String("aarch64") ? QStringLiteral("arm64") : QStringLiteral("x86-64"); // if its not arm64 its x86-64, ARCH macro will return x86_64 we need x86-64.
+        if (package_details.contains("releases") && package_details["releases"].isArray()) { // {"name":"","summary":"","homepage_url":"","license":"","releases":[WHAT WE WANT]}
+            QJsonArray releasesArray = package_details["releases"].toArray();
+            for (const auto& release : releasesArray) {
+                if (!release.isObject()) continue;
+                QJsonObject releaseObject = release.toObject();
+
+                if (releaseObject.contains("platforms") && releaseObject["platforms"].isArray()) { // "releases":[{"version":"","last_updated":"","platforms":[WHAT WE WANT]}]
+                    QJsonArray platformsArray = releaseObject["platforms"].toArray();
+                    for (const auto& platform : platformsArray) {
+                        if (!platform.isObject()) continue;
+                        QJsonObject platformObject = platform.toObject();
+
+                        // Check for architecture match
+                        if (platformObject.contains("arch") && platformObject["arch"].isString() && // "platforms":[{"arch": "WHAT WE WANT"},..,..,..]
+                            platformObject["arch"].toString() == arch) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // Offline fallback: searches the package details we have on disk from earlier searches.
+    // Every word of the query has to show up in the package's name or summary.
+    static std::tuple<bool, QStringList, QStringList>
+    search_cached(const QString& quarry, const QString& base_url, const QString& why)
     {
+        const QStringList terms = quarry.toLower().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        const auto cached = HttpCache::entries(details_url(QString(), base_url), kOfflineScanLimit);
+
+        QList<QJsonObject> found;
+        const SearchRanking::Query query(quarry);
+        SearchRanking::TopK best(kOfflineMaxResults);
+        for (const auto& entry : cached) {
+            const auto [parsed, package_details, parse_error] = parse_package_details(true, QString::fromUtf8(entry.second));
+            if (!parsed || !package_details["name"].isString()) continue;
+
+            const QString haystack = package_details["name"].toString().toLower() + " " + package_details["summary"].toString().toLower();
+            bool all_terms = true;
+            for (const QString& term : terms) {
+                if (!haystack.contains(term)) { all_terms = false; break; }
+            }
+            if (!all_terms || !matches_arch(package_details)) continue;
+
+            // same shape as a /v2/search result
+            QJsonObject package_object;
+            package_object["name"] = package_details["name"];
+            package_object["summary"] = package_details["summary"];
+            const QJsonArray releases = package_details["releases"].toArray();
+            if (!releases.isEmpty()) package_object["last_updated"] = releases.first().toObject()["last_updated"];
+            best.offer(SearchRanking::score(query, package_object["name"].toString(), package_object["summary"].toString()), found.size());
+            found << package_object;
+        }
+
+        QStringList matches;
+        for (int index : best.take()) {
+            OperationContext::report_partial(QJsonDocument(QJsonObject{{"event", "result"}, {"rank", matches.size()}, {"package", found.at(index)}}).toJson(QJsonDocument::Compact));
+            matches.append(QJsonDocument(found.at(index)).toJson());
+        }
+
+        if (matches.isEmpty()) {
+            return {false, QStringList(), {why + "\nNo cached packages match while offline"}};
+        }
+        return {true, matches, {why + "\nNetwork unavailable, showing recently seen packages from the cache"}};
+    }
+
+    // the search itself, quarry() wraps it to close the stream of partial results
+    static std::tuple<bool, QStringList, QStringList>
+    search_remote(const QString& quarry, const QString& base_url, const int timeoutS)
+    {
+        QElapsedTimer search_clock; // the whole search, list and details, has to fit in kSearchDeadlineFactor * timeout
+        search_clock.start();
+        const qint64 search_deadline_ms = static_cast<qint64>(timeoutS) * 1000 * kSearchDeadlineFactor;
+
         QString api_heading = "/v2/search?q=";
         QString assembled_url = base_url + api_heading + quarry; // for example: https://search.devbox.sh/v2/search?q=firefox (base_url being: https://search.devbox.sh , quarry being: firefox)
 
@@ -102,6 +331,9 @@ namespace NixHubAPI {
             } else { // else put somethign generic
                 full_error += "\nRequest failed";
             }
+            if (OperationContext::interruption() == OperationContext::Interruption::None) {
+                return search_cached(quarry, base_url, full_error); // offline? try what we have seen before
+            }
             return {false, {output}, {full_error}};
         } else if (output.isEmpty()) { // if empty log as such
             full_error += "\nResponse Empty";
@@ -143,7 +375,9 @@ namespace NixHubAPI {
         // The accumulator MUST be a QJsonArray to use Qt JSON methods like append/isEmpty.
         QStringList filtered_packages_qjson; 
 
-        // Iterate over the initial list of packages
+        // Collect the packages that have a name, in the order of the API
+        QList<QJsonObject> package_objects;
+        QStringList package_ids;
         for (const auto& package_value : output_packages_array) {
             
             // Ensure the iterated item is a QJsonObject before calling toObject()
@@ -152,54 +386,97 @@ namespace NixHubAPI {
 
             // Check if the package has a name
             if (!package_object.contains("name") || !package_object["name"].isString()) continue;
-            
-            // Use the QJsonObject to get the package_id
-            QString package_id = package_object["name"].toString();
-            
-            QJsonObject package_details;
-            QString fetch_error;
-            
-            // Fetch detailed package info (releases, platforms, etc.)
-            std::tie(success, package_details, fetch_error) = fetchPackageDetails(package_id, base_url, timeoutS*1000);
 
-            if (!success) {
-                full_error += "\ncould not find package - " + package_id; // get package_id for logs
+            package_objects << package_object;
+            package_ids << package_object["name"].toString();
+        }
+
+        // our own relevance order (the same as local search uses), only the best kMaxResults are
+        // checked and returned, details of the best matches are fetched first
+        {
+            const SearchRanking::Query query(quarry);
+            SearchRanking::TopK ranking(kMaxResults);
+            for (int i = 0; i < package_objects.size(); ++i) {
+                ranking.offer(SearchRanking::score(query, package_ids.at(i), package_objects.at(i)["summary"].toString(), i), i);
+            }
+            QList<QJsonObject> ranked_objects;
+            QStringList ranked_ids;
+            for (int index : ranking.take()) {
+                ranked_objects << package_objects.at(index);
+                ranked_ids << package_ids.at(index);
+            }
+            package_objects.swap(ranked_objects);
+            package_ids.swap(ranked_ids);
+        }
+
+        // every package that passes the architecture check goes to QML right away, ranked by its relevance
+        auto report = [&](int index) {
+            QJsonObject partialObj;
+            partialObj["event"] = "result";
+            partialObj["rank"] = index;
+            partialObj["package"] = package_objects.at(index);
+            OperationContext::report_partial(QJsonDocument(partialObj).toJson(QJsonDocument::Compact));
+        };
+
+        // the local package index already knows the platforms of most packages, the rest is evaluated
+        // against the local channel in one go, NixHub is only asked about what neither could answer
+        QVector<int> known = PackageIndex::availability(package_ids);
+        QStringList unknown_ids;
+        for (int i = 0; i < package_ids.size(); ++i) {
+            if (known.at(i) == -1) unknown_ids << package_ids.at(i);
+        }
+        if (!unknown_ids.isEmpty()) {
+            const QVector<int> evaluated = PlatformCheck::availability(unknown_ids);
+            for (int i = 0, u = 0; i < package_ids.size(); ++i) {
+                if (known.at(i) == -1) known[i] = evaluated.at(u++);
+            }
+        }
+        QStringList fetch_ids;
+        QVector<int> fetch_index; // fetch_ids -> package_ids
+        for (int i = 0; i < package_ids.size(); ++i) {
+            if (known.at(i) == 1) report(i);
+            if (known.at(i) != -1) continue;
+            fetch_ids << package_ids.at(i);
+            fetch_index << i;
+        }
+
+        // Fetch detailed package info (releases, platforms, etc.) for all of them at once, kDetailConcurrency at a time
+        const qint64 remaining_ms = qMax<qint64>(0, search_deadline_ms - search_clock.elapsed());
+        auto report_match = [&](int index, bool fetched, const QJsonObject& package_details, const QString&) {
+            if (fetched && matches_arch(package_details)) report(fetch_index.at(index));
+        };
+        const auto details = fetchPackageDetailsBatch(fetch_ids, base_url, timeoutS*1000, static_cast<int>(remaining_ms),
+                                                      kDetailConcurrency, report_match);
+
+        // cancelled or superseded: nobody will look at what we have
+        const OperationContext::Interruption interrupted = OperationContext::interruption();
+        if (interrupted != OperationContext::Interruption::None) {
+            full_error += "\n" + OperationContext::interruption_message(interrupted);
+            return {false, QStringList(), {full_error}};
+        }
+
+        int fetched_index = 0;
+        for (int i = 0; i < package_ids.size(); ++i) {
+            if (known.at(i) != -1) { // decided by the local index
+                if (known.at(i) == 1) filtered_packages_qjson.append(QJsonDocument(package_objects.at(i)).toJson());
+                continue;
+            }
+            const auto& [fetched, package_details, fetch_error] = details.at(fetched_index++);
+            if (!fetched) {
+                full_error += "\ncould not find package - " + package_ids.at(i); // get package_id for logs
                 full_error += "\n" + fetch_error; // get actual error for logs
                 continue; // Move to the next package
             }
 
-            bool arch_match_found = false;
-            if (package_details.contains("releases") && package_details["releases"].isArray()) { // {"name":"","summary":"","homepage_url":"","license":"","releases":[WHAT WE WANT]}
-                QJsonArray releasesArray = package_details["releases"].toArray();
-                for (const auto& release : releasesArray) {
-                    if (!release.isObject()) continue;
-                    QJsonObject releaseObject = release.toObject(); 
-
-                    if (releaseObject.contains("platforms") && releaseObject["platforms"].isArray()) { // "releases":[{"version":"","last_updated":"","platforms":[WHAT WE WANT]}]
-                        QJsonArray platformsArray = releaseObject["platforms"].toArray();
-                        for (const auto& platform : platformsArray) {
-                            if (!platform.isObject()) continue;
-                            QJsonObject platformObject = platform.toObject();
-
-                            // Check for architecture match
-                            if (platformObject.contains("arch") && platformObject["arch"].isString() && // "platforms":[{"arch": "WHAT WE WANT"},..,..,..]
-                                platformObject["arch"].toString().toStdString() == (ARCH == "aarch64" ? "arm64" : "x86-64")) // if its not arm64 its x86-64, ARCH macro will return x86_64 we need x86-64 hence this ternary operator.
-                            { 
-                                // FIX: use package_object to ensure there is actually a valid JSON appended unlike using package_value
-                                filtered_packages_qjson.append(QJsonDocument(package_object).toJson());
-                                arch_match_found = true;
-                                break; // Break out of the platform loop
-                            }
-                        }
-                    }
-                    if (arch_match_found) break; // Break out of the release loop
-                }
+            if (matches_arch(package_details)) {
+                // FIX: use package_object to ensure there is actually a valid JSON appended unlike using package_value
+                filtered_packages_qjson.append(QJsonDocument(package_objects.at(i)).toJson());
             }
         }
 
         // Check Use QJsonArray::isEmpty() on filtered_packages_qjson
         if (filtered_packages_qjson.isEmpty()) {
-            full_error += "\nNo packages found with matching architecture! (" + QString::fromStdString((ARCH == "aarch64" ? "arm64" : "x86-64")) + ")";
+            full_error += "\nNo packages found with matching architecture! (" + QString(QLatin1String(ARCH) == QLatin1String("aarch64") ? "arm64" : "x86-64") + ")";
             // Return failure status and empty vector of results
             return {false, {output}, {full_error}};
         }
@@ -207,4 +484,18 @@ namespace NixHubAPI {
         // Return success status (based on filtering result), the converted string vector, and all errors
         return {true, filtered_packages_qjson, {full_error}};
     }
+
+    std::tuple<bool, QStringList, QStringList>
+    quarry(const QString& quarry, const QString& base_url, const int timeoutS)
+    {
+        auto result = search_remote(quarry, base_url, timeoutS);
+
+        // final event of the stream, no more partial results follow
+        QJsonObject completeObj;
+        completeObj["event"] = "complete";
+        completeObj["success"] = std::get<0>(result);
+        completeObj["count"] = std::get<0>(result) ? std::get<1>(result).size() : 0;
+        OperationContext::report_partial(QJsonDocument(completeObj).toJson(QJsonDocument::Compact));
+        return result;
+    }
 }
\ No newline at end of file
@@ -33,6 +33,12 @@
 #include <QEventLoop>
 #include <QNetworkReply>
 #include <QTimer>
+#include <QThreadStorage>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+#include <functional>
+#include "../libs/operation-context.h"
 
 namespace NixHubAPI {
     /**
@@ -53,6 +59,55 @@ namespace NixHubAPI {
     std::tuple<bool, QJsonObject, QString>
     fetchPackageDetails(const QString& package_id, const QString& base_url, int timeoutMs);
 
+    /**
+    * @brief Number of detail requests quarry keeps in flight at the same time.
+    */
+    const int kDetailConcurrency = 8;
+
+    /**
+    * @brief A whole quarry (search list and all details) has to finish within this many times its timeout.
+    */
+    const int kSearchDeadlineFactor = 3;
+
+    /**
+    * @brief quarry checks and returns at most this many of the search API's results, the most relevant ones.
+    */
+    const int kMaxResults = 50;
+
+    /**
+    * @brief Offline search looks at this many cached package details at most.
+    */
+    const int kOfflineScanLimit = 5000;
+
+    /**
+    * @brief Offline search returns at most this many packages.
+    */
+    const int kOfflineMaxResults = 50;
+
+    /**
+    * @brief Called for every finished detail request: index into package_ids, success, details, error.
+    */
+    using DetailCallback = std::function<void(int, bool, const QJsonObject&, const QString&)>;
+
+    /**
+    * @brief Fetches the details of many packages concurrently on the calling thread's event loop.
+    *
+    * At most concurrency requests are in flight at once, each one gets timeoutMs and the
+    * whole batch stops after deadlineMs or when the current request is cancelled, anything
+    * unfinished by then fails with the reason as error.
+    *
+    * @param package_ids The packages to fetch, in relevance order.
+    * @param base_url Base URL of the search API (e.g., "https://search.devbox.sh").
+    * @param timeoutMs Timeout of every single request.
+    * @param deadlineMs Time budget of the whole batch.
+    * @param concurrency Maximum number of requests in flight.
+    * @param on_result Optional, called as soon as each request finishes (in completion order).
+    * @return One fetchPackageDetails style tuple per package_id, in the order of package_ids.
+    */
+    QVector<std::tuple<bool, QJsonObject, QString>>
+    fetchPackageDetailsBatch(const QStringList& package_ids, const QString& base_url, int timeoutMs, int deadlineMs,
+                             int concurrency = kDetailConcurrency, const DetailCallback& on_result = DetailCallback());
+
     /**
     * @brief Queries for a specified package using a given URL of the NixHub API (v2), Filter packages by architecture.
     *
@@ -61,6 +116,14 @@ namespace NixHubAPI {
     * based on its name. It constructs a request URL using the provided package name
     * and an optional custom URL. The function returns a tuple indicating success or
     * failure, an error message (if any), and the search results in JSON format.
+    * Package details are fetched kDetailConcurrency at a time and the whole search
+    * stops after kSearchDeadlineFactor * timeout, the kMaxResults most relevant results
+    * (see SearchRanking) are kept, best first.
+    * Responses are cached on disk (see HttpCache), when the search API can't be reached
+    * the cached details of recently seen packages are searched instead.
+    * Packages the local package index knows (see PackageIndex::availability) are filtered
+    * by its platform data, the others are evaluated against the local channel in a single
+    * nix-instantiate call (see PlatformCheck), only what neither can answer needs its details fetched.
     *
     * @param quarry The name of the package to search for.
     * @param base_url An optional URL for the search API. Defaults to 
@@ -0,0 +1,350 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "package-index.h"
+#include "../libs/login-env.h"
+#include "../libs/package-catalog.h"
+#include "../libs/package-set.h"
+#include "../libs/search-ranking.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <algorithm>
+#include <iterator>
+
+namespace PackageIndex {
+
+    // the index itself is a PackageCatalog file
+
+    static QMutex s_build_mutex; // one nix-env dump at a time, it needs a lot of memory
+
+    QString index_dir() {
+        return LoginEnvironment::xdg_cache_home() + "/nixmanager/index";
+    }
+
+    QString channel_revision() {
+        // ~/.nix-defexpr/channels -> channels profile -> channels-N-link -> /nix/store/...-user-environment
+        // the $HOME nix-env and nix-channel run with, not necessarily the plugin's
+        const QDir defexpr(LoginEnvironment::home() + "/.nix-defexpr");
+        QStringList targets;
+        for (const QFileInfo& info : defexpr.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot, QDir::Name)) {
+            const QString target = info.canonicalFilePath();
+            if (!target.isEmpty()) targets << info.fileName() + '=' + target;
+        }
+        if (targets.isEmpty()) return QString();
+        return QString::fromLatin1(QCryptographicHash::hash(targets.join('\n').toUtf8(), QCryptographicHash::Sha1).toHex().left(16));
+    }
+
+    static QString index_path(const QString& revision) {
+        return index_dir() + QString("/packages-%1-v%2.cat").arg(revision).arg(PackageCatalog::kFormatVersion);
+    }
+
+    // nix system name of this device, e.g. "aarch64-linux"
+    static QString nix_system() {
+        return QLatin1String(ARCH) + QStringLiteral("-linux");
+    }
+
+    static QByteArray clean(QString text) {
+        text.replace(QRegExp("[\\t\\r\\n]+"), QStringLiteral(" "));
+        return text.trimmed().toUtf8();
+    }
+
+    // a package of the dump, {"name", "pname", "version", "meta": {"description", "platforms"}, ...}
+    static PackageCatalog::Package catalog_package(QString attr, const QJsonObject& package, const QString& system) {
+        const int dot = attr.indexOf('.');
+        if (dot != -1) attr = attr.mid(dot + 1); // "nixpkgs.firefox" -> "firefox", the form search results use
+
+        const QJsonObject meta = package["meta"].toObject();
+        const QJsonArray platforms = meta["platforms"].toArray();
+        bool available = platforms.isEmpty(); // no platforms listed means it builds everywhere
+        QStringList platform_names;
+        for (const auto& platform : platforms) {
+            if (platform.isString()) platform_names << platform.toString();
+            // patterns ({"kernel": ...}) can't be checked here, give them the benefit of the doubt
+            if (!platform.isString() || platform.toString() == system) available = true;
+        }
+
+        PackageCatalog::Package entry;
+        entry.attr = clean(attr);
+        entry.name = clean(package["name"].toString());
+        entry.version = clean(package["version"].toString());
+        entry.description = clean(meta["description"].toString());
+        entry.platforms = platform_names.join(' ').toUtf8();
+        entry.flags = available ? PackageCatalog::kAvailable : 0;
+        return entry;
+    }
+
+    static qint64 skip_space(const char* data, qint64 size, qint64 pos) {
+        while (pos < size && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) ++pos;
+        return pos;
+    }
+
+    // just past the closing quote of the string starting at pos, -1 if the data ends first
+    static qint64 string_end(const char* data, qint64 size, qint64 pos) {
+        for (qint64 i = pos + 1; i < size; ++i) {
+            if (data[i] == '\\') ++i;
+            else if (data[i] == '"') return i + 1;
+        }
+        return -1;
+    }
+
+    // just past the end of the object or array starting at pos, -1 if the data ends first
+    static qint64 container_end(const char* data, qint64 size, qint64 pos) {
+        int depth = 0;
+        for (qint64 i = pos; i < size; ++i) {
+            const char c = data[i];
+            if (c == '"') {
+                const qint64 end = string_end(data, size, i);
+                if (end < 0) return -1;
+                i = end - 1;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return i + 1;
+            }
+        }
+        return -1;
+    }
+
+    // Turns the nix-env dump ({"attr": {package}, ...}) into the index file. The dump is far too big
+    // for QJsonDocument, so it is mapped and walked entry by entry, only one package is parsed at a time.
+    // Returns an error message, empty on success.
+    static QString build_from_dump(const QString& dump_path, const QString& index_file, int& count) {
+        QFile dump(dump_path);
+        if (!dump.open(QIODevice::ReadOnly)) return "Cannot read " + dump_path;
+        const qint64 size = dump.size();
+        const char* data = size > 0 ? reinterpret_cast<const char*>(dump.map(0, size)) : nullptr;
+        if (!data) return QStringLiteral("nix-env printed nothing");
+
+        QVector<PackageCatalog::Package> packages;
+
+        const QString system = nix_system();
+        const QString truncated = QStringLiteral("nix-env output ends unexpectedly");
+        qint64 pos = skip_space(data, size, 0);
+        if (pos >= size || data[pos] != '{') return QStringLiteral("nix-env did not print a JSON object");
+        pos = skip_space(data, size, pos + 1);
+
+        count = 0;
+        while (pos < size && data[pos] != '}') {
+            if (data[pos] != '"') return QString("Unexpected character in nix-env output at byte %1").arg(pos);
+            const qint64 key_end = string_end(data, size, pos);
+            if (key_end < 0) return truncated;
+            const QString attr = QString::fromUtf8(data + pos + 1, static_cast<int>(key_end - pos - 2));
+
+            pos = skip_space(data, size, key_end);
+            if (pos >= size || data[pos] != ':') return QString("Expected ':' in nix-env output at byte %1").arg(pos);
+            pos = skip_space(data, size, pos + 1);
+            if (pos >= size || data[pos] != '{') return QString("Expected a package object in nix-env output at byte %1").arg(pos);
+            const qint64 value_end = container_end(data, size, pos);
+            if (value_end < 0) return truncated;
+
+            const QJsonObject package = QJsonDocument::fromJson(QByteArray::fromRawData(data + pos, static_cast<int>(value_end - pos))).object();
+            packages << catalog_package(attr, package, system);
+            ++count;
+
+            if (count % 1024 == 0 && OperationContext::interruption() != OperationContext::Interruption::None) {
+                return OperationContext::interruption_message(OperationContext::interruption());
+            }
+
+            pos = skip_space(data, size, value_end);
+            if (pos < size && data[pos] == ',') pos = skip_space(data, size, pos + 1);
+        }
+
+        QString error;
+        PackageCatalog::write(index_file, packages, error);
+        return error;
+    }
+
+    std::tuple<bool, QStringList, QStringList>
+    ensure_index(bool force) {
+        const QString revision = channel_revision();
+        if (revision.isEmpty()) {
+            return {false, QStringList(), QStringList{QStringLiteral("No channels found, add one first!")}};
+        }
+        const QString path = index_path(revision);
+        if (!force && QFile::exists(path)) return {true, QStringList{path}, QStringList()};
+
+        QMutexLocker locker(&s_build_mutex);
+        if (!force && QFile::exists(path)) return {true, QStringList{path}, QStringList()}; // built while we waited
+        if (!QDir().mkpath(index_dir())) {
+            return {false, QStringList(), QStringList{"Cannot create " + index_dir()}};
+        }
+
+        qDebug() << "PackageIndex: building index of channel revision" << revision;
+        const QString dump_path = index_dir() + "/dump-" + revision + ".json";
+        auto [dumped, output, full_error] = exec_direct_to_file(QStringLiteral("nix-env"),
+            {QStringLiteral("-qaP"), QStringLiteral("--json"), QStringLiteral("--meta")}, dump_path);
+        if (!dumped) {
+            QFile::remove(dump_path);
+            return {false, output, full_error};
+        }
+
+        int count = 0;
+        const QString error = build_from_dump(dump_path, path, count);
+        QFile::remove(dump_path);
+        if (!error.isEmpty()) {
+            full_error << error;
+            return {false, QStringList(), full_error};
+        }
+        qDebug() << "PackageIndex: indexed" << count << "packages";
+
+        // indexes (and platform caches) of older channel revisions are of no use anymore
+        const QStringList stale = QDir(index_dir()).entryList(QStringList{QStringLiteral("packages-*"), QStringLiteral("platforms-*")}, QDir::Files);
+        for (const QString& name : stale) {
+            const bool current = index_dir() + '/' + name == path || name == "platforms-" + revision + ".json";
+            if (!current) QFile::remove(index_dir() + '/' + name);
+        }
+        return {true, QStringList{path}, full_error};
+    }
+
+    // Opens the catalog of the current channel revision, building it first if build is set.
+    static bool open_current(PackageCatalog::Catalog& catalog, bool build, QStringList& full_error) {
+        QString path;
+        if (build) {
+            auto [ready, paths, errors] = ensure_index();
+            full_error << errors;
+            if (!ready) return false;
+            path = paths.first();
+        } else {
+            const QString revision = channel_revision();
+            if (revision.isEmpty() || !QFile::exists(index_path(revision))) {
+                full_error << QStringLiteral("No local package index yet, it is built by update_channels or the first local search.");
+                return false;
+            }
+            path = index_path(revision);
+        }
+        QString error;
+        if (!catalog.open(path, error)) {
+            full_error << error;
+            return false;
+        }
+        return true;
+    }
+
+    static QString package_json(const PackageCatalog::Package& package) {
+        QJsonObject object;
+        object["name"] = QString::fromUtf8(package.attr);
+        object["summary"] = QString::fromUtf8(package.description.isEmpty() ? package.name : package.description);
+        object["version"] = QString::fromUtf8(package.version);
+        object["last_updated"] = "";
+        return QJsonDocument(object).toJson(QJsonDocument::Compact);
+    }
+
+    std::tuple<bool, QStringList, QStringList>
+    search(const QString& quarry) {
+        PackageCatalog::Catalog catalog;
+        QStringList full_error;
+        if (!open_current(catalog, true, full_error)) return {false, QStringList(), full_error};
+
+        QList<QByteArray> terms;
+        for (const QString& term : quarry.toLower().split(QRegExp("\\s+"), QString::SkipEmptyParts)) terms << term.toUtf8();
+        if (terms.isEmpty()) return {false, QStringList(), QStringList{QStringLiteral("No packages found!")}};
+
+        // narrow down with the trigram postings of every term long enough to have one,
+        // a lone short term ("go", "jq") is looked up as an attribute prefix instead
+        QVector<quint32> candidates;
+        bool narrowed = false;
+        for (const QByteArray& term : terms) {
+            if (term.size() < 3) continue;
+            const QVector<quint32> matches = catalog.candidates(term);
+            if (!narrowed) {
+                candidates = matches;
+                narrowed = true;
+            } else {
+                QVector<quint32> both;
+                std::set_intersection(candidates.constBegin(), candidates.constEnd(), matches.constBegin(), matches.constEnd(), std::back_inserter(both));
+                candidates.swap(both);
+            }
+        }
+        if (!narrowed) {
+            candidates = terms.size() == 1 ? catalog.with_prefix(terms.first()) : catalog.candidates(QByteArray());
+        }
+
+        // rank every real match, only the best kMaxResults are kept (and copied out of the catalog twice)
+        const SearchRanking::Query query(quarry);
+        SearchRanking::TopK best(kMaxResults);
+        for (quint32 index : candidates) {
+            if (!(catalog.flags(index) & PackageCatalog::kAvailable)) continue; // not available on this device
+            if (!catalog.contains(index, terms)) continue; // trigrams matched, the term itself doesn't
+            const PackageCatalog::Package package = catalog.package(index);
+            best.offer(SearchRanking::score(query, QString::fromUtf8(package.attr), QString::fromUtf8(package.description)), int(index));
+        }
+        QStringList result;
+        for (int index : best.take()) result << package_json(catalog.package(quint32(index)));
+
+        // nothing matched exactly, maybe a typo: packages sharing most of the term's trigrams
+        if (result.isEmpty() && terms.size() == 1) {
+            for (quint32 index : catalog.fuzzy(terms.first(), kFuzzyShare, kMaxResults)) {
+                if (catalog.flags(index) & PackageCatalog::kAvailable) result << package_json(catalog.package(index));
+            }
+            if (!result.isEmpty()) full_error << QStringLiteral("No exact matches, showing similar packages.");
+        }
+
+        if (result.isEmpty()) {
+            return {false, result, QStringList{QStringLiteral("No packages found!")}};
+        }
+        return {true, result, full_error};
+    }
+
+    QVector<int> availability(const QStringList& attrs) {
+        QVector<int> result(attrs.size(), -1);
+        PackageCatalog::Catalog catalog;
+        QStringList full_error;
+        if (!open_current(catalog, false, full_error)) return result;
+        for (int i = 0; i < attrs.size(); ++i) {
+            const qint64 index = catalog.find(attrs.at(i).toUtf8());
+            if (index >= 0) result[i] = (catalog.flags(quint32(index)) & PackageCatalog::kAvailable) ? 1 : 0;
+        }
+        return result;
+    }
+
+    std::tuple<bool, QStringList, QStringList>
+    describe(const QStringList& packages) {
+        PackageCatalog::Catalog catalog;
+        QStringList full_error;
+        if (!open_current(catalog, false, full_error)) return {false, QStringList(), full_error};
+
+        QStringList result;
+        for (const QString& package : packages) {
+            const qint64 index = catalog.find(PackageSet::attribute(package).toUtf8()); // home.nix writes pkgs.<attr>
+
+            QJsonObject object;
+            object["name"] = package;
+            object["found"] = index >= 0;
+            if (index >= 0) {
+                const PackageCatalog::Package entry = catalog.package(quint32(index));
+                object["summary"] = QString::fromUtf8(entry.description);
+                object["version"] = QString::fromUtf8(entry.version);
+                object["available"] = bool(entry.flags & PackageCatalog::kAvailable);
+            }
+            result << QJsonDocument(object).toJson(QJsonDocument::Compact);
+        }
+        return {true, result, full_error};
+    }
+}
@@ -0,0 +1,120 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef PACKAGE_INDEX_H
+#define PACKAGE_INDEX_H
+
+#include "../libs/openprocess.h"
+
+#include <tuple>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Offline index of the packages in the user's channels, used by local search.
+ *
+ * `nix-env -qaP <term>` evaluates all of nixpkgs for every single search, which takes
+ * minutes on a phone and often gets the process OOM-killed. Instead the channels are
+ * dumped once with `nix-env -qaP --json --meta` and the attribute path, name, description
+ * and platforms of every package are kept in a memory-mapped PackageCatalog under
+ * $XDG_CACHE_HOME/nixmanager/index. One index exists per channel revision, a new one is
+ * built after update_channels (or by the first search after the channels changed).
+ */
+namespace PackageIndex {
+
+    /**
+    * @brief A local search returns at most this many packages.
+    */
+    const int kMaxResults = 200;
+
+    /**
+    * @brief A single word search without exact matches falls back to packages sharing this much of its trigrams.
+    */
+    const double kFuzzyShare = 0.6;
+
+    /**
+    * @brief Directory of the index files.
+    */
+    QString index_dir();
+
+    /**
+    * @brief Identifies the current channel revision, empty if there are no channels.
+    *
+    * Derived from the store paths ~/.nix-defexpr's channel links point to, so it changes
+    * whenever nix-channel --update, --add or --remove produced a new channels generation.
+    */
+    QString channel_revision();
+
+    /**
+    * @brief Builds the index of the current channel revision if it doesn't exist yet.
+    *
+    * Only one thread builds at a time, others wait and then use its index.
+    *
+    * @param force Rebuild even if an index of this revision exists.
+    * @return A tuple containing:
+    * - bool success: True if an index of the current revision is available.
+    * - QStringList output: Path of the index file.
+    * - QStringList full_error: nix-env's stderr and parse errors.
+    */
+    std::tuple<bool, QStringList, QStringList>
+    ensure_index(bool force = false);
+
+    /**
+    * @brief Searches the index of the current channel revision, building it first if needed.
+    *
+    * Every whitespace separated word of the quarry has to appear (case-insensitively) in the
+    * attribute path, name or description, candidates come from the catalog's trigram postings
+    * (or its sorted name table for a single short word). A single word without exact matches
+    * returns the most similar packages instead. Packages not available on this device's
+    * platform are left out, the kMaxResults most relevant (see SearchRanking) are returned
+    * best first.
+    *
+    * @param quarry The words to search for.
+    * @return A tuple containing:
+    * - bool success: True if the index could be searched and something matched.
+    * - QStringList results: compact JSON objects {"name", "summary", "version", "last_updated"}, "name" is the
+    *   attribute path without the channel (e.g. "firefox"), "summary" the description (the package name if it has
+    *   none), "last_updated" is always empty (the channel has no such date).
+    * - QStringList full_error: error messages.
+    */
+    std::tuple<bool, QStringList, QStringList>
+    search(const QString& quarry);
+
+    /**
+    * @brief Platform availability of packages according to the index, without building it.
+    * @param attrs Attribute paths, e.g. "firefox".
+    * @return Per attribute: 1 available on this device, 0 not available, -1 unknown (not indexed).
+    */
+    QVector<int> availability(const QStringList& attrs);
+
+    /**
+    * @brief Looks up installed packages (as written in home.nix, e.g. "pkgs.firefox") in the index, without building it.
+    * @return A tuple containing:
+    * - bool success: False if there is no index of the current channel revision.
+    * - QStringList results: JSON (like) objects {"name", "found", "summary", "version", "available"} in the given order,
+    *   only name and found for packages that aren't in the index.
+    * - QStringList full_error: error messages.
+    */
+    std::tuple<bool, QStringList, QStringList>
+    describe(const QStringList& packages);
+}
+
+#endif // PACKAGE_INDEX_H
@@ -0,0 +1,148 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "platform-check.h"
+#include "package-index.h"
+#include "../libs/login-env.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+namespace PlatformCheck {
+
+    // names come in as JSON through --argstr, nothing user supplied ends up in the expression itself
+    static const char* kExpression = R"nix(
+{ names, system, nixpkgsPath }:
+let
+  pkgs = import (if nixpkgsPath == "" then <nixpkgs> else /. + nixpkgsPath) {};
+  lib = pkgs.lib;
+  platform = lib.systems.elaborate system;
+  check = name:
+    let found = builtins.tryEval (lib.attrByPath (lib.splitString "." name) null pkgs);
+    in if !found.success || found.value == null || !(lib.isDerivation found.value) then null
+       else let available = builtins.tryEval (lib.meta.availableOn platform found.value);
+            in if available.success then available.value else null;
+in builtins.listToAttrs (map (name: { inherit name; value = check name; }) (builtins.fromJSON names))
+)nix";
+
+    static QMutex s_mutex;           // guards the cache
+    static QString s_revision;       // revision s_cache belongs to
+    static QHash<QString, int> s_cache;
+
+    static QString cache_file(const QString& revision) {
+        return PackageIndex::index_dir() + "/platforms-" + revision + ".json";
+    }
+
+    // switches the in-memory cache to a channel revision, loading what earlier runs evaluated, s_mutex must be held
+    static void load_locked(const QString& revision) {
+        if (s_revision == revision) return;
+        s_revision = revision;
+        s_cache.clear();
+        QFile file(cache_file(revision));
+        if (!file.open(QIODevice::ReadOnly)) return;
+        const QJsonObject saved = QJsonDocument::fromJson(file.readAll()).object();
+        for (auto it = saved.constBegin(); it != saved.constEnd(); ++it) s_cache.insert(it.key(), it.value().toInt(-1));
+    }
+
+    // s_mutex must be held
+    static void save_locked() {
+        if (!QDir().mkpath(PackageIndex::index_dir())) return;
+        QJsonObject saved;
+        for (auto it = s_cache.constBegin(); it != s_cache.constEnd(); ++it) saved.insert(it.key(), it.value());
+        QSaveFile file(cache_file(s_revision));
+        if (!file.open(QIODevice::WriteOnly)) return;
+        file.write(QJsonDocument(saved).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+
+    // one nix-instantiate call for all names, false if it failed as a whole
+    static bool evaluate(const QStringList& names, QHash<QString, int>& answers) {
+        const QString defexpr_nixpkgs = LoginEnvironment::home() + "/.nix-defexpr/channels/nixpkgs";
+        const QString nixpkgs_path = QFile::exists(defexpr_nixpkgs) ? defexpr_nixpkgs : QString(); // the channel nix-env searches
+        const QString names_json = QString::fromUtf8(QJsonDocument(QJsonArray::fromStringList(names)).toJson(QJsonDocument::Compact));
+
+        auto [success, output, full_error] = exec_direct(QStringLiteral("nix-instantiate"), {
+            QStringLiteral("--eval"), QStringLiteral("--strict"), QStringLiteral("--json"),
+            QStringLiteral("--expr"), QString::fromUtf8(kExpression),
+            QStringLiteral("--argstr"), QStringLiteral("names"), names_json,
+            QStringLiteral("--argstr"), QStringLiteral("system"), QLatin1String(ARCH) + QStringLiteral("-linux"),
+            QStringLiteral("--argstr"), QStringLiteral("nixpkgsPath"), nixpkgs_path});
+        if (!success) {
+            qDebug() << "PlatformCheck: nix-instantiate failed:" << full_error.join('\n');
+            return false;
+        }
+
+        QJsonParseError parse_error;
+        const QJsonDocument doc = QJsonDocument::fromJson(output.join('\n').toUtf8(), &parse_error);
+        if (parse_error.error != QJsonParseError::NoError || !doc.isObject()) {
+            qDebug() << "PlatformCheck: unexpected nix-instantiate output:" << parse_error.errorString();
+            return false;
+        }
+        const QJsonObject result = doc.object();
+        for (const QString& name : names) {
+            const QJsonValue value = result.value(name);
+            answers.insert(name, value.isBool() ? (value.toBool() ? 1 : 0) : -1);
+        }
+        return true;
+    }
+
+    QVector<int> availability(const QStringList& attrs) {
+        QVector<int> result(attrs.size(), -1);
+        const QString revision = PackageIndex::channel_revision();
+        if (revision.isEmpty()) return result; // no channels, nothing to evaluate against
+
+        QStringList missing;
+        {
+            QMutexLocker locker(&s_mutex);
+            load_locked(revision);
+            for (int i = 0; i < attrs.size(); ++i) {
+                auto it = s_cache.constFind(attrs.at(i));
+                if (it != s_cache.constEnd()) result[i] = it.value();
+                else if (!missing.contains(attrs.at(i))) missing << attrs.at(i);
+            }
+        }
+        if (missing.isEmpty()) return result;
+
+        // evaluated without holding the lock, it can take a few seconds
+        QHash<QString, int> answers;
+        for (int start = 0; start < missing.size(); start += kMaxBatch) {
+            if (!evaluate(missing.mid(start, kMaxBatch), answers)) break;
+        }
+        if (answers.isEmpty()) return result;
+
+        QMutexLocker locker(&s_mutex);
+        if (s_revision == revision) {
+            for (auto it = answers.constBegin(); it != answers.constEnd(); ++it) s_cache.insert(it.key(), it.value());
+            save_locked();
+        }
+        for (int i = 0; i < attrs.size(); ++i) {
+            if (answers.contains(attrs.at(i))) result[i] = answers.value(attrs.at(i));
+        }
+        return result;
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#ifndef PLATFORM_CHECK_H
+#define PLATFORM_CHECK_H
+
+#include "../libs/openprocess.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Answers "is this package available on this device" from nixpkgs itself.
+ *
+ * Evaluates lib.meta.availableOn (meta.platforms and meta.badPlatforms) for a whole
+ * list of attributes in a single `nix-instantiate --eval --strict --json` call, instead
+ * of asking a remote API about every package. Answers are cached per channel revision
+ * (see PackageIndex::channel_revision) in memory and in
+ * $XDG_CACHE_HOME/nixmanager/index/platforms-<revision>.json.
+ */
+namespace PlatformCheck {
+
+    /**
+    * @brief Attributes evaluated per nix-instantiate call at most, larger lists take several calls.
+    */
+    const int kMaxBatch = 200;
+
+    /**
+    * @brief Platform availability of attributes, evaluating the ones that aren't cached yet.
+    * @param attrs Attribute paths, e.g. "firefox" or "python3Packages.requests".
+    * @return Per attribute: 1 available on this device, 0 not available, -1 unknown
+    * (no such attribute, it fails to evaluate, or nix-instantiate failed).
+    */
+    QVector<int> availability(const QStringList& attrs);
+}
+
+#endif // PLATFORM_CHECK_H
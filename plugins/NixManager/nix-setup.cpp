@@ -20,6 +20,7 @@
  */
 
 #include "nix-setup.h"
+#include "nix-layer/backup-config.h"
 
 namespace SetupNixHomeManager {
     std::tuple<bool, QStringList, QStringList>
@@ -196,46 +197,28 @@ namespace DetectNixHomeManager{
     std::tuple<bool, QStringList, QStringList>
     detect_nix_home_manager() {
         QStringList full_output;
-        QStringList output;
         QStringList full_error;
-        QStringList error;
-        bool success = true;
-        QString command = QStringLiteral(R"(/bin/bash <<'EOF'
-source $HOME/.profile
-check_cmd() {
-    command -v "$1" > /dev/null 2>&1
-}
-if check_cmd home-manager; then
-    exit 0
-else
-    exit 1
-fi
-EOF)");
-        std::tie(success, output, error) = exec_bash(command); // we don't care about output here
-        full_error.append(error);
-        full_output.append(output);
-        if (!success) {
-            return {false, full_output, full_error};
-        }
-
-        std::tie(success, output, error) = exec_bash(QStringLiteral("echo $HOME"));
-        full_error.append(error);
-        full_output.append(output);
-        if (!success) {
+        // home-manager has to be on the PATH a login shell would see, the cached snapshot knows that without starting one.
+        const QString home_manager = LoginEnvironment::find_executable(QStringLiteral("home-manager"));
+        if (home_manager.isEmpty()) {
+            full_error << QStringLiteral("'home-manager' was not found in PATH");
             return {false, full_output, full_error};
         }
 
-        // Join output lines into a single QString (home directory)
-        QString output_string = output.join(QString());
+        // home directory of the login environment
+        QString output_string = LoginEnvironment::home();
+        full_output << output_string;
 
         // Proceed to directory/file checks to validate integrity.
         // Use QFileInfo and QDir (Qt) instead of std::filesystem for consistency.
         #include <QFileInfo>
         #include <QDir>
 
-        QFileInfo fi_home_manager(output_string + "/.config/home-manager/home.nix");
-        if (!fi_home_manager.isFile()) {
-            full_error << QStringLiteral("(%1) is invalid or not a regular file").arg(fi_home_manager.filePath());
+        // the same locations the package operations accept, the legacy ~/.config/nixpkgs/home.nix included
+        if (get_config_path().isEmpty()) {
+            full_error << QStringLiteral("(%1) and (%2) are invalid or not regular files")
+                              .arg(LoginEnvironment::xdg_config_home() + "/home-manager/home.nix",
+                                   LoginEnvironment::xdg_config_home() + "/nixpkgs/home.nix");
             return {false, full_output, full_error};
         }
 
@@ -257,7 +240,7 @@ EOF)");
             return {false, full_output, full_error};
         }
 
-        QDir d_local_state_nix(output_string + "/.local/state/nix");
+        QDir d_local_state_nix(LoginEnvironment::xdg_state_home() + "/nix");
         if (!d_local_state_nix.exists() || !d_local_state_nix.isReadable()) {
             full_error << QStringLiteral("(%1) is invalid or not a directory").arg(d_local_state_nix.absolutePath());
             return {false, full_output, full_error};
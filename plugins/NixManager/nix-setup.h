@@ -142,14 +142,14 @@ namespace DetectNixHomeManager {
     /**
     * @brief Detects and validates a Nix + Home Manager installation for the current user.
     *
-    * Runs a shell check for the `home-manager` command, obtains $HOME, and verifies
-    * presence and types of critical files/directories:
-    *  - $HOME/.config/home-manager/home.nix (regular file)
+    * Looks `home-manager` up in the PATH of the cached login environment, obtains
+    * $HOME from it, and verifies presence and types of critical files/directories:
+    *  - $XDG_CONFIG_HOME/home-manager/home.nix (regular file)
     *  - $HOME/.local/share/home-manager (directory)
     *  - $HOME/.nix-profile (directory)
     *  - $HOME/.nix-defexpr (directory)
     *  - $HOME/.nix-channels (regular file)
-    *  - $HOME/.local/state/nix (directory)
+    *  - $XDG_STATE_HOME/nix (directory)
     *
     * Aggregates shell output and errors, returning early on any failure with
     * accumulated output and error messages.
@@ -0,0 +1,346 @@
+// scheduler.cpp
+#include "scheduler.h"
+#include "libs/operation-context.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+// The phone has few cores and most of the time is spent waiting on nix anyway,
+// a couple of workers is enough to keep reads responsive next to a long switch.
+static const int kMinWorkers = 2;
+static const int kMaxWorkers = 4;
+
+Scheduler::Scheduler(QObject *parent) : QObject(parent)
+{
+    const int worker_count = qBound(kMinWorkers, QThread::idealThreadCount(), kMaxWorkers);
+    for (int i = 0; i < worker_count; ++i) {
+        QThread* thread = new QThread(this);
+        Worker* worker = new Worker;
+        worker->moveToThread(thread);
+
+        connect(worker, &Worker::operation_finished,
+                this, &Scheduler::on_worker_finished);
+        connect(worker, &Worker::operation_progress,
+                this, &Scheduler::on_worker_progress);
+        connect(worker, &Worker::operation_partial,
+                this, &Scheduler::on_worker_partial);
+        // when the thread finishes, delete the worker object (and its thread's shell sessions with it).
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        thread->start();
+        m_threads << thread;
+        m_idle << worker;
+    }
+    qDebug() << "Scheduler: started" << worker_count << "workers";
+}
+
+Scheduler::~Scheduler()
+{
+    // don't keep the app alive for a build nobody will see the end of
+    for (const Job& job : m_running) {
+        OperationContext::cancel_request(job.request_id);
+    }
+    for (QThread* thread : m_threads) {
+        thread->quit();
+    }
+    for (QThread* thread : m_threads) {
+        thread->wait();
+    }
+}
+
+Scheduler::Resources Scheduler::resources_for(const QString& operation)
+{
+    // Everything reads Installation, so installing/uninstalling waits for (and blocks) all other work.
+    static const QHash<QString, Resources> table = {
+        {"hm_version",                 {Installation, 0}},
+        {"read_packages",              {Installation | ConfigFile, 0}},
+        {"read_package_files",         {Installation | ConfigFile, 0}},
+        {"describe_packages",          {Channels, 0}},
+        {"hm_switch",                  {Installation | ConfigFile | Channels | Network, Generations}},
+        {"add_packages",               {Installation | Channels | Network, ConfigFile | Generations}},
+        {"delete_packages",            {Installation | Channels | Network, ConfigFile | Generations}},
+        {"apply_changes",              {Installation | Channels | Network, ConfigFile | Generations}},
+        {"preview_changes",            {ConfigFile, 0}},
+        {"search_packages",            {Installation | Channels | Network, 0}},
+        {"update_channels",            {Installation | Network, Channels}},
+        {"list_channels",              {Installation | Channels, 0}},
+        {"add_channel",                {Installation, Channels}},
+        {"remove_channel",             {Installation, Channels}},
+        {"list_generations",           {Installation | Generations, 0}},
+        {"switch_generation",          {Installation, Generations}},
+        {"delete_generation",          {Installation, Generations}},
+        {"delete_old_generations",     {Installation, Generations}},
+        {"hm_expire_generations",      {Installation, Generations}},
+        {"hm_list_generations",        {Installation | Generations, 0}},
+        {"detect_nix_home_manager",    {Installation | ConfigFile, 0}},
+        {"install_nix_home_manager",   {Network, Installation | ConfigFile | Channels | Generations}},
+        {"uninstall_nix_home_manager", {0, Installation | ConfigFile | Channels | Generations}},
+    };
+    const quint32 all = ConfigFile | Channels | Generations | Network | Installation;
+    return table.value(operation, Resources{0, all});
+}
+
+Scheduler::Priority Scheduler::priority_for(const QString& operation, const QString& priorityHint)
+{
+    if (priorityHint == QLatin1String("interactive")) return Interactive;
+    if (priorityHint == QLatin1String("mutation")) return Mutation;
+    if (priorityHint == QLatin1String("background")) return Background;
+
+    if (operation == QLatin1String("update_channels")
+        || operation == QLatin1String("delete_old_generations")
+        || operation == QLatin1String("hm_expire_generations")) {
+        return Background;
+    }
+    return resources_for(operation).writes == 0 ? Interactive : Mutation;
+}
+
+static QString priority_name(int priority)
+{
+    switch (priority) {
+    case Scheduler::Interactive: return QStringLiteral("interactive");
+    case Scheduler::Background: return QStringLiteral("background");
+    default: return QStringLiteral("mutation");
+    }
+}
+
+qint64 Scheduler::effective_priority(const Job& job)
+{
+    // aging: every kAgingStepMs spent waiting is worth one class
+    return static_cast<qint64>(job.priority) * kAgingStepMs + job.queued.elapsed();
+}
+
+bool Scheduler::conflicts(const Resources& a, const Resources& b)
+{
+    return (a.writes & (b.reads | b.writes)) || (b.writes & (a.reads | a.writes));
+}
+
+void Scheduler::submit(const QVariant& requestId, const QString& operation, const Launcher& launch,
+                       const QString& coalesceKey, const QString& priorityHint)
+{
+    const Resources resources = resources_for(operation);
+    const Priority priority = priority_for(operation, priorityHint);
+    if (!coalesceKey.isEmpty() && resources.writes == 0) {
+        if (Job* same = find_job(coalesceKey)) {
+            qDebug() << "Scheduler:" << requestId << "joins" << same->request_id << "(" << coalesceKey << ")";
+            same->joined << requestId;
+            same->priority = qMax(same->priority, priority); // a queued execution is as urgent as its most urgent caller
+            dispatch();
+            return;
+        }
+    }
+    Job job{requestId, operation, resources, launch, resources.writes == 0 ? coalesceKey : QString()};
+    job.priority = priority;
+    job.queued.start();
+    m_pending.append(job);
+    dispatch();
+}
+
+Scheduler::Job* Scheduler::find_job(const QString& coalesceKey)
+{
+    auto usable = [&](const Job& job) {
+        if (job.coalesce_key != coalesceKey) return false;
+        // an execution that is being cancelled would hand the newcomer a cancelled result
+        OperationContext::CancelToken token = OperationContext::find_request(job.request_id);
+        return !token || token->reason() == OperationContext::Interruption::None;
+    };
+    // a write queued after the candidate would make its result stale for the newcomer
+    auto written_after = [&](const Job& job, int first_pending) {
+        for (int i = first_pending; i < m_pending.size(); ++i) {
+            if (conflicts(job.resources, m_pending.at(i).resources)) return true;
+        }
+        return false;
+    };
+
+    for (Job& job : m_running) {
+        if (usable(job) && !written_after(job, 0)) return &job;
+    }
+    for (int i = 0; i < m_pending.size(); ++i) {
+        if (usable(m_pending.at(i)) && !written_after(m_pending.at(i), i + 1)) return &m_pending[i];
+    }
+    return nullptr;
+}
+
+QVariantList Scheduler::receivers(const Job& job) const
+{
+    QVariantList ids = job.joined;
+    if (!job.owner_left) ids.prepend(job.request_id);
+    return ids;
+}
+
+void Scheduler::answer_cancelled(const QVariant& requestId, const QString& operation, OperationContext::Interruption reason)
+{
+    OperationContext::unregister_request(requestId);
+    emit operation_finished(Worker::finalize_result(QString(), reason, QString()),
+                            requestId, operation);
+}
+
+bool Scheduler::cancel(const QVariant& requestId, OperationContext::Interruption reason)
+{
+    auto detach = [&](Job& job) -> bool {
+        if (job.request_id == requestId && job.owner_left) {
+            return true; // already answered, the execution belongs to the joined requests now
+        }
+        if (job.joined.removeOne(requestId)) {
+            answer_cancelled(requestId, job.operation, reason);
+        } else if (job.request_id == requestId && !job.owner_left && !job.joined.isEmpty()) {
+            // others still wait for this execution, only this request leaves it
+            job.owner_left = true;
+            emit operation_finished(Worker::finalize_result(QString(), reason, QString()),
+                                    requestId, job.operation);
+        } else {
+            return false;
+        }
+        if (job.owner_left && job.joined.isEmpty()) {
+            OperationContext::cancel_request(job.request_id, reason); // nobody is left waiting
+        }
+        return true;
+    };
+    for (Job& job : m_running) {
+        if (detach(job)) return true;
+    }
+    for (int i = 0; i < m_pending.size(); ++i) {
+        Job& job = m_pending[i];
+        if (job.request_id == requestId && !job.owner_left && job.joined.isEmpty()) {
+            // nobody waits for it, it doesn't have to hold its place in the queue until a worker is free
+            Job dropped = m_pending.takeAt(i);
+            answer_cancelled(dropped.request_id, dropped.operation, reason);
+            dispatch();
+            return true;
+        }
+        if (detach(job)) {
+            if (job.owner_left && job.joined.isEmpty()) {
+                // the last joined request left too, everyone was answered already
+                Job dropped = m_pending.takeAt(i);
+                OperationContext::unregister_request(dropped.request_id);
+                dispatch();
+            }
+            return true;
+        }
+    }
+    return OperationContext::cancel_request(requestId, reason);
+}
+
+bool Scheduler::startable(int index) const
+{
+    const Job& job = m_pending.at(index);
+    for (const Job& running : m_running) {
+        if (conflicts(job.resources, running.resources)) return false;
+    }
+    // an earlier conflicting request goes first, that keeps mutations in order. Only a read
+    // that is more urgent (after aging) may pass it and see the state from before that change.
+    for (int j = 0; j < index; ++j) {
+        const Job& earlier = m_pending.at(j);
+        if (!conflicts(job.resources, earlier.resources)) continue;
+        if (job.resources.writes != 0 || effective_priority(job) <= effective_priority(earlier)) return false;
+    }
+    // background work doesn't take the last free worker before it has aged, that one stays reserved for the UI
+    if (job.priority == Background && m_idle.size() == 1 && m_threads.size() > 1
+        && effective_priority(job) < static_cast<qint64>(Interactive) * kAgingStepMs) {
+        return false;
+    }
+    return true;
+}
+
+void Scheduler::dispatch()
+{
+    while (!m_idle.isEmpty()) {
+        // the startable request with the highest (aged) priority, the earlier one on ties
+        int best = -1;
+        for (int i = 0; i < m_pending.size(); ++i) {
+            if (!startable(i)) continue;
+            if (best == -1 || effective_priority(m_pending.at(i)) > effective_priority(m_pending.at(best))) best = i;
+        }
+        if (best == -1) break;
+
+        Worker* worker = m_idle.takeFirst();
+        Job started = m_pending.takeAt(best);
+
+        const qint64 waited = started.queued.elapsed();
+        ClassStats& stats = m_stats[started.priority];
+        stats.started++;
+        stats.total_wait_ms += waited;
+        stats.max_wait_ms = qMax(stats.max_wait_ms, waited);
+
+        qDebug() << "Scheduler: starting" << started.operation << "for" << started.request_id
+                 << "(" << priority_name(started.priority) << ", waited" << waited << "ms,"
+                 << m_running.size() + 1 << "running," << m_pending.size() << "waiting)";
+        started.launch(worker);
+        m_running.insert(worker, started);
+    }
+}
+
+QString Scheduler::stats_json() const
+{
+    QJsonObject classes;
+    for (int priority = Background; priority <= Interactive; ++priority) {
+        int running = 0;
+        int waiting = 0;
+        qint64 oldest_wait = 0;
+        for (const Job& job : m_running) {
+            if (job.priority == priority) running++;
+        }
+        for (const Job& job : m_pending) {
+            if (job.priority != priority) continue;
+            waiting++;
+            oldest_wait = qMax(oldest_wait, job.queued.elapsed());
+        }
+        const ClassStats& stats = m_stats[priority];
+
+        QJsonObject classObj;
+        classObj["running"] = running;
+        classObj["waiting"] = waiting;
+        classObj["oldest_wait_ms"] = static_cast<double>(oldest_wait);
+        classObj["started"] = stats.started;
+        classObj["avg_wait_ms"] = stats.started ? static_cast<double>(stats.total_wait_ms / stats.started) : 0.0;
+        classObj["max_wait_ms"] = static_cast<double>(stats.max_wait_ms);
+        classes[priority_name(priority)] = classObj;
+    }
+
+    QJsonObject statsObj;
+    statsObj["workers"] = m_threads.size();
+    statsObj["running"] = m_running.size();
+    statsObj["waiting"] = m_pending.size();
+    statsObj["classes"] = classes;
+    return QJsonDocument(statsObj).toJson(QJsonDocument::Compact);
+}
+
+void Scheduler::on_worker_finished(const QString& resultJson, const QVariant& requestId, const QString& operation)
+{
+    Worker* worker = qobject_cast<Worker*>(sender());
+    if (!worker || !m_running.contains(worker)) {
+        emit operation_finished(resultJson, requestId, operation);
+        return;
+    }
+
+    Job job = m_running.take(worker);
+    m_idle << worker;
+    for (const QVariant& receiver : receivers(job)) {
+        if (receiver != job.request_id) OperationContext::unregister_request(receiver);
+        emit operation_finished(resultJson, receiver, operation);
+    }
+    dispatch();
+}
+
+void Scheduler::on_worker_progress(const QVariant& requestId, const QString& operation, const QString& progressJson)
+{
+    Worker* worker = qobject_cast<Worker*>(sender());
+    if (!worker || !m_running.contains(worker)) {
+        emit operation_progress(requestId, operation, progressJson);
+        return;
+    }
+    for (const QVariant& receiver : receivers(m_running.constFind(worker).value())) {
+        emit operation_progress(receiver, operation, progressJson);
+    }
+}
+
+void Scheduler::on_worker_partial(const QVariant& requestId, const QString& operation, const QString& partialJson)
+{
+    Worker* worker = qobject_cast<Worker*>(sender());
+    if (!worker || !m_running.contains(worker)) {
+        emit operation_partial(requestId, operation, partialJson);
+        return;
+    }
+    for (const QVariant& receiver : receivers(m_running.constFind(worker).value())) {
+        emit operation_partial(receiver, operation, partialJson);
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QThread>
+#include <QList>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <functional>
+#include "worker.h"
+
+/**
+ * @brief The Scheduler class runs requests on a pool of Worker threads.
+ *
+ * Every operation declares which shared resources it reads and which it writes
+ * (see resources_for()). A request starts as soon as a worker is free and no
+ * running request conflicts with it, so read-only operations run in parallel with
+ * each other and next to long mutations. Conflicting requests never overtake each
+ * other, they start one at a time in submission order.
+ *
+ * Lives in the main thread, owned by the Controller.
+ */
+class Scheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Things operations touch, used as bit flags.
+     */
+    enum Resource {
+        ConfigFile   = 1 << 0, ///< home.nix and its backup.
+        Channels     = 1 << 1, ///< nix-channel list and the channel store paths.
+        Generations  = 1 << 2, ///< nix-env / home-manager profile generations.
+        Network      = 1 << 3, ///< remote APIs and binary caches.
+        Installation = 1 << 4  ///< nix and home-manager themselves.
+    };
+
+    /**
+     * @brief Priority classes, higher starts first.
+     */
+    enum Priority {
+        Background = 0,  ///< Maintenance nobody waits for (update_channels, garbage collection...).
+        Mutation = 1,    ///< Changes the user asked for (hm_switch, add_packages...).
+        Interactive = 2  ///< Reads the UI waits on (search, lists, versions).
+    };
+
+    /**
+     * @brief Waiting this long raises a request by one priority class.
+     */
+    static const int kAgingStepMs = 15000;
+
+    /**
+     * @brief The resources one operation reads and writes (bit masks of Resource).
+     */
+    struct Resources {
+        quint32 reads;
+        quint32 writes;
+    };
+
+    /**
+     * @brief Starts a request on the given worker, usually a QMetaObject::invokeMethod with the request's arguments.
+     */
+    using Launcher = std::function<void(Worker* worker)>;
+
+    explicit Scheduler(QObject *parent = nullptr);
+    ~Scheduler();
+
+    /**
+     * @brief Queues a request and starts it as soon as its resources allow.
+     * @param requestId Original request identifier.
+     * @param operation The operation name (e.g. "hm_switch"), selects the declared resources.
+     * @param launch Starts the request on the worker it is given.
+     * @param coalesceKey Identifies identical requests, empty to always run. Ignored for operations that write.
+     * @param priorityHint "interactive", "mutation" or "background", anything else uses the operation's default class.
+     */
+    void submit(const QVariant& requestId, const QString& operation, const Launcher& launch,
+                const QString& coalesceKey = QString(), const QString& priorityHint = QString());
+
+    /**
+     * @brief Cancels a queued or running request.
+     *
+     * A request that shares its execution with others (see coalesceKey) is answered
+     * as cancelled right away, the execution only stops once nobody waits for it.
+     * A queued request nobody else waits for is answered and dropped right away.
+     * @param reason Reported in the result, Cancelled or Superseded.
+     * @return True if the request was still queued or running.
+     */
+    bool cancel(const QVariant& requestId,
+                OperationContext::Interruption reason = OperationContext::Interruption::Cancelled);
+
+    /**
+     * @brief Queue diagnostics as JSON.
+     *
+     * {"workers", "running", "waiting", "classes": {"interactive"|"mutation"|"background":
+     * {"running", "waiting", "oldest_wait_ms", "started", "avg_wait_ms", "max_wait_ms"}}}
+     * where started/avg_wait_ms/max_wait_ms cover every request started so far.
+     */
+    QString stats_json() const;
+
+    /**
+     * @brief Declared resources of an operation, unknown operations conflict with everything.
+     */
+    static Resources resources_for(const QString& operation);
+
+    /**
+     * @brief Priority class for a QML hint, falling back to the operation's default class.
+     */
+    static Priority priority_for(const QString& operation, const QString& priorityHint);
+
+signals:
+    /**
+     * @brief Emitted in the main thread when a request finished, see Worker::operation_finished.
+     */
+    void operation_finished(const QString& resultJson, const QVariant& requestId, const QString& operation);
+
+    /**
+     * @brief Forwarded Worker::operation_progress of every worker.
+     */
+    void operation_progress(const QVariant& requestId, const QString& operation, const QString& progressJson);
+
+    /**
+     * @brief Forwarded Worker::operation_partial of every worker.
+     */
+    void operation_partial(const QVariant& requestId, const QString& operation, const QString& partialJson);
+
+private slots:
+    void on_worker_finished(const QString& resultJson, const QVariant& requestId, const QString& operation);
+    void on_worker_progress(const QVariant& requestId, const QString& operation, const QString& progressJson);
+    void on_worker_partial(const QVariant& requestId, const QString& operation, const QString& partialJson);
+
+private:
+    struct Job {
+        QVariant request_id;     // the request the worker runs under (owns the cancel state)
+        QString operation;
+        Resources resources;
+        Launcher launch;
+        QString coalesce_key;
+        QVariantList joined;     // identical requests waiting for the same result
+        bool owner_left = false; // request_id was cancelled while others still wait
+        Priority priority = Mutation;
+        QElapsedTimer queued;
+    };
+
+    struct ClassStats {
+        int started = 0;
+        qint64 total_wait_ms = 0;
+        qint64 max_wait_ms = 0;
+    };
+
+    static bool conflicts(const Resources& a, const Resources& b);
+    static qint64 effective_priority(const Job& job);
+    bool startable(int index) const;
+    void dispatch();
+    Job* find_job(const QString& coalesceKey);
+    QVariantList receivers(const Job& job) const;
+    void answer_cancelled(const QVariant& requestId, const QString& operation, OperationContext::Interruption reason);
+
+    QVector<QThread*> m_threads;
+    QList<Worker*> m_idle;
+    QHash<Worker*, Job> m_running;
+    QList<Job> m_pending;
+    ClassStats m_stats[Interactive + 1];
+};
+
+#endif // SCHEDULER_H
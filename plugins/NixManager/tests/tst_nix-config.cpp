@@ -0,0 +1,331 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+#include "../nix-layer/nix-config.h"
+
+#include <QDir>
+#include <QTemporaryDir>
+#include <QtTest>
+
+// home.nix edited the way add/delete_packages would, or why the edit was refused
+static QByteArray edited(const QByteArray& text, const QStringList& to_add, const QStringList& to_delete) {
+    const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+    const ConfigEdit::Plan plan = ConfigEdit::plan(*document, to_add, to_delete, QStringLiteral("home"));
+    if (!plan.ok) return "plan failed: " + plan.error.toUtf8();
+    return ConfigEdit::apply(text, plan.splices);
+}
+
+// the "@@ -a,b +c,d @@" lines of the diff of an edit
+static QStringList hunk_headers(const QByteArray& text, const QStringList& to_add, const QStringList& to_delete) {
+    const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+    const ConfigEdit::Plan plan = ConfigEdit::plan(*document, to_add, to_delete, QStringLiteral("home"));
+    QStringList headers;
+    for (const QString& line : ConfigEdit::diff(document->path, text, plan.splices)) {
+        if (line.startsWith(QLatin1String("@@"))) headers.append(line);
+    }
+    return headers;
+}
+
+// Parser and edit cases that need no nix installation, only the text of a configuration file.
+class TestNixConfig : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // `~/...` path literals used to stop the lexer from advancing, parsing never returned.
+    void home_path_literal() {
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home.file.\".vimrc\".source = ~/dotfiles/vimrc;\n"
+            "  home.packages = [ pkgs.hello pkgs.git ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QVERIFY(document->parsed);
+        QCOMPARE(document->packages(QStringLiteral("home")),
+                 QStringList({QStringLiteral("pkgs.hello"), QStringLiteral("pkgs.git")}));
+    }
+
+    void home_path_literal_at_end_of_file() {
+        const QByteArray text = "{ home.file.\".vimrc\".source = ~/vimrc";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QVERIFY(document->blocks.isEmpty());
+    }
+
+    void with_pkgs_on_one_line() {
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home.packages = with pkgs; [ hello git htop ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QVERIFY(document->parsed);
+        QCOMPARE(document->packages(QStringLiteral("home")),
+                 QStringList({QStringLiteral("pkgs.hello"), QStringLiteral("pkgs.git"), QStringLiteral("pkgs.htop")}));
+        QVERIFY(document->blocks.first().list_with_pkgs);
+        QCOMPARE(document->entries.first().first().text, QStringLiteral("hello"));
+    }
+
+    void several_packages_per_line() {
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home.packages = [\n"
+            "    pkgs.hello pkgs.git\n"
+            "    pkgs.htop\n"
+            "  ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QCOMPARE(document->packages(QStringLiteral("home")),
+                 QStringList({QStringLiteral("pkgs.hello"), QStringLiteral("pkgs.git"), QStringLiteral("pkgs.htop")}));
+        const auto& entries = document->entries.first();
+        QCOMPARE(entries.at(0).line, 3);
+        QCOMPARE(entries.at(1).line, 3);
+        QCOMPARE(entries.at(2).line, 4);
+        QCOMPARE(text.mid(entries.at(1).begin, entries.at(1).end - entries.at(1).begin), QByteArray("pkgs.git"));
+    }
+
+    void concatenated_lists() {
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home.packages = [ pkgs.hello ] ++ [ pkgs.git ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QCOMPARE(document->packages(QStringLiteral("home")),
+                 QStringList({QStringLiteral("pkgs.hello"), QStringLiteral("pkgs.git")}));
+        QCOMPARE(document->blocks.first().list_open, qsizetype(text.indexOf("[ pkgs.hello")));
+    }
+
+    void conditional_list() {
+        const QByteArray text =
+            "{ pkgs, lib, config, ... }:\n"
+            "{\n"
+            "  home.packages = lib.optionals config.gui [ pkgs.firefox ] ++ [ pkgs.git ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        const auto& entries = document->entries.first();
+        QCOMPARE(entries.size(), 2);
+        QCOMPARE(entries.at(0).name, QStringLiteral("pkgs.firefox"));
+        QVERIFY(entries.at(0).conditional);
+        QCOMPARE(entries.at(1).name, QStringLiteral("pkgs.git"));
+        QVERIFY(!entries.at(1).conditional);
+        // packages are added to the list that is always there
+        QCOMPARE(document->blocks.first().list_open, qsizetype(text.indexOf("[ pkgs.git")));
+        QCOMPARE(document->blocks.first().list_close, qsizetype(text.lastIndexOf(']')));
+    }
+
+    void nested_home_set() {
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home = {\n"
+            "    username = \"me\";\n"
+            "    packages = [ pkgs.hello ];\n"
+            "  };\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QCOMPARE(document->block_index(QStringLiteral("home")), 0);
+        QCOMPARE(document->packages(QStringLiteral("home")), QStringList({QStringLiteral("pkgs.hello")}));
+    }
+
+    // `with pkgs;` does not shadow let bindings or function arguments
+    void shadowed_names() {
+        const QByteArray text =
+            "{ pkgs, myTool, ... }:\n"
+            "let\n"
+            "  git = pkgs.gitFull;\n"
+            "in\n"
+            "{\n"
+            "  home.packages = with pkgs; [ git myTool hello ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QCOMPARE(document->packages(QStringLiteral("home")),
+                 QStringList({QStringLiteral("git"), QStringLiteral("myTool"), QStringLiteral("pkgs.hello")}));
+    }
+
+    void brackets_in_strings() {
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home.sessionVariables.EDITOR = \"${pkgs.vim}/bin/vim ]\";\n"
+            "  home.file.\".xinitrc\".text = ''\n"
+            "    exec ${pkgs.i3}/bin/i3 [ ]\n"
+            "    ''${HOME} ]\n"
+            "  '';\n"
+            "  home.packages = [ pkgs.hello ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QVERIFY(document->parsed);
+        QCOMPARE(document->blocks.size(), 1);
+        QCOMPARE(document->packages(QStringLiteral("home")), QStringList({QStringLiteral("pkgs.hello")}));
+        QCOMPARE(document->entries.first().first().line, 7);
+    }
+
+    void imports() {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QVERIFY(QDir(dir.path()).mkdir(QStringLiteral("dev")));
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  imports = [ ./programs.nix ../shared.nix \"/etc/x.nix\" ] ++ [ ./dev ];\n"
+            "  home.packages = [ pkgs.hello ];\n"
+            "}\n";
+        const auto document = ConfigDocument::parse(dir.filePath(QStringLiteral("home.nix")), text);
+        // strings are not followed, a directory stands for its default.nix
+        QCOMPARE(document->imports, QStringList({dir.filePath(QStringLiteral("programs.nix")),
+                                                 QDir::cleanPath(dir.path() + QStringLiteral("/../shared.nix")),
+                                                 dir.filePath(QStringLiteral("dev/default.nix"))}));
+    }
+
+    void unterminated_data() {
+        QTest::addColumn<QByteArray>("text");
+        QTest::newRow("string") << QByteArray("{ home.packages = [ pkgs.hello ];\n  xdg.configFile.\"a\".text = \"open;\n}\n");
+        QTest::newRow("indented string") << QByteArray("{ home.packages = [ pkgs.hello ];\n  xdg.configFile.\"a\".text = ''open;\n}\n");
+        QTest::newRow("comment") << QByteArray("{ home.packages = [ pkgs.hello ];\n  /* open\n}\n");
+        QTest::newRow("bracket") << QByteArray("{ home.packages = [ pkgs.hello ;\n}\n");
+    }
+
+    void unterminated() {
+        QFETCH(QByteArray, text);
+        const auto document = ConfigDocument::parse(QStringLiteral("/tmp/home.nix"), text);
+        QVERIFY(!document->parsed);
+        QVERIFY(document->blocks.isEmpty());
+    }
+
+    void deletion_data() {
+        QTest::addColumn<QByteArray>("text");
+        QTest::addColumn<QStringList>("to_delete");
+        QTest::addColumn<QByteArray>("expected");
+
+        const QByteArray one_line = "{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a pkgs.b pkgs.c ];\n}\n";
+        const QByteArray multi_line =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home.packages = [\n"
+            "    pkgs.a\n"
+            "    pkgs.b # the b tool\n"
+            "    pkgs.b pkgs.c ];\n"
+            "}\n";
+
+        QTest::newRow("only element") << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a ];\n}\n")
+            << QStringList({QStringLiteral("pkgs.a")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ ];\n}\n");
+        QTest::newRow("first") << one_line << QStringList({QStringLiteral("pkgs.a")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.b pkgs.c ];\n}\n");
+        QTest::newRow("middle") << one_line << QStringList({QStringLiteral("pkgs.b")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a pkgs.c ];\n}\n");
+        QTest::newRow("last") << one_line << QStringList({QStringLiteral("pkgs.c")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a pkgs.b ];\n}\n");
+        QTest::newRow("first two") << one_line << QStringList({QStringLiteral("pkgs.a"), QStringLiteral("pkgs.b")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.c ];\n}\n");
+        QTest::newRow("last two") << one_line << QStringList({QStringLiteral("pkgs.b"), QStringLiteral("pkgs.c")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a ];\n}\n");
+        QTest::newRow("all") << one_line << QStringList({QStringLiteral("pkgs.a"), QStringLiteral("pkgs.b"), QStringLiteral("pkgs.c")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ ];\n}\n");
+        QTest::newRow("line with a comment")
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    pkgs.b # the b tool\n    pkgs.c\n  ];\n}\n")
+            << QStringList({QStringLiteral("pkgs.b")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    pkgs.c\n  ];\n}\n");
+        QTest::newRow("last before ]") << multi_line << QStringList({QStringLiteral("pkgs.c")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    pkgs.b # the b tool\n    pkgs.b ];\n}\n");
+        QTest::newRow("whole line before ]") << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    pkgs.c ];\n}\n")
+            << QStringList({QStringLiteral("pkgs.c")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    ];\n}\n");
+        // both pkgs.b go, the one with the comment takes its line along
+        QTest::newRow("neighbours before ]") << multi_line << QStringList({QStringLiteral("pkgs.b"), QStringLiteral("pkgs.c")})
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    ];\n}\n");
+    }
+
+    void deletion() {
+        QFETCH(QByteArray, text);
+        QFETCH(QStringList, to_delete);
+        QFETCH(QByteArray, expected);
+        QCOMPARE(edited(text, QStringList(), to_delete), expected);
+    }
+
+    void insertion_data() {
+        QTest::addColumn<QByteArray>("text");
+        QTest::addColumn<QByteArray>("expected");
+
+        QTest::newRow("empty list") << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [];\n}\n")
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.x pkgs.y ];\n}\n");
+        QTest::newRow("one line") << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a ];\n}\n")
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a pkgs.x pkgs.y ];\n}\n");
+        QTest::newRow("] on its own line") << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n  ];\n}\n")
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    pkgs.x\n    pkgs.y\n  ];\n}\n");
+        QTest::newRow("with pkgs") << QByteArray("{ pkgs, ... }:\n{\n  home.packages = with pkgs; [\n    hello\n  ];\n}\n")
+            << QByteArray("{ pkgs, ... }:\n{\n  home.packages = with pkgs; [\n    hello\n    x\n    y\n  ];\n}\n");
+    }
+
+    void insertion() {
+        QFETCH(QByteArray, text);
+        QFETCH(QByteArray, expected);
+        QCOMPARE(edited(text, QStringList({QStringLiteral("pkgs.x"), QStringLiteral("pkgs.y")}), QStringList()), expected);
+    }
+
+    // the insertion point is inside the deleted range, the new name takes the place of the old ones
+    void insertion_into_deletion() {
+        const QByteArray text = "{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    pkgs.b pkgs.c ];\n}\n";
+        QCOMPARE(edited(text, QStringList({QStringLiteral("pkgs.x")}), QStringList({QStringLiteral("pkgs.b"), QStringLiteral("pkgs.c")})),
+                 QByteArray("{ pkgs, ... }:\n{\n  home.packages = [\n    pkgs.a\n    pkgs.x ];\n}\n"));
+        QCOMPARE(edited("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a pkgs.b pkgs.c ];\n}\n",
+                        QStringList({QStringLiteral("pkgs.x")}), QStringList({QStringLiteral("pkgs.b"), QStringLiteral("pkgs.c")})),
+                 QByteArray("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a pkgs.x ];\n}\n"));
+    }
+
+    void unrelated_lines_untouched() {
+        const QByteArray text =
+            "{ pkgs, ... }:\t\n"
+            "\n"
+            "{\n"
+            "  # packages\n"
+            "  home.packages = [ pkgs.a pkgs.b ];   \n"
+            "  programs.git   =  { enable = true; };\n"
+            "\t\n"
+            "}";
+        QCOMPARE(edited(text, QStringList({QStringLiteral("pkgs.x")}), QStringList({QStringLiteral("pkgs.b")})),
+                 QByteArray(text).replace("[ pkgs.a pkgs.b ]", "[ pkgs.a pkgs.x ]"));
+    }
+
+    void diff_hunks() {
+        const QByteArray text =
+            "{ pkgs, ... }:\n"
+            "{\n"
+            "  home.packages = [\n"
+            "    pkgs.a\n"
+            "    pkgs.b # the b tool\n"
+            "    pkgs.c\n"
+            "  ];\n"
+            "}\n";
+        QCOMPARE(hunk_headers(text, QStringList(), QStringList({QStringLiteral("pkgs.b")})),
+                 QStringList({QStringLiteral("@@ -5,1 +4,0 @@")}));
+        QCOMPARE(hunk_headers(text, QStringList({QStringLiteral("pkgs.x"), QStringLiteral("pkgs.y")}), QStringList()),
+                 QStringList({QStringLiteral("@@ -6,0 +7,2 @@")}));
+        QCOMPARE(hunk_headers(text, QStringList({QStringLiteral("pkgs.x")}), QStringList({QStringLiteral("pkgs.a")})),
+                 QStringList({QStringLiteral("@@ -4,1 +3,0 @@"), QStringLiteral("@@ -6,0 +6,1 @@")}));
+        QCOMPARE(hunk_headers("{ pkgs, ... }:\n{\n  home.packages = [ pkgs.a ];\n}\n", QStringList({QStringLiteral("pkgs.x")}), QStringList()),
+                 QStringList({QStringLiteral("@@ -3,1 +3,1 @@")}));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestNixConfig)
+#include "tst_nix-config.moc"
@@ -0,0 +1,73 @@
+/*
+ * This file is part of system-settings
+ *
+ * Copyright (C) 2013 Canonical Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 3, as published
+ * by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranties of
+ * MERCHANTABILITY, SATISFACTORY QUALITY, or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * made by ChromiumOS-Guy (https://github.com/ChromiumOS-Guy)
+ */
+
+
+#include "../libs/package-set.h"
+
+#include <QtTest>
+
+class TestPackageSet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void normalized() {
+        QCOMPARE(PackageSet::normalized(QStringLiteral("  nixpkgs.hello\t")), QStringLiteral("pkgs.hello"));
+        QCOMPARE(PackageSet::normalized(QStringLiteral("pkgs.hello ")), QStringLiteral("pkgs.hello"));
+        QCOMPARE(PackageSet::normalized(QStringLiteral("hello")), QStringLiteral("hello"));
+    }
+
+    void attribute() {
+        QCOMPARE(PackageSet::attribute(QStringLiteral("pkgs.python3Packages.requests")), QStringLiteral("python3Packages.requests"));
+        QCOMPARE(PackageSet::attribute(QStringLiteral("nixpkgs.hello")), QStringLiteral("hello"));
+        QCOMPARE(PackageSet::attribute(QStringLiteral(" hello ")), QStringLiteral("hello"));
+    }
+
+    void set_keeps_first_spelling_once() {
+        PackageSet::Set set(QStringList({QStringLiteral("pkgs.b"), QStringLiteral("nixpkgs.a"), QStringLiteral(" pkgs.b"),
+                                         QStringLiteral("pkgs.a"), QString(), QStringLiteral("  ")}));
+        QCOMPARE(set.names(), QStringList({QStringLiteral("pkgs.b"), QStringLiteral("pkgs.a")}));
+        QVERIFY(set.contains(QStringLiteral("nixpkgs.b")));
+        QVERIFY(!set.contains(QStringLiteral("pkgs.c")));
+        QVERIFY(!set.insert(QStringLiteral("nixpkgs.a ")));
+        QVERIFY(set.insert(QStringLiteral("pkgs.c")));
+        QCOMPARE(set.size(), 3);
+    }
+
+    void diff() {
+        const QStringList current({QStringLiteral("pkgs.d"), QStringLiteral("pkgs.a"), QStringLiteral("nixpkgs.b"),
+                                   QStringLiteral("pkgs.e"), QStringLiteral("pkgs.d")});
+        const QStringList wanted({QStringLiteral("pkgs.z"), QStringLiteral(" pkgs.b "), QStringLiteral("pkgs.y"),
+                                  QStringLiteral("nixpkgs.z"), QStringLiteral("pkgs.a")});
+        const PackageSet::Diff diff = PackageSet::diff(current, wanted);
+        QCOMPARE(diff.added, QStringList({QStringLiteral("pkgs.z"), QStringLiteral("pkgs.y")}));
+        QCOMPARE(diff.removed, QStringList({QStringLiteral("pkgs.d"), QStringLiteral("pkgs.e")}));
+    }
+
+    void diff_of_equal_lists() {
+        const PackageSet::Diff diff = PackageSet::diff(QStringList({QStringLiteral("nixpkgs.a"), QStringLiteral("pkgs.b")}),
+                                                       QStringList({QStringLiteral("pkgs.b"), QStringLiteral("pkgs.a ")}));
+        QVERIFY(diff.added.isEmpty());
+        QVERIFY(diff.removed.isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPackageSet)
+#include "tst_package-set.moc"
@@ -66,6 +66,16 @@ QString WorkerLogic::read_packages_sync(const QString& packageType)
     return PackageManipulation::read_packages_wrapper(packageType);
 }
 
+QString WorkerLogic::read_package_files_sync(const QString& packageType)
+{
+    return PackageManipulation::read_package_files_wrapper(packageType);
+}
+
+QString WorkerLogic::describe_packages_sync(const QString& packagesJsonString)
+{
+    return PackageManipulation::describe_packages_wrapper(packagesJsonString);
+}
+
 QString WorkerLogic::add_packages_sync(const QString& packagesJsonString, bool allow_insecure, const QString& packageType, bool overwrite)
 {
     return PackageManipulation::add_packages_wrapper(packagesJsonString, allow_insecure, packageType, overwrite);
@@ -76,9 +86,19 @@ QString WorkerLogic::delete_packages_sync(const QString& packagesJsonString, con
     return PackageManipulation::delete_packages_wrapper(packagesJsonString, packageType);
 }
 
-QString WorkerLogic::search_packages_sync(const QString& quarry, const bool local, const QString& base_url, const int timeout)
+QString WorkerLogic::apply_changes_sync(const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure, const QString& packageType)
+{
+    return PackageManipulation::apply_changes_wrapper(toAddJsonString, toDeleteJsonString, allow_insecure, packageType);
+}
+
+QString WorkerLogic::preview_changes_sync(const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType)
+{
+    return PackageManipulation::preview_changes_wrapper(toAddJsonString, toDeleteJsonString, packageType);
+}
+
+QString WorkerLogic::search_packages_sync(const QString& quarry, const bool local, const QString& base_url, const int timeout, const bool by_command)
 {
-    return PackageManipulation::search_packages_wrapper(quarry, local, base_url, timeout);
+    return PackageManipulation::search_packages_wrapper(quarry, local, base_url, timeout, by_command);
 }
 
 QString WorkerLogic::update_channels_sync()
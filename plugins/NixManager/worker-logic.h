@@ -48,9 +48,13 @@ public:
     static QString hm_switch_sync(const bool allow_insecure);
     static QString hm_version_sync();
     static QString read_packages_sync(const QString& packageType);
+    static QString read_package_files_sync(const QString& packageType);
+    static QString describe_packages_sync(const QString& packagesJsonString);
     static QString add_packages_sync(const QString& packagesJsonString, bool allow_insecure, const QString& packageType, bool overwrite);
     static QString delete_packages_sync(const QString& packagesJsonString, const QString& packageType);
-    static QString search_packages_sync(const QString& quarry, const bool local, const QString& base_url, const int timeout);
+    static QString apply_changes_sync(const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure, const QString& packageType);
+    static QString preview_changes_sync(const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType);
+    static QString search_packages_sync(const QString& quarry, const bool local, const QString& base_url, const int timeout, const bool by_command);
     static QString update_channels_sync();
     static QString list_channels_sync();
     static QString add_channel_sync(const QString& url, const QString& name);
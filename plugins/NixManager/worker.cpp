@@ -1,8 +1,14 @@
 // worker.cpp
 #include "worker.h"
 #include "worker-logic.h"
+#include "libs/operation-context.h"
+#include "nix-layer/nix-progress.h"
 #include <QDebug>
 #include <QThread>
+#include <QSet>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 Worker::Worker(QObject *parent) : QObject(parent)
 {
@@ -10,13 +16,85 @@ Worker::Worker(QObject *parent) : QObject(parent)
     qDebug() << "Worker created in thread:" << QThread::currentThread();
 }
 
+// Adds "cancelled", "timed_out", "superseded" and "log_file" fields to every result and marks a failed
+// result as cancelled/timed out. A result that succeeded anyway (cancel came in too late)
+// is reported as the success it is.
+QString Worker::finalize_result(const QString& resultJson, OperationContext::Interruption reason, const QString& logPath)
+{
+    QJsonObject resultObj = QJsonDocument::fromJson(resultJson.toUtf8()).object();
+    bool interrupted = reason != OperationContext::Interruption::None && !resultObj.value("success").toBool(false);
+
+    resultObj["cancelled"] = interrupted && reason == OperationContext::Interruption::Cancelled;
+    resultObj["timed_out"] = interrupted && reason == OperationContext::Interruption::TimedOut;
+    resultObj["superseded"] = interrupted && reason == OperationContext::Interruption::Superseded;
+    resultObj["log_file"] = logPath; // complete process output, the result only carries its tail
+    if (interrupted) {
+        const QString message = OperationContext::interruption_message(reason);
+        resultObj["success"] = false;
+        resultObj["message"] = message;
+        resultObj["simple_error"] = QJsonArray({message});
+        if (!resultObj.contains("output")) resultObj["output"] = QJsonArray();
+        if (!resultObj.contains("full_error")) resultObj["full_error"] = QJsonArray({message});
+    }
+    return QJsonDocument(resultObj).toJson(QJsonDocument::Compact);
+}
+
+// Operations that only run nix-env/nix-channel: their error events already hold everything the stderr tail
+// would, with the source position added. hm_switch keeps its tail, home-manager logs in the human readable format.
+static const QSet<QString> kNixEventOperations = {
+    QStringLiteral("update_channels"), QStringLiteral("list_channels"), QStringLiteral("add_channel"),
+    QStringLiteral("remove_channel"), QStringLiteral("list_generations"), QStringLiteral("switch_generation"),
+    QStringLiteral("delete_generation"), QStringLiteral("delete_old_generations"),
+};
+
+QString Worker::attach_nix_errors(const QString& resultJson, const QList<NixLog::Event>& errors, bool replaceFullError)
+{
+    QJsonObject resultObj = QJsonDocument::fromJson(resultJson.toUtf8()).object();
+    QJsonArray nixErrors;
+    for (const NixLog::Event& error : errors) {
+        if (error.file.isEmpty()) {
+            nixErrors.append(error.text);
+        } else {
+            nixErrors.append(QStringLiteral("%1 (%2:%3:%4)").arg(error.text, error.file).arg(error.line).arg(error.column));
+        }
+    }
+    resultObj["nix_errors"] = nixErrors;
+    if (replaceFullError && !nixErrors.isEmpty() && !resultObj.value("success").toBool(false)) {
+        resultObj["full_error"] = nixErrors;
+    }
+    return QJsonDocument(resultObj).toJson(QJsonDocument::Compact);
+}
+
 // Macro to simplify implementation of slots calling WorkerLogic and emitting the result
 // The WorkerLogic::func is the *sync function name*
 // Arguments: (WorkerLogic sync function, requestId, operation name string, ...WorkerLogic args)
+// While the sync function runs, every process output line is parsed for nix progress and reported through operation_progress,
+// partial results (OperationContext::report_partial) go out through operation_partial.
+// Error events the parser saw end up in the result's "nix_errors" (see attach_nix_errors).
+// Requests cancelled while still queued are answered without running; the timeout starts once the request runs.
 #define WORKER_LOGIC_SLOT(logic_func, req_id, op_name, logic_args) \
 { \
     qDebug() << "Worker: Starting " << op_name << " in thread:" << QThread::currentThread(); \
-    QString result = WorkerLogic::logic_func logic_args; \
+    OperationContext::CancelToken cancel_token = OperationContext::find_request(req_id); \
+    if (!cancel_token) cancel_token = std::make_shared<OperationContext::CancelState>(); \
+    cancel_token->start_clock(); \
+    NixProgress::Parser progress_parser; \
+    OperationContext::Scope op_scope(req_id, op_name, [&](const QString& stream, const QString& line) { \
+        if (progress_parser.feed(line)) { \
+            emit operation_progress(req_id, op_name, progress_parser.to_json(stream)); \
+        } \
+    }, cancel_token, [&](const QString& partial_json) { \
+        emit operation_partial(req_id, op_name, partial_json); \
+    }); \
+    QString result; \
+    if (cancel_token->check() == OperationContext::Interruption::None) { \
+        result = WorkerLogic::logic_func logic_args; \
+    } \
+    if (!progress_parser.errors().isEmpty()) { \
+        result = attach_nix_errors(result, progress_parser.errors(), kNixEventOperations.contains(op_name)); \
+    } \
+    result = finalize_result(result, cancel_token->check(), op_scope.log_path()); \
+    OperationContext::unregister_request(req_id); \
     emit operation_finished(result, req_id, op_name); \
     qDebug() << "Worker: Finished " << op_name; \
 }
@@ -38,6 +116,16 @@ void Worker::read_packages(const QString& packageType, const QVariant& requestId
     WORKER_LOGIC_SLOT(read_packages_sync, requestId, operation, (packageType));
 }
 
+void Worker::read_package_files(const QString& packageType, const QVariant& requestId, const QString& operation)
+{
+    WORKER_LOGIC_SLOT(read_package_files_sync, requestId, operation, (packageType));
+}
+
+void Worker::describe_packages(const QString& packagesJsonString, const QVariant& requestId, const QString& operation)
+{
+    WORKER_LOGIC_SLOT(describe_packages_sync, requestId, operation, (packagesJsonString));
+}
+
 void Worker::add_packages(const QString& packagesJsonString, bool allow_insecure, const QString& packageType, bool overwrite, const QVariant& requestId, const QString& operation)
 {
     WORKER_LOGIC_SLOT(add_packages_sync, requestId, operation, (packagesJsonString, allow_insecure, packageType, overwrite));
@@ -48,9 +136,19 @@ void Worker::delete_packages(const QString& packagesJsonString, const QString& p
     WORKER_LOGIC_SLOT(delete_packages_sync, requestId, operation, (packagesJsonString, packageType));
 }
 
-void Worker::search_packages(const QString& quarry, bool local, const QString& base_url, int timeout, const QVariant& requestId, const QString& operation)
+void Worker::apply_changes(const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure, const QString& packageType, const QVariant& requestId, const QString& operation)
+{
+    WORKER_LOGIC_SLOT(apply_changes_sync, requestId, operation, (toAddJsonString, toDeleteJsonString, allow_insecure, packageType));
+}
+
+void Worker::preview_changes(const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType, const QVariant& requestId, const QString& operation)
+{
+    WORKER_LOGIC_SLOT(preview_changes_sync, requestId, operation, (toAddJsonString, toDeleteJsonString, packageType));
+}
+
+void Worker::search_packages(const QString& quarry, bool local, const QString& base_url, int timeout, bool by_command, const QVariant& requestId, const QString& operation)
 {
-    WORKER_LOGIC_SLOT(search_packages_sync, requestId, operation, (quarry, local, base_url, timeout));
+    WORKER_LOGIC_SLOT(search_packages_sync, requestId, operation, (quarry, local, base_url, timeout, by_command));
 }
 
 void Worker::update_channels(const QVariant& requestId, const QString& operation)
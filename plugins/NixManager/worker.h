@@ -6,6 +6,8 @@
 #include <QVariant>
 #include <QThread>
 #include "worker-logic.h"
+#include "libs/operation-context.h"
+#include "nix-layer/nix-log.h"
 
 /**
  * @brief The Worker class performs long-running, synchronous tasks
@@ -22,6 +24,24 @@ class Worker : public QObject
 public:
     explicit Worker(QObject *parent = nullptr);
 
+    /**
+     * @brief Adds "cancelled", "timed_out", "superseded" and "log_file" to a result, marking a failed one as interrupted.
+     * @param resultJson The WorkerLogic result (may be empty if the request never ran).
+     * @param reason Why the request was interrupted, if it was.
+     * @param logPath The request's log file ("" if nothing was logged).
+     * @return The final result JSON as emitted by operation_finished.
+     */
+    static QString finalize_result(const QString& resultJson, OperationContext::Interruption reason, const QString& logPath);
+
+    /**
+     * @brief Adds the error events nix reported through internal-json to a result as "nix_errors".
+     * @param resultJson The WorkerLogic result.
+     * @param errors The events collected by the request's NixProgress::Parser.
+     * @param replaceFullError If the result failed, replace its "full_error" (the scraped stderr tail) with the events.
+     * @return The result JSON with "nix_errors" set (one "message (file:line:column)" string per event).
+     */
+    static QString attach_nix_errors(const QString& resultJson, const QList<NixLog::Event>& errors, bool replaceFullError);
+
 public slots:
     // =========================================================================
     // Slot wrappers that call WorkerLogic
@@ -33,9 +53,13 @@ public slots:
     void hm_switch(bool allow_insecure, const QVariant& requestId, const QString& operation);
     void hm_version(const QVariant& requestId, const QString& operation);
     void read_packages(const QString& packageType, const QVariant& requestId, const QString& operation);
+    void read_package_files(const QString& packageType, const QVariant& requestId, const QString& operation);
+    void describe_packages(const QString& packagesJsonString, const QVariant& requestId, const QString& operation);
     void add_packages(const QString& packagesJsonString, bool allow_insecure, const QString& packageType, bool overwrite, const QVariant& requestId, const QString& operation);
     void delete_packages(const QString& packagesJsonString, const QString& packageType, const QVariant& requestId, const QString& operation);
-    void search_packages(const QString& quarry, bool local, const QString& base_url, int timeout, const QVariant& requestId, const QString& operation);
+    void apply_changes(const QString& toAddJsonString, const QString& toDeleteJsonString, bool allow_insecure, const QString& packageType, const QVariant& requestId, const QString& operation);
+    void preview_changes(const QString& toAddJsonString, const QString& toDeleteJsonString, const QString& packageType, const QVariant& requestId, const QString& operation);
+    void search_packages(const QString& quarry, bool local, const QString& base_url, int timeout, bool by_command, const QVariant& requestId, const QString& operation);
     void update_channels(const QVariant& requestId, const QString& operation);
     void list_channels(const QVariant& requestId, const QString& operation);
     void add_channel(const QString& url, const QString& name, const QVariant& requestId, const QString& operation);
@@ -60,6 +84,22 @@ signals:
      * @param operation The name of the method that completed (e.g., "hm_version").
      */
     void operation_finished(const QString& resultJson, const QVariant& requestId, const QString& operation);
+
+    /**
+     * @brief Signal emitted for every output line while a WorkerLogic function is still running.
+     * @param requestId Original request identifier to match progress to requests.
+     * @param operation The name of the running method (e.g., "hm_switch").
+     * @param progressJson JSON string with the line, its stream, the current phase and nix build/download counters.
+     */
+    void operation_progress(const QVariant& requestId, const QString& operation, const QString& progressJson);
+
+    /**
+     * @brief Signal emitted for every partial result while a WorkerLogic function is still running.
+     * @param requestId Original request identifier to match partial results to requests.
+     * @param operation The name of the running method (e.g., "search_packages").
+     * @param partialJson JSON string, its layout depends on the operation.
+     */
+    void operation_partial(const QVariant& requestId, const QString& operation, const QString& partialJson);
 };
 
 #endif // WORKER_H
\ No newline at end of file
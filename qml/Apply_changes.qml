@@ -61,22 +61,20 @@ Page {
                     loadingbar.enabled = true;
                     header.leadingActionBar.visible = false;
                     header.leadingActionBar.enabled = false;
-                    if (root.packages_to_delete.length > 0) {
-                        root.currentRequestId = "VERSION_REQUEST_" + Date.now(); // we will start with deleting packages because it is the least likely to cause problems
-                        NixManagerPlugin.request_delete_packages(root.currentRequestId, JSON.stringify(root.packages_to_delete));
-                    } else if (root.packages_to_install.length > 0) {
-                        var packages_to_install_processed = [];
-                        for (var i = 0; i < root.packages_to_install.length; i++) {
-                            try {
-                                var obj = JSON.parse(root.packages_to_install[i]);
-                                packages_to_install_processed.push("pkgs." + obj.name);
-                            } catch (e) {
-                                console.log("Failed to parse packages_to_install[" + i + "]: " + e);
-                            }
+                    var packages_to_install_processed = [];
+                    for (var i = 0; i < root.packages_to_install.length; i++) {
+                        try {
+                            var obj = JSON.parse(root.packages_to_install[i]);
+                            packages_to_install_processed.push("pkgs." + obj.name);
+                        } catch (e) {
+                            console.log("Failed to parse packages_to_install[" + i + "]: " + e);
                         }
-                        console.log(JSON.stringify(packages_to_install_processed));
-                        root.currentRequestId = "VERSION_REQUEST_" + Date.now();
-                        NixManagerPlugin.request_add_packages(root.currentRequestId, JSON.stringify(packages_to_install_processed), root.allow_insecure_pakcages); 
+                    }
+                    console.log(JSON.stringify(packages_to_install_processed));
+                    // deletions and installations go in one transaction: one switch, rolled back together
+                    root.currentRequestId = "VERSION_REQUEST_" + Date.now();
+                    NixManagerPlugin.request_apply_changes(root.currentRequestId, JSON.stringify(packages_to_install_processed), JSON.stringify(root.packages_to_delete), root.allow_insecure_pakcages);
+                    if (applyPage.didInstall) {
                         loadinglabel.text = i18n.tr('Installing packages, please wait.')
                     }
                 }
@@ -103,74 +101,32 @@ Page {
                 try {
                     const result = JSON.parse(resultJson);
                     // Example processing:
-                    if (result.success) {
-                        if (operation == "delete_packages") {
-                            if (root.packages_to_install.length > 0) { // get to installing packages
-                                var packages_to_install_processed = [];
-                                for (var i = 0; i < root.packages_to_install.length; i++) {
-                                    try {
-                                        var obj = JSON.parse(root.packages_to_install[i]);
-                                        packages_to_install_processed.push("pkgs." + obj.name);
-                                    } catch (e) {
-                                        console.log("Failed to parse packages_to_install[" + i + "]: " + e);
-                                    }
-                                }
-                                root.currentRequestId = "VERSION_REQUEST_" + Date.now();
-                                NixManagerPlugin.request_add_packages(root.currentRequestId, JSON.stringify(packages_to_install_processed), root.allow_insecure_pakcages); 
-                                loadinglabel.text = i18n.tr('Installing packages, please wait.')
-                            } else {
-                                loadingbar.visible = false;
-                                loadingbar.enabled = false;
-                                header.leadingActionBar.visible = true;
-                                header.leadingActionBar.enabled = true;
-                                applyPage.setSuccessLabel();
-                                label0.color = theme.palette.normal.positive;
-                                reportbtn.visible = false;
-                                reportbtn.enabled = false;
-                                report.visible = true;
-                                report.enabled = true;
-                            }
-                            root.packages_to_delete = [];
-                        } else if (operation == "add_packages") {
-                            loadingbar.visible = false;
-                            loadingbar.enabled = false;
-                            header.leadingActionBar.visible = true;
-                            header.leadingActionBar.enabled = true;
+                    if (operation == "apply_changes") {
+                        loadingbar.visible = false;
+                        loadingbar.enabled = false;
+                        header.leadingActionBar.visible = true;
+                        header.leadingActionBar.enabled = true;
+                        if (result.success) {
                             applyPage.setSuccessLabel();
+                            root.packages_to_delete = [];
                             root.packages_to_install = [];
                             label0.color = theme.palette.normal.positive;
                             reportbtn.visible = false;
                             reportbtn.enabled = false;
-                            report.visible = true;
-                            report.enabled = true;
-                        }
-                        
-                    } else {
-                        if (operation == "delete_packages") {
-                            loadingbar.visible = false;
-                            loadingbar.enabled = false;
-                            report.visible = true;
-                            report.enabled = true;
-                            label0.text = i18n.tr('Package deletion failed!');
-                            label0.color = theme.palette.normal.negative;
-                            reportbtn.text = i18n.tr('Details');
-                            reportbtn.clicked.connect(function() {report.visible = false; report.enabled = false; showerror.visible = true; showerror.enabled = true; showerror.error = result.full_error.join(' '); simpleerror.chosen = result.simple_error.join(' ');})
-                            report.visible = true;
-                            report.enabled = true;
-                            header.leadingActionBar.visible = true;
-                            header.leadingActionBar.enabled = true;
-                        } else if (operation == "add_packages") {
-                            loadingbar.visible = false;
-                            loadingbar.enabled = false;
-                            label0.text = i18n.tr('Package installation failed!');
+                        } else {
+                            if (applyPage.didDelete && applyPage.didInstall) {
+                                label0.text = i18n.tr('Package deletion/installation failed!');
+                            } else if (applyPage.didInstall) {
+                                label0.text = i18n.tr('Package installation failed!');
+                            } else {
+                                label0.text = i18n.tr('Package deletion failed!');
+                            }
                             label0.color = theme.palette.normal.negative;
                             reportbtn.text = i18n.tr('Details');
                             reportbtn.clicked.connect(function() {report.visible = false; report.enabled = false; showerror.visible = true; showerror.enabled = true; showerror.error = result.full_error.join(' '); simpleerror.chosen = result.simple_error.join(' ');})
-                            report.visible = true;
-                            report.enabled = true;
-                            header.leadingActionBar.visible = true;
-                            header.leadingActionBar.enabled = true;
                         }
+                        report.visible = true;
+                        report.enabled = true;
                     }
                 } catch(e) {
                     console.error("Failed to parse result JSON:", e);
@@ -469,6 +425,10 @@ Page {
             indeterminate: true
         }
 
+        ProgressLabel {
+            requestId: root.currentRequestId
+        }
+
         Item {
             Layout.fillHeight: true
         }
@@ -413,6 +413,10 @@ Page {
             indeterminate: true
         }
 
+        ProgressLabel {
+            requestId: root.currentRequestId
+        }
+
         Item {
             Layout.fillHeight: true
         }
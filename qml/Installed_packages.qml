@@ -27,6 +27,8 @@ import NixManagerPlugin 1.0
 Page {
     id: installedpackagesPage
 
+    property string describeRequestId: "" // the lookup whose details the list shows
+
     Connections {
         target: NixManagerPlugin
         
@@ -44,6 +46,12 @@ Page {
                     if (result.success) {
                         if (operation == "read_packages") {
                             packageList.setPackages(result.output);
+                            // version and summary come from the local package index, if one was built
+                            root.currentRequestId = "VERSION_REQUEST_" + Date.now();
+                            installedpackagesPage.describeRequestId = root.currentRequestId;
+                            NixManagerPlugin.request_describe_packages(root.currentRequestId, JSON.stringify(result.output));
+                        } else if (operation == "describe_packages" && receivedId === installedpackagesPage.describeRequestId) {
+                            packageList.setDetails(result.output);
                         }
                         
                     } else {
@@ -116,13 +124,29 @@ Page {
             for (var i = 0; i < installed_packages.length; i++) {
                 try {
 
-                    installed_packages_Model.append({ name: installed_packages[i]});
+                    installed_packages_Model.append({ name: installed_packages[i], version: "", summary: "", available: true });
                 } catch (e) {
                     console.log("Failed to parse installed_packages[" + i + "]: " + e);
                 }
             }
         }
 
+        // describe_packages answers in the order of the list, packages the index doesn't know keep just their name
+        function setDetails(details) {
+            if (!details || !details.length) return;
+            for (var i = 0; i < details.length && i < installed_packages_Model.count; i++) {
+                try {
+                    var obj = JSON.parse(details[i]);
+                    if (!obj.found || obj.name !== installed_packages_Model.get(i).name) continue;
+                    installed_packages_Model.set(i, { version: obj.version ? obj.version : "",
+                                                      summary: obj.summary ? obj.summary : "",
+                                                      available: obj.available !== false });
+                } catch (e) {
+                    console.log("Failed to parse details[" + i + "]: " + e);
+                }
+            }
+        }
+
 
 
         // Clickable list
@@ -186,12 +210,23 @@ Page {
                         Layout.fillWidth: true
                         Layout.alignment: Qt.AlignHCenter
                         horizontalAlignment: Text.AlignHRight
-                        text: packageList.stripPkgPrefix(model.name)
+                        text: packageList.stripPkgPrefix(model.name) + (model.version !== "" ? " " + model.version : "")
                         font.bold: true
                         elide: Text.ElideRight
                         wrapMode: Text.WordWrap
                     }
 
+                    Label {
+                        Layout.fillWidth: true
+                        Layout.alignment: Qt.AlignHCenter
+                        horizontalAlignment: Text.AlignHRight
+                        color: model.available ? LomiriColors.warmGrey : theme.palette.normal.negative
+                        text: model.available ? model.summary : i18n.tr('Not available on this platform')
+                        elide: Text.ElideRight
+                        visible: (model.summary !== "" || !model.available) && root.packages_to_delete.includes(model.name) == false
+                        wrapMode: Text.WordWrap
+                    }
+
                     Label {
                         Layout.fillWidth: true
                         Layout.alignment: Qt.AlignHCenter
@@ -111,6 +111,7 @@ MainView {
 
 
     property string currentRequestId: ""
+    property string searchRequestId: "" // the search whose partial results the list shows
     property string hm_version: ""
     property string nix_generation: ""
     property var packages_to_delete: []
@@ -186,6 +187,21 @@ MainView {
      Connections {
         target: NixManagerPlugin
         
+        // search results arrive one by one (in any order, "rank" is their place) while the search still runs
+        onOperation_partial: (receivedId, operation, partialJson) => {
+            if (operation != "search_packages" || receivedId !== root.searchRequestId) return;
+            try {
+                const partial = JSON.parse(partialJson);
+                if (partial.event == "result") {
+                    searchpackages.insertPackage(partial.rank, partial.package);
+                } else if (partial.event == "complete") {
+                    searchbusy.running = false;
+                }
+            } catch(e) {
+                console.error("Failed to parse partial JSON:", e);
+            }
+        }
+
         // This handler fires for *all* completed operations
         onOperation_result: (resultJson, receivedId, operation) => {
             
@@ -211,7 +227,7 @@ MainView {
                                     break;
                                 }
                             }
-                        } else if (operation == "search_packages") {
+                        } else if (operation == "search_packages" && receivedId === root.searchRequestId) { // older searches were replaced
                             console.debug(resultJson);
                             searchbusy.running = false;
                             searchpackages.setPackages(result.output);
@@ -230,7 +246,7 @@ MainView {
                             root.hm_version = "!!could not find version!!";
                         } else if (operation == "list_generations") {
                             root.nix_generation = "!!could not find generations!!";
-                        } else if (operation == "search_packages") {
+                        } else if (operation == "search_packages" && receivedId === root.searchRequestId) { // older searches were replaced
                             console.debug(resultJson);
                             searchbusy.running = false;
                             searchpackages.setPackages(result.output);
@@ -292,7 +308,9 @@ MainView {
                 // Fires when Enter/Return is pressed (physical or virtual)
                 onAccepted: {
                     root.currentRequestId = "VERSION_REQUEST_" + Date.now();
-                    NixManagerPlugin.request_search_packages(root.currentRequestId, text, enable_local_search, search_api_url, api_timeout);
+                    root.searchRequestId = root.currentRequestId;
+                    packagesModel.clear();
+                    NixManagerPlugin.request_search_packages(root.currentRequestId, text, enable_local_search, search_api_url, api_timeout, "searchbar"); // a new search replaces the running one
                     searchbusy.running = true;
                 }
             }
@@ -614,13 +632,28 @@ MainView {
                         var name = obj.name ? obj.name : "";
                         var summary = obj.summary ? obj.summary : "";
                         var last_updated = obj.last_updated ? obj.last_updated : "";
-                        packagesModel.append({ name: name, summary: summary, last_updated: last_updated, raw: obj });
+                        packagesModel.append({ name: name, summary: summary, last_updated: last_updated, raw: obj, rank: i });
                     } catch (e) {
                         console.log("Failed to parse result.output[" + i + "]: " + e);
                     }
                 }
             }
 
+            // adds one streamed search result, keeping the list in relevance order
+            function insertPackage(rank, obj) {
+                var name = obj.name ? obj.name : "";
+                var summary = obj.summary ? obj.summary : "";
+                var last_updated = obj.last_updated ? obj.last_updated : "";
+                var position = packagesModel.count;
+                for (var i = 0; i < packagesModel.count; i++) {
+                    if (packagesModel.get(i).rank > rank) {
+                        position = i;
+                        break;
+                    }
+                }
+                packagesModel.insert(position, { name: name, summary: summary, last_updated: last_updated, raw: obj, rank: rank });
+            }
+
             Label {
                 Layout.alignment: Qt.AlignHCenter
                 horizontalAlignment: Text.AlignHRight
@@ -638,8 +671,8 @@ MainView {
                 Layout.fillWidth: true
                 Layout.fillHeight: true
                 model: packagesModel
-                visible: searchbusy.running == false
-                enabled: searchbusy.running == false
+                visible: searchbusy.running == false || packagesModel.count > 0 // streamed results show up while the search still runs
+                enabled: searchbusy.running == false || packagesModel.count > 0
                 clip: true
                 boundsBehavior: Flickable.StopAtBounds
                 interactive: true
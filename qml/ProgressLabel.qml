@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2025  ChromiumOS-Guy
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * nixmanager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.7
+import QtQuick.Layouts 1.3
+
+import Lomiri.Components 1.3
+import NixManagerPlugin 1.0
+
+// Progress line of the request the page is waiting for, progress of any other running request is ignored.
+Label {
+    id: progresslabel
+
+    property string requestId: ""
+
+    Layout.alignment: Qt.AlignHCenter
+    horizontalAlignment: Text.AlignHCenter
+    wrapMode: Text.WrapAnywhere
+    maximumLineCount: 3
+    elide: Text.ElideRight
+    Layout.preferredWidth: parent.width * 0.9
+    text: ""
+
+    onRequestIdChanged: text = ""
+
+    Connections {
+        target: NixManagerPlugin
+
+        // This handler fires for every output line of a still running operation
+        onOperation_progress: (receivedId, operation, progressJson) => {
+            if (receivedId !== progresslabel.requestId) return;
+            try {
+                const progress = JSON.parse(progressJson);
+                var counters = "";
+                if (progress.derivations_total > 0) {
+                    counters += i18n.tr("built %1/%2").arg(progress.derivations_built).arg(progress.derivations_total) + " ";
+                }
+                if (progress.paths_total > 0) {
+                    counters += i18n.tr("fetched %1/%2").arg(progress.paths_fetched).arg(progress.paths_total);
+                }
+                progresslabel.text = progress.phase + (counters != "" ? " (" + counters.trim() + ")" : "") + "\n" + progress.line;
+            } catch(e) {
+                console.error("Failed to parse progress JSON:", e);
+            }
+        }
+    }
+}
@@ -365,6 +365,10 @@ Page {
             indeterminate: true
         }
 
+        ProgressLabel {
+            requestId: root.currentRequestId
+        }
+
         Item {
             Layout.fillHeight: true
         }